@@ -40,7 +40,7 @@ typedef bool lto_bool_t;
  * @{
  */
 
-#define LTO_API_VERSION 11
+#define LTO_API_VERSION 13
 
 /**
  * \since prior to LTO_API_VERSION=3
@@ -444,6 +444,48 @@ lto_codegen_compile(lto_code_gen_t cg, size_t* length);
 extern lto_bool_t
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
+/**
+ * Sets the number of partitions the merged module is split into for code
+ * generation by lto_codegen_compile_to_files(). The partitions are compiled
+ * in parallel, each into its own native object file. The default is 1.
+ *
+ * \since LTO_API_VERSION=12
+ */
+extern void
+lto_codegen_set_codegen_partitions(lto_code_gen_t cg, unsigned partitions);
+
+/**
+ * Generates code for all added modules into one native object file per
+ * partition (see lto_codegen_set_codegen_partitions()). The names of the
+ * files are written to names and their number to count; the array is owned
+ * by the lto_code_gen_t. Returns true on error.
+ *
+ * \since LTO_API_VERSION=12
+ */
+extern lto_bool_t
+lto_codegen_compile_to_files(lto_code_gen_t cg, const char*** names,
+                             unsigned* count);
+
+/**
+ * Sets the directory in which generated native objects are cached between
+ * links, keyed by a hash of the merged module and the code generation
+ * options. Passing NULL or an empty string disables the cache, which is the
+ * default.
+ *
+ * \since LTO_API_VERSION=13
+ */
+extern void
+lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *dir);
+
+/**
+ * Sets the size in bytes the cache directory is pruned to, least recently used
+ * entries first, after each compile. Zero, the default, means no limit.
+ *
+ * \since LTO_API_VERSION=13
+ */
+extern void
+lto_codegen_set_cache_size_limit(lto_code_gen_t cg, unsigned long long bytes);
+
 
 /**
  * Sets options to help debug codegen bugs.
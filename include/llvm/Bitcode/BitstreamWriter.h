@@ -44,9 +44,9 @@ class BitstreamWriter {
 
   struct Block {
     unsigned PrevCodeSize;
-    unsigned StartSizeWord;
+    uint64_t StartSizeWord;
     std::vector<BitCodeAbbrev*> PrevAbbrevs;
-    Block(unsigned PCS, unsigned SSW) : PrevCodeSize(PCS), StartSizeWord(SSW) {}
+    Block(unsigned PCS, uint64_t SSW) : PrevCodeSize(PCS), StartSizeWord(SSW) {}
   };
 
   /// BlockScope - This tracks the current blocks that we have entered.
@@ -62,7 +62,7 @@ class BitstreamWriter {
 
   // BackpatchWord - Backpatch a 32-bit word in the output with the specified
   // value.
-  void BackpatchWord(unsigned ByteNo, unsigned NewWord) {
+  void BackpatchWord(uint64_t ByteNo, unsigned NewWord) {
     Out[ByteNo++] = (unsigned char)(NewWord >>  0);
     Out[ByteNo++] = (unsigned char)(NewWord >>  8);
     Out[ByteNo++] = (unsigned char)(NewWord >> 16);
@@ -82,12 +82,12 @@ class BitstreamWriter {
     Out.append(&Bytes[0], &Bytes[4]);
   }
 
-  unsigned GetBufferOffset() const {
+  uint64_t GetBufferOffset() const {
     return Out.size();
   }
 
-  unsigned GetWordIndex() const {
-    unsigned Offset = GetBufferOffset();
+  uint64_t GetWordIndex() const {
+    uint64_t Offset = GetBufferOffset();
     assert((Offset & 3) == 0 && "Not 32-bit aligned");
     return Offset / 4;
   }
@@ -114,6 +114,24 @@ public:
   /// \brief Retrieve the current position in the stream, in bits.
   uint64_t GetCurrentBitNo() const { return GetBufferOffset() * 8 + CurBit; }
 
+  /// BackpatchFixed32 - Overwrite a 32-bit fixed-width field that was emitted
+  /// earlier at bit position BitNo.  The field need not be word aligned, but
+  /// it must already have been flushed to the output.
+  void BackpatchFixed32(uint64_t BitNo, uint32_t NewValue) {
+    assert(BitNo + 32 <= GetBufferOffset() * 8 && "Field not yet flushed!");
+    size_t ByteNo = BitNo / 8;
+    unsigned Shift = BitNo & 7;
+    unsigned NumBytes = Shift ? 5 : 4;
+
+    uint64_t Bits = 0;
+    for (unsigned i = 0; i != NumBytes; ++i)
+      Bits |= uint64_t((unsigned char)Out[ByteNo + i]) << (i * 8);
+    uint64_t Mask = uint64_t(0xFFFFFFFF) << Shift;
+    Bits = (Bits & ~Mask) | (uint64_t(NewValue) << Shift);
+    for (unsigned i = 0; i != NumBytes; ++i)
+      Out[ByteNo + i] = (unsigned char)(Bits >> (i * 8));
+  }
+
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
@@ -215,7 +233,7 @@ public:
     EmitVBR(CodeLen, bitc::CodeLenWidth);
     FlushToWord();
 
-    unsigned BlockSizeWordIndex = GetWordIndex();
+    uint64_t BlockSizeWordIndex = GetWordIndex();
     unsigned OldCodeSize = CurCodeSize;
 
     // Emit a placeholder, which will be replaced when the block is popped.
@@ -255,8 +273,10 @@ public:
     FlushToWord();
 
     // Compute the size of the block, in words, not counting the size field.
-    unsigned SizeInWords = GetWordIndex() - B.StartSizeWord - 1;
-    unsigned ByteNo = B.StartSizeWord*4;
+    uint64_t SizeInWords = GetWordIndex() - B.StartSizeWord - 1;
+    assert(SizeInWords == uint32_t(SizeInWords) &&
+           "Block too large for its size field!");
+    uint64_t ByteNo = B.StartSizeWord*4;
 
     // Update the block size field in the header of this sub-block.
     BackpatchWord(ByteNo, SizeInWords);
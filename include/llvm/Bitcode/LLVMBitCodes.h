@@ -42,7 +42,9 @@ namespace bitc {
 
     TYPE_BLOCK_ID_NEW,
 
-    USELIST_BLOCK_ID
+    USELIST_BLOCK_ID,
+
+    FUNCTION_INDEX_BLOCK_ID
   };
 
 
@@ -73,6 +75,10 @@ namespace bitc {
 
     MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
     MODULE_CODE_COMDAT      = 12,  // COMDAT: [selection_kind, name]
+
+    // FNINDEXOFFSET: [offset]
+    // Word offset of the FUNCTION_INDEX block from the start of the bitcode.
+    MODULE_CODE_FNINDEXOFFSET = 13
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
@@ -333,6 +339,12 @@ namespace bitc {
     USELIST_CODE_ENTRY = 1   // USELIST_CODE_ENTRY: TBD.
   };
 
+  /// The FUNCTION_INDEX block follows the last function body and records
+  /// where each function block starts, so lazy readers can seek to it.
+  enum FunctionIndexCodes {
+    FNINDEX_CODE_ENTRY = 1   // ENTRY: [valueid, bitoffset]
+  };
+
   enum AttributeKindCodes {
     // = 0 is unused
     ATTR_KIND_ALIGNMENT = 1,
@@ -134,6 +134,16 @@ public:
       uint64_t Size, DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
   virtual DIInliningInfo getInliningInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
+
+  /// Print the debug info entries describing the code at \p Address: the
+  /// compile unit entry, then the subprogram containing the address together
+  /// with its children. Returns false if nothing describes the address.
+  virtual bool dumpEntriesForAddress(raw_ostream &OS, uint64_t Address) = 0;
+
+  /// Print each debug info entry that defines \p Name together with its
+  /// children, preceded by the entry of its compile unit. Returns false if
+  /// there is no such entry.
+  virtual bool dumpEntriesForName(raw_ostream &OS, StringRef Name) = 0;
 private:
   const DIContextKind Kind;
 };
@@ -477,6 +477,15 @@ public:
     llvm_unreachable("No support for ProcessAllSections option");
   }
 
+  /// setBackgroundCompilation (MCJIT Only): Compile modules on NumThreads
+  /// worker threads as soon as they are added, instead of when they are first
+  /// needed.  Requests for a symbol wait only for the modules involved.  A
+  /// count of zero turns background compilation off.  Modules must not be
+  /// modified after they have been added, and no other IR may be created in
+  /// their LLVMContext while a compile may still be running.  Other engines
+  /// ignore this setting.
+  virtual void setBackgroundCompilation(unsigned NumThreads) {}
+
   /// Return the target machine (if available).
   virtual TargetMachine *getTargetMachine() { return nullptr; }
 
@@ -0,0 +1,83 @@
+//===-- FileSystemObjectCache.h - On-disk object cache ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares an ObjectCache that keeps compiled objects in a directory
+// so that they can be reused by later processes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_FILESYSTEMOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_FILESYSTEMOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/Mutex.h"
+#include <string>
+
+namespace llvm {
+
+class LockFileManager;
+class TargetMachine;
+
+/// An ObjectCache that stores each compiled object as a file in a directory.
+///
+/// Entries are keyed by an MD5 hash of the module's bitcode together with the
+/// LLVM version and the triple, CPU, feature string and code generation
+/// options of the TargetMachine the cache was created for.  The module identifier plays no
+/// part, and processes with different settings may share one directory.
+///
+/// Objects are written to a temporary file and renamed into place, so
+/// readers never see a partial entry.  A process that misses holds a lock
+/// file on the entry until the object is handed back; other processes that
+/// miss on the same entry wait for it and reuse the result.  An entry that
+/// does not parse as an object file is deleted and treated as a miss.  With a
+/// size limit, the least recently used entries are evicted after each write.
+class FileSystemObjectCache : public ObjectCache {
+public:
+  /// Create a cache in \p CacheDir for objects built by \p TM.  \p MaxSize is
+  /// in bytes; zero lets the cache grow without bound.
+  FileSystemObjectCache(StringRef CacheDir, const TargetMachine &TM,
+                        uint64_t MaxSize = 0);
+  ~FileSystemObjectCache();
+
+  void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj) override;
+  MemoryBuffer *getObject(const Module *M) override;
+
+  /// Remove temporaries left behind by processes that died while writing an
+  /// entry, then evict the least recently used entries until the directory
+  /// holds no more than the size limit.  Does nothing if another process is
+  /// pruning.
+  void prune();
+
+private:
+  std::string CacheDir;
+  std::string TargetKey;
+  uint64_t MaxSize;
+
+  /// Entries that missed in getObject and are waiting for
+  /// notifyObjectCompiled, with the lock file held on them, if any.
+  struct PendingEntry {
+    SmallString<32> Key;
+    LockFileManager *Locker;
+  };
+  DenseMap<const Module*, PendingEntry> Pending;
+  sys::Mutex Lock;
+
+  bool computeKey(const Module *M, SmallString<32> &Key);
+  std::string getEntryPath(StringRef Key);
+  MemoryBuffer *readEntry(StringRef Path);
+
+  FileSystemObjectCache(const FileSystemObjectCache &) LLVM_DELETED_FUNCTION;
+  void operator=(const FileSystemObjectCache &) LLVM_DELETED_FUNCTION;
+};
+
+}
+
+#endif
@@ -34,12 +34,33 @@ namespace llvm {
 /// in the JITed object.  Permissions can be applied either by calling
 /// MCJIT::finalizeObject or by calling SectionMemoryManager::finalizeMemory
 /// directly.  Clients of MCJIT should call MCJIT::finalizeObject.
+///
+/// Sections are carved out of large slabs, one set per kind of section, so
+/// that many small objects share pages instead of each mapping their own.
+/// Finalizing changes the permissions of only the pages that received
+/// sections since the previous finalization, with one call per contiguous
+/// run of pages; the rest of a slab stays writable for later objects.
 class SectionMemoryManager : public RTDyldMemoryManager {
   SectionMemoryManager(const SectionMemoryManager&) LLVM_DELETED_FUNCTION;
   void operator=(const SectionMemoryManager&) LLVM_DELETED_FUNCTION;
 
 public:
-  SectionMemoryManager() { }
+  static const uintptr_t DefaultSlabSize = 256 * 1024;
+  static const uintptr_t HugePageSize = 2 * 1024 * 1024;
+
+  /// Create a memory manager that maps memory in slabs of at least
+  /// \p SlabSize bytes.  If \p UseHugePages is true, slabs are requested
+  /// with sys::Memory::MF_HUGE_HINT, are whole HugePageSize units, and start
+  /// on a HugePageSize boundary, so that the system can back them with huge
+  /// pages.  Whether it does is up to the system.  To avoid splitting huge
+  /// pages, finalizeMemory then protects code and read-only data in whole
+  /// huge pages, so each finalization starts later sections of those kinds
+  /// on a fresh huge page.
+  explicit SectionMemoryManager(uintptr_t SlabSize = DefaultSlabSize,
+                                bool UseHugePages = false)
+    : SlabSize(UseHugePages && SlabSize < HugePageSize ? HugePageSize
+                                                       : SlabSize),
+      UseHugePages(UseHugePages) { }
   virtual ~SectionMemoryManager();
 
   /// \brief Allocates a memory block of (at least) the given size suitable for
@@ -84,11 +105,18 @@ public:
 
 private:
   struct MemoryGroup {
+      // Slabs mapped for this group.
       SmallVector<sys::MemoryBlock, 16> AllocatedMem;
+      // Unused space in the slabs that is still writable.
       SmallVector<sys::MemoryBlock, 16> FreeMem;
+      // Sections handed out since the last finalizeMemory.
+      SmallVector<sys::MemoryBlock, 16> PendingMem;
       sys::MemoryBlock Near;
   };
 
+  uintptr_t SlabSize;
+  bool UseHugePages;
+
   uint8_t *allocateSection(MemoryGroup &MemGroup, uintptr_t Size,
                            unsigned Alignment);
 
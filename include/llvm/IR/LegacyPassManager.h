@@ -61,6 +61,15 @@ public:
   /// whether any of the passes modifies the module, and if so, return true.
   bool run(Module &M);
 
+  /// setStreamFunctions - If enabled, function passes run over a lazily
+  /// loaded module materialize each function on demand, and the last
+  /// function pass manager in the pipeline dematerializes it once it is done
+  /// with it. Function bodies are therefore only valid while the function
+  /// passes run; this is intended for pipelines such as code generation that
+  /// emit each function as they go. A module pass between function passes
+  /// splits the pipeline and keeps every body resident until the last part.
+  void setStreamFunctions(bool Stream);
+
 private:
   /// PassManagerImpl_New is the actual class. PassManager is just the
   /// wraper to publish simple pass manager interface
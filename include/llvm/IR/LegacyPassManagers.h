@@ -224,6 +224,12 @@ public:
   void dumpPasses() const;
   void dumpArguments() const;
 
+  /// When function streaming is enabled, function pass managers materialize
+  /// each lazily loaded function just before running on it, and the last one
+  /// dematerializes it again once every function pass has run.
+  void setStreamFunctions(bool Stream) { StreamFunctions = Stream; }
+  bool shouldStreamFunctions() const { return StreamFunctions; }
+
   // Active Pass Managers
   PMStack activeStack;
 
@@ -251,6 +257,9 @@ private:
   SmallVector<ImmutablePass *, 8> ImmutablePasses;
 
   DenseMap<Pass *, AnalysisUsage *> AnUsageMap;
+
+  /// Materialize and release function bodies around function passes.
+  bool StreamFunctions;
 };
 
 
@@ -409,13 +418,18 @@ class FPPassManager : public ModulePass, public PMDataManager {
 public:
   static char ID;
   explicit FPPassManager()
-  : ModulePass(ID), PMDataManager() { }
+  : ModulePass(ID), PMDataManager(), ReleaseFunctions(true) { }
 
   /// run - Execute all of the passes scheduled for execution.  Keep track of
   /// whether any of the passes modifies the module, and if so, return true.
   bool runOnFunction(Function &F);
   bool runOnModule(Module &M) override;
 
+  /// When function streaming is enabled, release each lazily loaded body
+  /// after running on it.  Only the last function pass manager in a pipeline
+  /// does so.
+  void setReleaseFunctions(bool Release) { ReleaseFunctions = Release; }
+
   /// cleanup - After running all passes, clean up pass manager cache.
   void cleanup();
 
@@ -461,6 +475,9 @@ public:
   PassManagerType getPassManagerType() const override {
     return PMT_FunctionPassManager;
   }
+
+private:
+  bool ReleaseFunctions;
 };
 
 Timer *getPassTimer(Pass *);
@@ -73,6 +73,22 @@ struct LTOCodeGenerator {
   void setCpu(const char *mCpu) { MCpu = mCpu; }
   void setAttr(const char *mAttr) { MAttr = mAttr; }
 
+  // Set the number of partitions the optimized module is split into for code
+  // generation by compile_to_files(). Each partition is compiled on its own
+  // thread, in its own LLVMContext, into a separate object file.
+  void setCodeGenPartitions(unsigned N) { CodeGenPartitions = N ? N : 1; }
+
+  // Cache the native objects generated by compile(), compile_to_file() and
+  // compile_to_files() in the directory Dir, keyed by a hash of the merged
+  // module and of the code generation options. When the module is partitioned,
+  // each partition is cached on its own, so partitions that did not change are
+  // reused even if others did. An empty path (the default) disables the cache.
+  void setCacheDir(StringRef Dir) { CacheDir = Dir; }
+
+  // After each compile, prune the least recently used entries from the cache
+  // until it takes up no more than Bytes. Zero (the default) means no limit.
+  void setCacheSizeLimit(uint64_t Bytes) { CacheSizeLimit = Bytes; }
+
   void addMustPreserveSymbol(const char *sym) { MustPreserveSymbols[sym] = 1; }
 
   // To pass options to the driver and optimization passes. These options are
@@ -103,6 +119,19 @@ struct LTOCodeGenerator {
                        bool disableGVNLoadPRE,
                        std::string &errMsg);
 
+  // Compile the merged module into one object file per code generation
+  // partition (see setCodeGenPartitions()); the array of paths and its size
+  // are returned via "names" and "count". For a given partition count the
+  // output is the same on every run. Return true on success.
+  //
+  // As with compile_to_file(), it is up to the linker to remove the files.
+  bool compile_to_files(const char ***names,
+                        unsigned *count,
+                        bool disableOpt,
+                        bool disableInline,
+                        bool disableGVNLoadPRE,
+                        std::string &errMsg);
+
   // As with compile_to_file(), this function compiles the merged module into
   // single object file. Instead of returning the object-file-path to the caller
   // (linker), it brings the object to a buffer, and return the buffer to the
@@ -119,8 +148,15 @@ struct LTOCodeGenerator {
 private:
   void initializeLTOPasses();
 
+  bool optimize(bool disableOpt, bool disableInline, bool disableGVNLoadPRE,
+                std::string &errMsg);
   bool generateObjectFile(raw_ostream &out, bool disableOpt, bool disableInline,
                           bool disableGVNLoadPRE, std::string &errMsg);
+  bool generateCachedObjectFile(raw_ostream &out, bool disableOpt,
+                                bool disableInline, bool disableGVNLoadPRE,
+                                std::string &errMsg);
+  std::string getCacheConfig(bool disableOpt, bool disableInline,
+                             bool disableGVNLoadPRE);
   void applyScopeRestrictions();
   void applyRestriction(GlobalValue &GV, const ArrayRef<StringRef> &Libcalls,
                         std::vector<const char *> &MustPreserveList,
@@ -147,6 +183,11 @@ private:
   std::string MCpu;
   std::string MAttr;
   std::string NativeObjectPath;
+  std::vector<std::string> NativeObjectPaths;
+  std::vector<const char *> NativeObjectNames;
+  unsigned CodeGenPartitions;
+  std::string CacheDir;
+  uint64_t CacheSizeLimit;
   TargetOptions Options;
   lto_diagnostic_handler_t DiagHandler;
   void *DiagContext;
@@ -58,6 +58,9 @@ private:
   StringMap<NameAndAttributes> _undefines;
   std::vector<const char*>                _asm_undefines;
 
+  // Set once the function bodies have been read from the bitcode.
+  bool                                    _bodiesMaterialized;
+
   LTOModule(std::unique_ptr<object::IRObjectFile> Obj, TargetMachine *TM);
 
 public:
@@ -91,6 +94,7 @@ public:
                                             size_t map_size, off_t offset,
                                             TargetOptions options,
                                             std::string &errMsg);
+  /// The memory is copied, so it may be freed once the module is created.
   static LTOModule *createFromBuffer(const void *mem, size_t length,
                                      TargetOptions options, std::string &errMsg,
                                      StringRef path = "");
@@ -199,6 +203,14 @@ private:
   /// Parse i386/ppc ObjC class list data structure.
   void addObjCClassRef(const GlobalVariable *clgv);
 
+  /// Return true if a linkonce_odr definition can be hidden from other
+  /// linkage units because its address is never compared.
+  bool canBeHidden(const GlobalValue *GV);
+
+  /// Read in the function bodies that are still left in the bitcode. Only
+  /// done on demand, since symbol queries mostly need module-level records.
+  bool materializeFunctionBodies();
+
   /// Get string that the data pointer points to.
   bool objcClassNameFromExpression(const Constant *c, std::string &name);
 
@@ -10,7 +10,9 @@
 #ifndef LLVM_LINKER_LINKER_H
 #define LLVM_LINKER_LINKER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringSet.h"
 #include <string>
 
 namespace llvm {
@@ -20,6 +22,7 @@ class GlobalValue;
 class Module;
 class StringRef;
 class StructType;
+class Type;
 
 /// This class provides the core functionality of linking in LLVM. It keeps a
 /// pointer to the merged module so far. It doesn't take ownership of the
@@ -29,7 +32,8 @@ class Linker {
   public:
     enum LinkerMode {
       DestroySource = 0, // Allow source module to be destroyed.
-      PreserveSource = 1 // Preserve the source module.
+      PreserveSource = 1, // Preserve the source module.
+      LinkOnlyNeeded = 2 // Or'ed in: only link globals that are referenced.
     };
 
     Linker(Module *M, bool SuppressWarnings=false);
@@ -40,6 +44,15 @@ class Linker {
 
     /// \brief Link \p Src into the composite. The source is destroyed if
     /// \p Mode is DestroySource and preserved if it is PreserveSource.
+    ///
+    /// If \p Mode includes LinkOnlyNeeded, a global from \p Src that the
+    /// composite does not already have is copied only if it is a root symbol
+    /// (see addRootSymbol()) or is referenced by something that is copied,
+    /// much like a member of a static archive. References from metadata,
+    /// such as debug info, do not count; they are nulled out instead. Only
+    /// the function bodies that are copied get materialized. Globals in a
+    /// comdat and appending globals are always linked.
+    ///
     /// If \p ErrorMsg is not null, information about any error is written
     /// to it.
     /// Returns true on error.
@@ -51,10 +64,20 @@ class Linker {
     static bool LinkModules(Module *Dest, Module *Src, unsigned Mode,
                             std::string *ErrorMsg);
 
+    /// \brief Always link the global named \p Name when it is defined by a
+    /// module linked in with LinkOnlyNeeded.
+    void addRootSymbol(StringRef Name) { RootSymbols.insert(Name); }
+
   private:
     Module *Composite;
     SmallPtrSet<StructType*, 32> IdentifiedStructTypes;
 
+    /// Structural hashes of the types seen so far, kept across modules so that
+    /// each type is hashed once per link.
+    DenseMap<Type*, unsigned> StructuralTypeHashes;
+
+    StringSet<> RootSymbols;
+
     bool SuppressWarnings;
 };
 
@@ -41,6 +41,10 @@ class MCSymbol;
 class MCSymbolData;
 class MCValue;
 class MCAsmBackend;
+class ThreadPool;
+namespace sys {
+class MutexImpl;
+}
 
 class MCFragment : public ilist_node<MCFragment> {
   friend class MCAsmLayout;
@@ -909,6 +913,16 @@ private:
   /// By default it's 0, which means bundling is disabled.
   unsigned BundleAlignSize;
 
+  /// \brief The number of threads used to relax independent sections. One
+  /// means relaxation runs on the calling thread, zero means one thread per
+  /// hardware thread.
+  unsigned NumThreads;
+
+  /// \brief While sections are relaxed in parallel, the lock that serializes
+  /// re-encoding relaxed instructions; emitters may create expressions in the
+  /// shared MCContext. Null when relaxation runs on the calling thread.
+  sys::MutexImpl *EncoderLock;
+
   unsigned RelaxAll : 1;
   unsigned NoExecStack : 1;
   unsigned SubsectionsViaSymbols : 1;
@@ -952,13 +966,61 @@ private:
   bool fragmentNeedsRelaxation(const MCRelaxableFragment *IF,
                                const MCAsmLayout &Layout) const;
 
+  /// A fragment whose size may change during relaxation, along with the
+  /// inputs of its last relaxation check.
+  struct RelaxationCandidate {
+    MCFragment *F;
+
+    /// The fragments defining the symbols F's fixups or expression refer to.
+    SmallVector<const MCFragment *, 2> Deps;
+
+    /// The offset of each of Deps relative to F at the last check.
+    SmallVector<int64_t, 2> Distances;
+
+    /// False if F refers to something other than labels (e.g. a target
+    /// specific expression), so it has to be checked on every pass.
+    bool DepsKnown;
+
+    /// True if the last check left F unchanged. F then only needs another
+    /// check once one of Deps has moved relative to it.
+    bool UpToDate;
+  };
+  typedef std::vector<RelaxationCandidate> RelaxationWorklist;
+
+  /// \brief Add the fragments defining the labels \p Expr refers to to the
+  /// dependencies of \p C.
+  void collectRelaxationDeps(const MCExpr *Expr, RelaxationCandidate &C) const;
+
+  /// \brief Collect the fragments of \p SD that may need relaxation, in
+  /// layout order.
+  void buildRelaxationWorklist(MCSectionData &SD,
+                               RelaxationWorklist &Worklist) const;
+
+  /// \brief Check whether every fragment of \p SD that may need relaxation
+  /// only refers to labels in \p SD, so that the section can be relaxed
+  /// independently of all the others.
+  bool isSelfContained(const MCSectionData &SD,
+                       const RelaxationWorklist &Worklist) const;
+
+  /// \brief Check whether anything \p C's last relaxation check depended on
+  /// has changed since.
+  bool needsRelaxationCheck(const MCAsmLayout &Layout,
+                            const RelaxationCandidate &C) const;
+
+  /// \brief Relax the given fragment if needed and return true if its size
+  /// changed.
+  bool relaxFragment(MCAsmLayout &Layout, MCFragment &F);
+
   /// \brief Perform one layout iteration and return true if any offsets
-  /// were adjusted.
-  bool layoutOnce(MCAsmLayout &Layout);
+  /// were adjusted. Self-contained sections are relaxed on \p Pool if it is
+  /// not null.
+  bool layoutOnce(MCAsmLayout &Layout,
+                  std::vector<RelaxationWorklist> &Worklists, ThreadPool *Pool);
 
-  /// \brief Perform one layout iteration of the given section and return true
-  /// if any offsets were adjusted.
-  bool layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD);
+  /// \brief Perform one layout iteration of the section whose relaxation
+  /// candidates are \p Worklist and return true if any offsets were
+  /// adjusted.
+  bool layoutSectionOnce(MCAsmLayout &Layout, RelaxationWorklist &Worklist);
 
   bool relaxInstruction(MCAsmLayout &Layout, MCRelaxableFragment &IF);
 
@@ -1056,6 +1118,9 @@ public:
   bool getRelaxAll() const { return RelaxAll; }
   void setRelaxAll(bool Value) { RelaxAll = Value; }
 
+  unsigned getNumThreads() const { return NumThreads; }
+  void setNumThreads(unsigned Value) { NumThreads = Value; }
+
   bool getNoExecStack() const { return NoExecStack; }
   void setNoExecStack(bool Value) { NoExecStack = Value; }
 
@@ -83,15 +83,27 @@ public:
       return getHeader()->getAccessMode();
     }
     /// \return the size of the archive member without the header or padding.
-    uint64_t getSize() const { return Data.size() - StartOfFile; }
+    uint64_t getSize() const;
 
+    /// \brief Return true if the member's data is stored in a separate file
+    /// rather than in the archive itself (see Archive::isThin).
+    bool isThinMember() const;
+
+    /// \return the member's data as stored in the archive.  Members of thin
+    /// archives have no data in the archive; use getMemoryBuffer() for them.
     StringRef getBuffer() const {
+      assert(!isThinMember() && "Thin archive members have no data");
       return StringRef(Data.data() + StartOfFile, getSize());
     }
 
+    /// \brief Return the member's data.  For members of thin archives this
+    /// reads the referenced file from disk.
     ErrorOr<std::unique_ptr<MemoryBuffer>>
     getMemoryBuffer(bool FullPath = false) const;
 
+    /// \brief Return the path of the file a thin archive member refers to.
+    ErrorOr<std::string> getThinMemberPath() const;
+
     ErrorOr<std::unique_ptr<Binary>>
     getAsBinary(LLVMContext *Context = nullptr) const;
   };
@@ -177,6 +189,11 @@ public:
     return Format;
   }
 
+  /// \brief Return true if this is a GNU thin archive ("!<thin>\n").  Thin
+  /// archives store only the member headers and refer to the member files
+  /// by path.
+  bool isThin() const { return IsThin; }
+
   child_iterator child_begin(bool SkipInternal = true) const;
   child_iterator child_end() const;
 
@@ -198,6 +215,7 @@ private:
   child_iterator StringTable;
   child_iterator FirstRegular;
   Kind Format;
+  bool IsThin;
 };
 
 }
@@ -16,6 +16,7 @@
 #define LLVM_PROFILEDATA_INSTRPROF_READER_H_
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ProfileData/InstrProf.h"
 #include "llvm/Support/LineIterator.h"
@@ -205,11 +206,17 @@ enum class HashT : uint32_t;
 
 /// Trait for lookups into the on-disk hash table for the binary instrprof
 /// format.
+///
+/// Records are decoded only when they are looked up or iterated over, into a
+/// buffer that is reused for each record.
 class InstrProfLookupTrait {
   std::vector<uint64_t> CountBuffer;
+  SmallVector<char, 0> UncompressBuffer;
   IndexedInstrProf::HashT HashType;
+  uint64_t FormatVersion;
 public:
-  InstrProfLookupTrait(IndexedInstrProf::HashT HashType) : HashType(HashType) {}
+  InstrProfLookupTrait(IndexedInstrProf::HashT HashType, uint64_t FormatVersion)
+      : HashType(HashType), FormatVersion(FormatVersion) {}
 
   typedef InstrProfRecord data_type;
   typedef StringRef internal_key_type;
@@ -234,26 +241,11 @@ public:
     return StringRef((const char *)D, N);
   }
 
-  InstrProfRecord ReadData(StringRef K, const unsigned char *D, offset_type N) {
-    if (N < 2 * sizeof(uint64_t) || N % sizeof(uint64_t)) {
-      // The data is corrupt, don't try to read it.
-      CountBuffer.clear();
-      return InstrProfRecord("", 0, CountBuffer);
-    }
-
-    using namespace support;
-
-    // The first stored value is the hash.
-    uint64_t Hash = endian::readNext<uint64_t, little, unaligned>(D);
-    // Each counter follows.
-    unsigned NumCounters = N / sizeof(uint64_t) - 1;
-    CountBuffer.clear();
-    CountBuffer.reserve(NumCounters - 1);
-    for (unsigned I = 0; I < NumCounters; ++I)
-      CountBuffer.push_back(endian::readNext<uint64_t, little, unaligned>(D));
+  InstrProfRecord ReadData(StringRef K, const unsigned char *D, offset_type N);
 
-    return InstrProfRecord(K, Hash, CountBuffer);
-  }
+private:
+  bool readCounters(const unsigned char *D, offset_type N);
+  bool readEncodedCounters(const unsigned char *D, offset_type N);
 };
 typedef OnDiskIterableChainedHashTable<InstrProfLookupTrait>
     InstrProfReaderIndex;
@@ -34,14 +34,22 @@ public:
   };
 private:
   StringMap<CounterData> FunctionData;
+  bool CompressCounters;
 public:
+  InstrProfWriter() : CompressCounters(false) {}
+
+  /// Compress the counters of functions with many of them with zlib, if it
+  /// is available. Off by default.
+  void setCompressCounters(bool Compress) { CompressCounters = Compress; }
+
   /// Add function counts for the given function. If there are already counts
   /// for this function and the hash and number of counts match, each counter is
   /// summed.
   std::error_code addFunctionCounts(StringRef FunctionName,
                                     uint64_t FunctionHash,
                                     ArrayRef<uint64_t> Counters);
-  /// Ensure that all data is written to disk.
+  /// Ensure that all data is written to disk. The output only depends on the
+  /// set of functions and their counts, not on the order they were added in.
   void write(raw_fd_ostream &OS);
 };
 
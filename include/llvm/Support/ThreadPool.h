@@ -0,0 +1,95 @@
+//===-- llvm/Support/ThreadPool.h - A simple thread pool --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a simple pool of worker threads that run queued tasks.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
+#include <functional>
+#include <queue>
+#include <vector>
+
+#if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace llvm {
+
+/// ThreadPool - A pool of worker threads to which tasks can be submitted
+/// with async().  Tasks run in submission order on whichever worker becomes
+/// free first; wait() blocks until every submitted task has finished.
+///
+/// When LLVM is built without thread support, tasks are queued and run on
+/// the calling thread when wait() is called.
+class ThreadPool {
+public:
+  typedef std::function<void()> TaskTy;
+
+  /// Construct a pool with one worker per hardware thread.
+  ThreadPool();
+
+  /// Construct a pool with \p ThreadCount workers.  A count of zero uses one
+  /// worker per hardware thread.
+  explicit ThreadPool(unsigned ThreadCount);
+
+  /// Blocks until all pending tasks have run, then joins the workers.
+  ~ThreadPool();
+
+  /// Queue \p Task for execution.
+  void async(TaskTy Task);
+
+  /// Block until every task submitted so far has finished.
+  void wait();
+
+  /// Return the number of worker threads.
+  unsigned getThreadCount() const { return ThreadCount; }
+
+  /// Return the number of hardware threads, or 1 if it cannot be determined
+  /// or threading is disabled.
+  static unsigned getHardwareConcurrency();
+
+private:
+  void init(unsigned ThreadCount);
+
+  unsigned ThreadCount;
+
+  /// Tasks waiting for a worker.
+  std::queue<TaskTy> Tasks;
+
+#if LLVM_ENABLE_THREADS
+  void runWorker();
+
+  std::vector<std::thread> Threads;
+
+  /// Guards Tasks, ActiveThreads and EnableFlag.
+  std::mutex QueueLock;
+  std::condition_variable QueueCondition;
+  std::condition_variable CompletionCondition;
+
+  /// Number of workers currently running a task.
+  unsigned ActiveThreads;
+
+  /// Cleared to tell the workers to exit once the queue is empty.
+  bool EnableFlag;
+#endif
+
+  ThreadPool(const ThreadPool &) LLVM_DELETED_FUNCTION;
+  void operator=(const ThreadPool &) LLVM_DELETED_FUNCTION;
+};
+
+}
+
+#endif
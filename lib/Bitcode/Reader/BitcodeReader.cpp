@@ -1670,6 +1670,62 @@ std::error_code BitcodeReader::RememberAndSkipFunctionBody() {
   return std::error_code();
 }
 
+/// ParseFunctionIndex - Read the FUNCTION_INDEX block that follows the last
+/// function body and record where every body starts, instead of walking the
+/// function blocks one by one.  On success the stream is left just past the
+/// index, which is the last entry in the module block.
+std::error_code BitcodeReader::ParseFunctionIndex() {
+  // Index entries point at the ENTER_SUBBLOCK of each function block, while
+  // DeferredFunctionInfo wants the position just after the block ID.
+  uint64_t BodyDelta = Stream.getAbbrevIDWidth() + bitc::BlockIDWidth;
+
+  Stream.JumpToBit(FunctionIndexBit);
+  BitstreamEntry Entry = Stream.advance();
+  if (Entry.Kind != BitstreamEntry::SubBlock ||
+      Entry.ID != bitc::FUNCTION_INDEX_BLOCK_ID)
+    return Error(MalformedBlock);
+  if (Stream.EnterSubBlock(bitc::FUNCTION_INDEX_BLOCK_ID))
+    return Error(InvalidRecord);
+
+  SmallVector<uint64_t, 2> Record;
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error(MalformedBlock);
+    case BitstreamEntry::EndBlock:
+      // Every function body announced in the module header must be indexed.
+      for (unsigned i = 0, e = FunctionsWithBodies.size(); i != e; ++i)
+        if (!DeferredFunctionInfo.count(FunctionsWithBodies[i]))
+          return Error(InsufficientFunctionProtos);
+      FunctionsWithBodies.clear();
+      return std::error_code();
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default:  // Default behavior: ignore.
+      break;
+    case bitc::FNINDEX_CODE_ENTRY: { // ENTRY: [valueid, bitoffset]
+      if (Record.size() < 2)
+        return Error(InvalidRecord);
+      Function *F = nullptr;
+      if (Record[0] < ValueList.size())
+        F = dyn_cast_or_null<Function>(ValueList[Record[0]]);
+      if (!F || !F->isDeclaration())
+        return Error(InvalidRecord);
+      DeferredFunctionInfo[F] = Record[1] + BodyDelta;
+      break;
+    }
+    }
+  }
+}
+
 std::error_code BitcodeReader::GlobalCleanup() {
   // Patch the initializers for globals and aliases up.
   ResolveGlobalAndAliasInits();
@@ -1764,6 +1820,15 @@ std::error_code BitcodeReader::ParseModule(bool Resume) {
           if (std::error_code EC = GlobalCleanup())
             return EC;
           SeenFirstFunctionBody = true;
+
+          // When the whole buffer is available and the writer left an index
+          // of the function blocks, record all of them at once and continue
+          // after the index rather than skipping block by block.
+          if (FunctionIndexBit && !LazyStreamer) {
+            if (std::error_code EC = ParseFunctionIndex())
+              return EC;
+            break;
+          }
         }
 
         if (std::error_code EC = RememberAndSkipFunctionBody())
@@ -1819,6 +1884,12 @@ std::error_code BitcodeReader::ParseModule(bool Resume) {
       TheModule->setTargetTriple(S);
       break;
     }
+    case bitc::MODULE_CODE_FNINDEXOFFSET: {  // FNINDEXOFFSET: [offset]
+      if (Record.size() < 1)
+        return Error(InvalidRecord);
+      FunctionIndexBit = Record[0] * 32;
+      break;
+    }
     case bitc::MODULE_CODE_DATALAYOUT: {  // DATALAYOUT: [strchr x N]
       std::string S;
       if (ConvertToString(Record, 0, S))
@@ -3254,8 +3325,13 @@ void BitcodeReader::Dematerialize(GlobalValue *GV) {
 
   assert(DeferredFunctionInfo.count(F) && "No info to read function later?");
 
-  // Just forget the function body, we can remat it later.
-  F->deleteBody();
+  // Just forget the function body, we can remat it later. The linkage and
+  // prefix data come from the module-level function record, so keep them: a
+  // materializable declaration may have any linkage.
+  Constant *Prefix = F->hasPrefixData() ? F->getPrefixData() : nullptr;
+  F->dropAllReferences();
+  if (Prefix)
+    F->setPrefixData(Prefix);
 }
 
 std::error_code BitcodeReader::MaterializeModule(Module *M) {
@@ -1923,8 +1923,55 @@ static void WriteModuleUseLists(const Module *M, ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
+/// WriteFunctionIndexOffset - Emit a placeholder for the offset of the
+/// FUNCTION_INDEX block, which is only known once every function body has
+/// been written.  Returns the bit position of the field to backpatch.
+static uint64_t WriteFunctionIndexOffset(BitstreamWriter &Stream) {
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_FNINDEXOFFSET));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned FnIndexOffsetAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint64_t, 1> Vals;
+  Vals.push_back(0);
+  Stream.EmitRecord(bitc::MODULE_CODE_FNINDEXOFFSET, Vals,
+                    FnIndexOffsetAbbrev);
+  return Stream.GetCurrentBitNo() - 32;
+}
+
+/// WriteFunctionIndex - Emit the FUNCTION_INDEX block, which maps the value
+/// ID of every function with a body to the bit offset of its function block,
+/// and point the module's FNINDEXOFFSET record at it.
+static void
+WriteFunctionIndex(ArrayRef<std::pair<unsigned, uint64_t> > FunctionOffsets,
+                   uint64_t OffsetFieldBit, uint64_t BitcodeStartBit,
+                   BitstreamWriter &Stream) {
+  uint64_t IndexBit = Stream.GetCurrentBitNo() - BitcodeStartBit;
+  assert((IndexBit & 31) == 0 && "Function index is not word aligned!");
+  Stream.BackpatchFixed32(OffsetFieldBit, IndexBit / 32);
+
+  Stream.EnterSubblock(bitc::FUNCTION_INDEX_BLOCK_ID, 3);
+
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FNINDEX_CODE_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  unsigned EntryAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint64_t, 2> Vals;
+  for (unsigned i = 0, e = FunctionOffsets.size(); i != e; ++i) {
+    Vals.push_back(FunctionOffsets[i].first);
+    Vals.push_back(FunctionOffsets[i].second);
+    Stream.EmitRecord(bitc::FNINDEX_CODE_ENTRY, Vals, EntryAbbrev);
+    Vals.clear();
+  }
+
+  Stream.ExitBlock();
+}
+
 /// WriteModule - Emit the specified module to the bitstream.
-static void WriteModule(const Module *M, BitstreamWriter &Stream) {
+static void WriteModule(const Module *M, BitstreamWriter &Stream,
+                        uint64_t BitcodeStartBit) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   SmallVector<unsigned, 1> Vals;
@@ -1932,6 +1979,18 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   Vals.push_back(CurVersion);
   Stream.EmitRecord(bitc::MODULE_CODE_VERSION, Vals);
 
+  // Reserve room for the location of the function index if there will be
+  // any function bodies to index.
+  bool HasFunctionBodies = false;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration()) {
+      HasFunctionBodies = true;
+      break;
+    }
+  uint64_t FnIndexOffsetBit = 0;
+  if (HasFunctionBodies)
+    FnIndexOffsetBit = WriteFunctionIndexOffset(Stream);
+
   // Analyze the module, enumerating globals, functions, etc.
   ValueEnumerator VE(M);
 
@@ -1969,10 +2028,20 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   if (EnablePreserveUseListOrdering)
     WriteModuleUseLists(M, VE, Stream);
 
-  // Emit function bodies.
+  // Emit function bodies, remembering where each one starts.
+  std::vector<std::pair<unsigned, uint64_t> > FunctionOffsets;
   for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
-    if (!F->isDeclaration())
+    if (!F->isDeclaration()) {
+      FunctionOffsets.push_back(std::make_pair(
+          VE.getValueID(F), Stream.GetCurrentBitNo() - BitcodeStartBit));
       WriteFunction(*F, VE, Stream);
+    }
+
+  // The index must be the last thing in the module block: readers that use
+  // it resume parsing right after it.
+  if (HasFunctionBodies)
+    WriteFunctionIndex(FunctionOffsets, FnIndexOffsetBit, BitcodeStartBit,
+                       Stream);
 
   Stream.ExitBlock();
 }
@@ -2065,6 +2134,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
   // Emit the module into the buffer.
   {
     BitstreamWriter Stream(Buffer);
+    uint64_t BitcodeStartBit = Stream.GetCurrentBitNo();
 
     // Emit the file header.
     Stream.Emit((unsigned)'B', 8);
@@ -2075,7 +2145,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
     Stream.Emit(0xD, 4);
 
     // Emit the module.
-    WriteModule(M, Stream);
+    WriteModule(M, Stream, BitcodeStartBit);
   }
 
   if (TT.isOSDarwin())
@@ -179,16 +179,25 @@ void ValueEnumerator::print(raw_ostream &OS, const ValueMapType &Map,
 void ValueEnumerator::OptimizeConstants(unsigned CstStart, unsigned CstEnd) {
   if (CstStart == CstEnd || CstStart+1 == CstEnd) return;
 
-  std::stable_sort(Values.begin() + CstStart, Values.begin() + CstEnd,
-                   [this](const std::pair<const Value *, unsigned> &LHS,
-                          const std::pair<const Value *, unsigned> &RHS) {
-    // Sort by plane.
-    if (LHS.first->getType() != RHS.first->getType())
-      return getTypeID(LHS.first->getType()) < getTypeID(RHS.first->getType());
-    // Then by frequency.
-    return LHS.second > RHS.second;
+  // Sort by plane, then by decreasing frequency.  Look each type ID up once
+  // up front instead of twice per comparison.
+  typedef std::pair<unsigned, std::pair<const Value *, unsigned> > KeyedValue;
+  SmallVector<KeyedValue, 64> Keyed;
+  Keyed.reserve(CstEnd - CstStart);
+  for (unsigned i = CstStart; i != CstEnd; ++i)
+    Keyed.push_back(
+        std::make_pair(getTypeID(Values[i].first->getType()), Values[i]));
+
+  std::stable_sort(Keyed.begin(), Keyed.end(),
+                   [](const KeyedValue &LHS, const KeyedValue &RHS) {
+    if (LHS.first != RHS.first)
+      return LHS.first < RHS.first;
+    return LHS.second.second > RHS.second.second;
   });
 
+  for (unsigned i = 0, e = Keyed.size(); i != e; ++i)
+    Values[CstStart + i] = Keyed[i].second;
+
   // Ensure that integer and vector of integer constants are at the start of the
   // constant pool.  This is important so that GEP structure indices come before
   // gep constant exprs.
@@ -514,6 +523,10 @@ void ValueEnumerator::purgeFunction() {
   for (unsigned i = 0, e = BasicBlocks.size(); i != e; ++i)
     ValueMap.erase(BasicBlocks[i]);
 
+  // Instruction IDs are function-local; dropping them keeps the map from
+  // growing with the size of the whole module.
+  InstructionMap.clear();
+
   Values.resize(NumModuleValues);
   MDValues.resize(NumModuleMDValues);
   BasicBlocks.clear();
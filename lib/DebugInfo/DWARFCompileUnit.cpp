@@ -22,9 +22,14 @@ void DWARFCompileUnit::dump(raw_ostream &OS) {
      << " (next unit at " << format("0x%08x", getNextUnitOffset())
      << ")\n";
 
+  // Only keep this unit's DIEs while printing them, so that dumping a large
+  // file does not hold every unit in memory at once.
+  const bool ClearDIEs = extractDIEsIfNeeded(false) > 1;
   const DWARFDebugInfoEntryMinimal *CU = getCompileUnitDIE(false);
   assert(CU && "Null Compile Unit?");
   CU->dump(OS, this, -1U);
+  if (ClearDIEs)
+    clearDIEs(true);
 }
 
 // VTable anchor.
@@ -10,8 +10,10 @@
 #include "DWARFContext.h"
 #include "DWARFDebugArangeSet.h"
 
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/DebugInfo/DWARFFormValue.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Format.h"
@@ -218,6 +220,36 @@ void DWARFContext::dump(raw_ostream &OS, DIDumpType DumpType) {
   }
 }
 
+bool DWARFContext::dumpEntriesForAddress(raw_ostream &OS, uint64_t Address) {
+  DWARFCompileUnit *CU = getCompileUnitForAddress(Address);
+  if (!CU)
+    return false;
+  CU->getCompileUnitDIE()->dump(OS, CU, 0);
+
+  DWARFUnit *SubprogramUnit;
+  const DWARFDebugInfoEntryMinimal *Subprogram =
+      CU->findSubprogramForAddress(Address, SubprogramUnit);
+  if (Subprogram)
+    Subprogram->dump(OS, SubprogramUnit, -1U, 2);
+  return true;
+}
+
+bool DWARFContext::dumpEntriesForName(raw_ostream &OS, StringRef Name) {
+  bool Found = false;
+  for (uint32_t Offset : getDIEOffsetsForName(Name)) {
+    DWARFCompileUnit *CU = getCompileUnitForOffset(Offset);
+    if (!CU)
+      continue;
+    const DWARFDebugInfoEntryMinimal *DIE = CU->getDIEForOffset(Offset);
+    if (!DIE)
+      continue;
+    CU->getCompileUnitDIE()->dump(OS, CU, 0);
+    DIE->dump(OS, CU, -1U, 2);
+    Found = true;
+  }
+  return Found;
+}
+
 const DWARFDebugAbbrev *DWARFContext::getDebugAbbrev() {
   if (Abbrev)
     return Abbrev.get();
@@ -410,14 +442,106 @@ namespace {
 DWARFCompileUnit *DWARFContext::getCompileUnitForOffset(uint32_t Offset) {
   parseCompileUnits();
 
+  // Find the last unit starting at or before Offset.
   std::unique_ptr<DWARFCompileUnit> *CU =
-      std::lower_bound(CUs.begin(), CUs.end(), Offset, OffsetComparator());
-  if (CU != CUs.end()) {
+      std::upper_bound(CUs.begin(), CUs.end(), Offset, OffsetComparator());
+  if (CU != CUs.begin() && Offset < (*--CU)->getNextUnitOffset())
     return CU->get();
-  }
   return nullptr;
 }
 
+/// Add the entries of a .debug_pubnames or .debug_gnu_pubnames section to
+/// \p Index, recording the compile units it describes in \p CUOffsets.
+static void extractPubNames(StringRef Data, bool LittleEndian, bool GnuStyle,
+                            StringMap<SmallVector<uint32_t, 1> > &Index,
+                            DenseSet<uint32_t> &CUOffsets) {
+  DataExtractor PubNames(Data, LittleEndian, 0);
+  uint32_t Offset = 0;
+  while (PubNames.isValidOffset(Offset)) {
+    uint32_t Length = PubNames.getU32(&Offset);
+    uint32_t SetEnd = Offset + Length;
+    PubNames.getU16(&Offset); // Version.
+    uint32_t UnitOffset = PubNames.getU32(&Offset);
+    PubNames.getU32(&Offset); // Unit size.
+    if (Length == 0 || SetEnd > Data.size())
+      break;
+    CUOffsets.insert(UnitOffset);
+    while (Offset < SetEnd) {
+      uint32_t DIERef = PubNames.getU32(&Offset);
+      if (DIERef == 0)
+        break;
+      if (GnuStyle)
+        PubNames.getU8(&Offset); // Index entry descriptor.
+      Index[PubNames.getCStr(&Offset)].push_back(UnitOffset + DIERef);
+    }
+    Offset = SetEnd;
+  }
+}
+
+/// Add the named subprogram and variable definitions below \p DIE to
+/// \p Index, descending into namespaces.
+static void indexDIENames(DWARFCompileUnit *CU,
+                          const DWARFDebugInfoEntryMinimal *DIE,
+                          StringMap<SmallVector<uint32_t, 1> > &Index) {
+  for (const DWARFDebugInfoEntryMinimal *Child = DIE->getFirstChild();
+       Child && !Child->isNULL(); Child = Child->getSibling()) {
+    switch (Child->getTag()) {
+    case DW_TAG_namespace:
+      indexDIENames(CU, Child, Index);
+      break;
+    case DW_TAG_subprogram: {
+      if (Child->getAddressRanges(CU).empty())
+        break;
+      const char *Name =
+          Child->getSubroutineName(CU, FunctionNameKind::ShortName);
+      const char *LinkageName =
+          Child->getSubroutineName(CU, FunctionNameKind::LinkageName);
+      if (Name)
+        Index[Name].push_back(Child->getOffset());
+      if (LinkageName && (!Name || strcmp(Name, LinkageName) != 0))
+        Index[LinkageName].push_back(Child->getOffset());
+      break;
+    }
+    case DW_TAG_variable: {
+      DWARFFormValue Declaration;
+      if (Child->getAttributeValue(CU, DW_AT_declaration, Declaration))
+        break;
+      if (const char *Name =
+              Child->getAttributeValueAsString(CU, DW_AT_name, nullptr))
+        Index[Name].push_back(Child->getOffset());
+      break;
+    }
+    }
+  }
+}
+
+void DWARFContext::buildNameIndex() {
+  NameIndex.reset(new NameIndexTy());
+  DenseSet<uint32_t> IndexedCUOffsets;
+  extractPubNames(getPubNamesSection(), isLittleEndian(), false, *NameIndex,
+                  IndexedCUOffsets);
+  extractPubNames(getGnuPubNamesSection(), isLittleEndian(), true, *NameIndex,
+                  IndexedCUOffsets);
+
+  // As with .debug_aranges, the public name tables may describe only some of
+  // the compile units; walk the DIEs of the others.
+  for (const auto &CU : compile_units()) {
+    if (IndexedCUOffsets.count(CU->getOffset()))
+      continue;
+    if (const DWARFDebugInfoEntryMinimal *CUDie = CU->getCompileUnitDIE(false))
+      indexDIENames(CU.get(), CUDie, *NameIndex);
+  }
+}
+
+ArrayRef<uint32_t> DWARFContext::getDIEOffsetsForName(StringRef Name) {
+  if (!NameIndex)
+    buildNameIndex();
+  NameIndexTy::const_iterator I = NameIndex->find(Name);
+  if (I == NameIndex->end())
+    return ArrayRef<uint32_t>();
+  return I->second;
+}
+
 DWARFCompileUnit *DWARFContext::getCompileUnitForAddress(uint64_t Address) {
   // First, get the offset of the compile unit.
   uint32_t CUOffset = getDebugAranges()->findAddress(Address);
@@ -17,8 +17,10 @@
 #include "DWARFDebugLoc.h"
 #include "DWARFDebugRangeList.h"
 #include "DWARFTypeUnit.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/DebugInfo/DIContext.h"
 
 namespace llvm {
@@ -39,6 +41,11 @@ class DWARFContext : public DIContext {
   std::unique_ptr<DWARFDebugLine> Line;
   std::unique_ptr<DWARFDebugFrame> DebugFrame;
 
+  /// Maps names to the offsets of the DIEs that define them. Built on the
+  /// first name lookup.
+  typedef StringMap<SmallVector<uint32_t, 1> > NameIndexTy;
+  std::unique_ptr<NameIndexTy> NameIndex;
+
   CUVector DWOCUs;
   TUVector DWOTUs;
   std::unique_ptr<DWARFDebugAbbrev> AbbrevDWO;
@@ -63,6 +70,10 @@ class DWARFContext : public DIContext {
   /// and store them in DWOTUs.
   void parseDWOTypeUnits();
 
+  /// Fill NameIndex from the public name tables, falling back to the DIEs
+  /// of compile units the tables do not describe.
+  void buildNameIndex();
+
 public:
   struct Section {
     StringRef Data;
@@ -77,6 +88,9 @@ public:
 
   void dump(raw_ostream &OS, DIDumpType DumpType = DIDT_All) override;
 
+  bool dumpEntriesForAddress(raw_ostream &OS, uint64_t Address) override;
+  bool dumpEntriesForName(raw_ostream &OS, StringRef Name) override;
+
   typedef iterator_range<CUVector::iterator> cu_iterator_range;
   typedef iterator_range<TUVector::iterator> tu_iterator_range;
 
@@ -158,6 +172,15 @@ public:
   /// Get a pointer to the parsed frame information object.
   const DWARFDebugFrame *getDebugFrame();
 
+  /// Return the compile unit that includes an offset (relative to .debug_info).
+  DWARFCompileUnit *getCompileUnitForOffset(uint32_t Offset);
+
+  /// Return the offsets (relative to .debug_info) of the subprogram and
+  /// variable DIEs named \p Name. Uses .debug_pubnames and
+  /// .debug_gnu_pubnames where present, so only the DIEs of units they do
+  /// not cover are parsed.
+  ArrayRef<uint32_t> getDIEOffsetsForName(StringRef Name);
+
   /// Get a pointer to a parsed line table corresponding to a compile unit.
   const DWARFDebugLine::LineTable *
   getLineTableForCompileUnit(DWARFCompileUnit *cu);
@@ -202,9 +225,6 @@ public:
     return version == 2 || version == 3 || version == 4;
   }
 private:
-  /// Return the compile unit that includes an offset (relative to .debug_info).
-  DWARFCompileUnit *getCompileUnitForOffset(uint32_t Offset);
-
   /// Return the compile unit which contains instruction with provided
   /// address.
   DWARFCompileUnit *getCompileUnitForAddress(uint64_t Address);
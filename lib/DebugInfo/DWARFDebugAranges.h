@@ -23,14 +23,19 @@ public:
   void generate(DWARFContext *CTX);
   uint32_t findAddress(uint64_t Address) const;
 
+  // Call appendRange multiple times and then call construct.  The offsets
+  // need not be compile unit offsets: units also use this to index their
+  // subprogram DIEs.  Where ranges overlap, an address belongs to the range
+  // built up to just below it if that range's offset still covers it, so a
+  // range that starts first keeps the overlap.  Otherwise the lowest offset
+  // covering the address wins.
+  void appendRange(uint32_t CUOffset, uint64_t LowPC, uint64_t HighPC);
+  void construct();
+
 private:
   void clear();
   void extract(DataExtractor DebugArangesData);
 
-  // Call appendRange multiple times and then call construct.
-  void appendRange(uint32_t CUOffset, uint64_t LowPC, uint64_t HighPC);
-  void construct();
-
   struct Range {
     explicit Range(uint64_t LowPC = -1ULL, uint64_t HighPC = -1ULL,
                    uint32_t CUOffset = -1U)
@@ -33,7 +33,10 @@ void DWARFTypeUnit::dump(raw_ostream &OS) {
      << " (next unit at " << format("0x%08x", getNextUnitOffset())
      << ")\n";
 
+  const bool ClearDIEs = extractDIEsIfNeeded(false) > 1;
   const DWARFDebugInfoEntryMinimal *CU = getCompileUnitDIE(false);
   assert(CU && "Null Compile Unit?");
   CU->dump(OS, this, -1U);
+  if (ClearDIEs)
+    clearDIEs(true);
 }
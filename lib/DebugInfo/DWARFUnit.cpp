@@ -12,6 +12,7 @@
 #include "llvm/DebugInfo/DWARFFormValue.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <cstdio>
 
 using namespace llvm;
@@ -290,6 +291,7 @@ void DWARFUnit::clearDIEs(bool KeepCUDie) {
     // contents.
     std::vector<DWARFDebugInfoEntryMinimal> TmpArray;
     DieArray.swap(TmpArray);
+    SubprogramAranges.reset();
     // Save at least the compile unit DIE
     if (KeepCUDie)
       DieArray.push_back(TmpArray.front());
@@ -326,36 +328,73 @@ void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
     clearDIEs(true);
 }
 
-const DWARFDebugInfoEntryMinimal *
-DWARFUnit::getSubprogramForAddress(uint64_t Address) {
+namespace {
+struct DIEOffsetComparator {
+  bool operator()(const DWARFDebugInfoEntryMinimal &LHS, uint32_t RHS) const {
+    return LHS.getOffset() < RHS;
+  }
+};
+}
+
+const DWARFDebugInfoEntryMinimal *DWARFUnit::getDIEForOffset(uint32_t Offset) {
   extractDIEsIfNeeded(false);
+  // DIEs are extracted in section order, so DieArray is sorted by offset.
+  auto It = std::lower_bound(DieArray.begin(), DieArray.end(), Offset,
+                             DIEOffsetComparator());
+  if (It != DieArray.end() && It->getOffset() == Offset)
+    return &*It;
+  return nullptr;
+}
+
+void DWARFUnit::buildSubprogramAranges() {
+  SubprogramAranges.reset(new DWARFDebugAranges());
   for (const DWARFDebugInfoEntryMinimal &DIE : DieArray) {
-    if (DIE.isSubprogramDIE() &&
-        DIE.addressRangeContainsAddress(this, Address)) {
-      return &DIE;
-    }
+    if (!DIE.isSubprogramDIE())
+      continue;
+    for (const auto &R : DIE.getAddressRanges(this))
+      SubprogramAranges->appendRange(DIE.getOffset(), R.first, R.second);
   }
-  return nullptr;
+  SubprogramAranges->construct();
 }
 
-DWARFDebugInfoEntryInlinedChain
-DWARFUnit::getInlinedChainForAddress(uint64_t Address) {
-  // First, find a subprogram that contains the given address (the root
-  // of inlined chain).
-  const DWARFUnit *ChainCU = nullptr;
+const DWARFDebugInfoEntryMinimal *
+DWARFUnit::getSubprogramForAddress(uint64_t Address) {
+  extractDIEsIfNeeded(false);
+  if (!SubprogramAranges)
+    buildSubprogramAranges();
+  uint32_t DIEOffset = SubprogramAranges->findAddress(Address);
+  if (DIEOffset == -1U)
+    return nullptr;
+  return getDIEForOffset(DIEOffset);
+}
+
+const DWARFDebugInfoEntryMinimal *
+DWARFUnit::findSubprogramForAddress(uint64_t Address,
+                                    DWARFUnit *&SubprogramUnit) {
+  SubprogramUnit = nullptr;
   const DWARFDebugInfoEntryMinimal *SubprogramDIE =
       getSubprogramForAddress(Address);
   if (SubprogramDIE) {
-    ChainCU = this;
+    SubprogramUnit = this;
   } else {
     // Try to look for subprogram DIEs in the DWO file.
     parseDWO();
     if (DWO.get()) {
       SubprogramDIE = DWO->getUnit()->getSubprogramForAddress(Address);
       if (SubprogramDIE)
-        ChainCU = DWO->getUnit();
+        SubprogramUnit = DWO->getUnit();
     }
   }
+  return SubprogramDIE;
+}
+
+DWARFDebugInfoEntryInlinedChain
+DWARFUnit::getInlinedChainForAddress(uint64_t Address) {
+  // First, find a subprogram that contains the given address (the root
+  // of inlined chain).
+  DWARFUnit *ChainCU;
+  const DWARFDebugInfoEntryMinimal *SubprogramDIE =
+      findSubprogramForAddress(Address, ChainCU);
 
   // Get inlined chain rooted at this subprogram DIE.
   if (!SubprogramDIE)
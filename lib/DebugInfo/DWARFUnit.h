@@ -11,6 +11,7 @@
 #define LLVM_DEBUGINFO_DWARFUNIT_H
 
 #include "DWARFDebugAbbrev.h"
+#include "DWARFDebugAranges.h"
 #include "DWARFDebugInfoEntry.h"
 #include "DWARFDebugRangeList.h"
 #include "DWARFRelocMap.h"
@@ -46,6 +47,9 @@ class DWARFUnit {
   uint64_t BaseAddr;
   // The compile unit debug information entry items.
   std::vector<DWARFDebugInfoEntryMinimal> DieArray;
+  // Maps addresses to the subprogram DIEs that cover them. Built on the first
+  // address query and dropped together with the DIEs.
+  std::unique_ptr<DWARFDebugAranges> SubprogramAranges;
 
   class DWOHolder {
     std::unique_ptr<object::ObjectFile> DWOFile;
@@ -121,6 +125,11 @@ public:
     return DieArray.empty() ? nullptr : &DieArray[0];
   }
 
+  /// getDIEForOffset - Returns the DIE at the given offset (relative to the
+  /// start of the section), or null if this unit has no DIE there. Parses
+  /// all DIEs of the unit if necessary.
+  const DWARFDebugInfoEntryMinimal *getDIEForOffset(uint32_t Offset);
+
   const char *getCompilationDir();
   uint64_t getDWOId();
 
@@ -131,13 +140,23 @@ public:
   /// chain is valid as long as parsed compile unit DIEs are not cleared.
   DWARFDebugInfoEntryInlinedChain getInlinedChainForAddress(uint64_t Address);
 
-private:
-  /// Size in bytes of the .debug_info data associated with this compile unit.
-  size_t getDebugInfoSize() const { return Length + 4 - getHeaderSize(); }
+  /// findSubprogramForAddress - Returns the subprogram DIE with address range
+  /// encompassing the provided address, looking in the .dwo file if this
+  /// unit has none, and sets \p SubprogramUnit to the unit that owns it.
+  const DWARFDebugInfoEntryMinimal *
+  findSubprogramForAddress(uint64_t Address, DWARFUnit *&SubprogramUnit);
 
+protected:
   /// extractDIEsIfNeeded - Parses a compile unit and indexes its DIEs if it
   /// hasn't already been done. Returns the number of DIEs parsed at this call.
   size_t extractDIEsIfNeeded(bool CUDieOnly);
+  /// clearDIEs - Clear parsed DIEs to keep memory usage low.
+  void clearDIEs(bool KeepCUDie);
+
+private:
+  /// Size in bytes of the .debug_info data associated with this compile unit.
+  size_t getDebugInfoSize() const { return Length + 4 - getHeaderSize(); }
+
   /// extractDIEsToVector - Appends all parsed DIEs to a vector.
   void extractDIEsToVector(bool AppendCUDie, bool AppendNonCUDIEs,
                            std::vector<DWARFDebugInfoEntryMinimal> &DIEs) const;
@@ -145,8 +164,6 @@ private:
   /// of DIE entries and now we need to go back through all of them and set the
   /// parent, sibling and child pointers for quick DIE navigation.
   void setDIERelations();
-  /// clearDIEs - Clear parsed DIEs to keep memory usage low.
-  void clearDIEs(bool KeepCUDie);
 
   /// parseDWO - Parses .dwo file for current compile unit. Returns true if
   /// it was actually constructed.
@@ -156,6 +173,10 @@ private:
   /// encompassing the provided address. The pointer is alive as long as parsed
   /// compile unit DIEs are not cleared.
   const DWARFDebugInfoEntryMinimal *getSubprogramForAddress(uint64_t Address);
+
+  /// buildSubprogramAranges - Indexes the address ranges of all subprogram
+  /// DIEs so getSubprogramForAddress does not have to scan the unit.
+  void buildSubprogramAranges();
 };
 
 }
@@ -39,7 +39,19 @@ static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
 //===----------------------------------------------------------------------===//
 
 static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+  SF.getValue(V) = Val;
+}
+
+/// Give each argument and non-void instruction of F that does not have a slot
+/// yet the next free one.
+static void numberValues(Function *F, ValueSlotMap &Slots) {
+  for (Function::arg_iterator AI = F->arg_begin(), E = F->arg_end(); AI != E;
+       ++AI)
+    Slots.insert(std::make_pair(AI, Slots.size()));
+  for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I)
+      if (!I->getType()->isVoidTy())
+        Slots.insert(std::make_pair(I, Slots.size()));
 }
 
 //===----------------------------------------------------------------------===//
@@ -1092,6 +1104,14 @@ void Interpreter::visitCallSite(CallSite CS) {
         --me;
       IL->LowerIntrinsicCall(cast<CallInst>(CS.getInstruction()));
 
+      // Number the instructions the lowering inserted, and make room for them
+      // in every frame of this function.
+      ValueSlotMap &Slots = *SF.Slots;
+      numberValues(SF.CurFunction, Slots);
+      for (unsigned i = 0, e = ECStack.size(); i != e; ++i)
+        if (ECStack[i].Slots == &Slots)
+          ECStack[i].Values.resize(Slots.size());
+
       // Restore the CurInst pointer to the first instruction newly inserted, if
       // any.
       if (atBegin) {
@@ -2061,7 +2081,7 @@ GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
   } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
     return PTOGV(getPointerToGlobal(GV));
   } else {
-    return SF.Values[V];
+    return SF.getValue(V);
   }
 }
 
@@ -2069,6 +2089,13 @@ GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
 //                        Dispatch and Execution Code
 //===----------------------------------------------------------------------===//
 
+ValueSlotMap &Interpreter::getFunctionSlots(Function *F) {
+  ValueSlotMap &Slots = FunctionSlots[F];
+  if (Slots.empty())
+    numberValues(F, Slots);
+  return Slots;
+}
+
 //===----------------------------------------------------------------------===//
 // callFunction - Execute the specified function...
 //
@@ -2094,6 +2121,10 @@ void Interpreter::callFunction(Function *F,
   StackFrame.CurBB     = F->begin();
   StackFrame.CurInst   = StackFrame.CurBB->begin();
 
+  // Allocate a slot for every argument and instruction result up front.
+  StackFrame.Slots = &getFunctionSlots(F);
+  StackFrame.Values.resize(StackFrame.Slots->size());
+
   // Run through the function arguments and initialize their values...
   assert((ArgVals.size() == F->arg_size() ||
          (ArgVals.size() > F->arg_size() && F->getFunctionType()->isVarArg()))&&
@@ -2127,7 +2158,7 @@ DEBUG(
     if (!isa<CallInst>(I) && !isa<InvokeInst>(I) && 
         I.getType() != Type::VoidTy) {
       dbgs() << "  --> ";
-      const GenericValue &Val = SF.Values[&I];
+      const GenericValue &Val = SF.getValue(&I);
       switch (I.getType()->getTypeID()) {
       default: llvm_unreachable("Invalid GenericValue Type");
       case Type::VoidTyID:    dbgs() << "void"; break;
@@ -14,6 +14,7 @@
 #ifndef LLI_INTERPRETER_H
 #define LLI_INTERPRETER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/CallSite.h"
@@ -26,7 +27,6 @@
 namespace llvm {
 
 class IntrinsicLowering;
-struct FunctionInfo;
 template<typename T> class generic_gep_type_iterator;
 class ConstantExpr;
 typedef generic_gep_type_iterator<User::const_op_iterator> gep_type_iterator;
@@ -64,6 +64,11 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// ValueSlotMap - Numbers the arguments and instructions of a function, so that
+// each stack frame can keep their values in a vector instead of a map.
+//
+typedef DenseMap<const Value *, unsigned> ValueSlotMap;
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
@@ -71,11 +76,23 @@ struct ExecutionContext {
   Function             *CurFunction;// The currently executing function
   BasicBlock           *CurBB;      // The currently executing BB
   BasicBlock::iterator  CurInst;    // The next instruction to execute
-  std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
+  ValueSlotMap         *Slots;      // Slot numbers for CurFunction's values
+  ValuePlaneTy          Values;     // LLVM values used in this invocation,
+                                    // indexed by slot number
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
   AllocaHolderHandle    Allocas;    // Track memory allocated by alloca
+
+  ExecutionContext() : CurFunction(nullptr), CurBB(nullptr), Slots(nullptr) {}
+
+  // getValue - Return the value of V in this frame.  Every argument and
+  // instruction result of CurFunction has a slot by the time it is used.
+  GenericValue &getValue(const Value *V) {
+    ValueSlotMap::const_iterator I = Slots->find(V);
+    assert(I != Slots->end() && "Value has no slot in this frame!");
+    return Values[I->second];
+  }
 };
 
 // Interpreter - This class represents the entirety of the interpreter.
@@ -93,6 +110,10 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // FunctionSlots - Slot numbers for the values of each function called so
+  // far.  A std::map keeps the slot maps in place while frames point to them.
+  std::map<const Function *, ValueSlotMap> FunctionSlots;
+
 public:
   explicit Interpreter(Module *M);
   ~Interpreter();
@@ -212,6 +233,10 @@ private:  // Helper functions
   //
   void SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF);
 
+  // getFunctionSlots - Return the slot numbers for the arguments and
+  // instructions of F, numbering them on the first call.
+  ValueSlotMap &getFunctionSlots(Function *F);
+
   void *getPointerToFunction(Function *F) override { return (void*)F; }
   void *getPointerToBasicBlock(BasicBlock *BB) override { return (void*)BB; }
 
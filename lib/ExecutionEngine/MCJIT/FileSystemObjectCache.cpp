@@ -0,0 +1,289 @@
+//===-- FileSystemObjectCache.cpp - On-disk object cache ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements an ObjectCache that keeps compiled objects in a
+// directory so that they can be reused by later processes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileSystemObjectCache.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <vector>
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+using namespace llvm;
+
+static const char EntryPrefix[] = "llvmcache-";
+static const char EntrySuffix[] = ".o";
+static const char TempSuffix[] = ".tmp";
+
+/// Temporaries older than this were left behind by a process that died
+/// before renaming them into place.
+static const uint64_t StaleTempSeconds = 60 * 60;
+
+FileSystemObjectCache::FileSystemObjectCache(StringRef CacheDir,
+                                             const TargetMachine &TM,
+                                             uint64_t MaxSize)
+    : CacheDir(CacheDir), MaxSize(MaxSize) {
+  // Everything about the compiler and target that changes the generated code.
+  const TargetOptions &Opts = TM.Options;
+  raw_string_ostream OS(TargetKey);
+  OS << PACKAGE_VERSION << '\0';
+#ifdef LLVM_VERSION_INFO
+  OS << LLVM_VERSION_INFO << '\0';
+#endif
+  OS << TM.getTargetTriple() << '\0' << TM.getTargetCPU() << '\0'
+     << TM.getTargetFeatureString() << '\0' << (int)TM.getRelocationModel()
+     << ' ' << (int)TM.getCodeModel() << ' ' << (int)TM.getOptLevel() << ' '
+     << Opts.NoFramePointerElim << Opts.LessPreciseFPMADOption
+     << Opts.UnsafeFPMath << Opts.NoInfsFPMath << Opts.NoNaNsFPMath
+     << Opts.HonorSignDependentRoundingFPMathOption << Opts.UseSoftFloat
+     << Opts.NoZerosInBSS << Opts.JITEmitDebugInfo
+     << Opts.GuaranteedTailCallOpt << Opts.DisableTailCalls
+     << Opts.EnableFastISel << Opts.PositionIndependentExecutable
+     << Opts.UseInitArray << Opts.FunctionSections << Opts.DataSections
+     << Opts.TrapUnreachable << ' ' << Opts.StackAlignmentOverride << ' '
+     << (int)Opts.FloatABIType << ' ' << (int)Opts.AllowFPOpFusion;
+  OS.flush();
+
+  sys::fs::create_directories(this->CacheDir);
+}
+
+FileSystemObjectCache::~FileSystemObjectCache() {
+  for (DenseMap<const Module*, PendingEntry>::iterator I = Pending.begin(),
+                                                       E = Pending.end();
+       I != E; ++I)
+    delete I->second.Locker;
+}
+
+bool FileSystemObjectCache::computeKey(const Module *M, SmallString<32> &Key) {
+  // The bitcode writer needs every function body in memory.
+  if (M->getMaterializer() &&
+      const_cast<Module*>(M)->materializeAllPermanently())
+    return false;
+
+  std::string Bitcode;
+  raw_string_ostream OS(Bitcode);
+  WriteBitcodeToFile(M, OS);
+  OS.flush();
+
+  MD5 Hash;
+  Hash.update(TargetKey);
+  Hash.update(Bitcode);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  MD5::stringifyResult(Result, Key);
+  return true;
+}
+
+std::string FileSystemObjectCache::getEntryPath(StringRef Key) {
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, Twine(EntryPrefix) + Key + EntrySuffix);
+  return Path.str();
+}
+
+MemoryBuffer *FileSystemObjectCache::readEntry(StringRef Path) {
+  int FD;
+  if (sys::fs::openFileForRead(Path, FD))
+    return nullptr;
+
+  // Reads count as uses for eviction.
+  sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+
+  ErrorOr<std::unique_ptr<MemoryBuffer> > Buffer =
+      MemoryBuffer::getOpenFile(FD, Path.str().c_str(), -1, false);
+  ::close(FD);
+  if (!Buffer)
+    return nullptr;
+
+  // A damaged entry would only make MCJIT fail to load it; drop it and let
+  // the caller compile the module again.
+  std::unique_ptr<MemoryBuffer> Contents(MemoryBuffer::getMemBuffer(
+      Buffer.get()->getBuffer(), Path, /*RequiresNullTerminator=*/false));
+  ErrorOr<object::ObjectFile *> Obj =
+      object::ObjectFile::createObjectFile(Contents);
+  if (!Obj) {
+    sys::fs::remove(Path);
+    return nullptr;
+  }
+  delete Obj.get();
+
+  // MCJIT writes into the object as it loads it, so hand out a copy rather
+  // than the mapped file.
+  return MemoryBuffer::getMemBufferCopy(Buffer.get()->getBuffer());
+}
+
+MemoryBuffer *FileSystemObjectCache::getObject(const Module *M) {
+  SmallString<32> Key;
+  if (!computeKey(M, Key))
+    return nullptr;
+  std::string Path = getEntryPath(Key);
+  if (MemoryBuffer *Obj = readEntry(Path))
+    return Obj;
+
+  MutexGuard Guard(Lock);
+
+  // An identical module may already be compiling in this process; the lock
+  // file cannot tell that apart from another process, so don't wait on it.
+  bool CompilingHere = false;
+  for (DenseMap<const Module*, PendingEntry>::iterator I = Pending.begin(),
+                                                       E = Pending.end();
+       I != E; ++I)
+    if (I->second.Key == Key)
+      CompilingHere = true;
+
+  std::unique_ptr<LockFileManager> Locker;
+  if (!CompilingHere) {
+    sys::fs::create_directories(CacheDir);
+    Locker.reset(new LockFileManager(Path));
+    switch (Locker->getState()) {
+    case LockFileManager::LFS_Owned:
+      // Our caller compiles the module; keep the lock until it is stored.
+      break;
+    case LockFileManager::LFS_Shared:
+      // Another process is compiling the same entry.  Wait and use its
+      // result if it produced one.
+      Locker->waitForUnlock();
+      Locker.reset();
+      if (MemoryBuffer *Obj = readEntry(Path))
+        return Obj;
+      break;
+    case LockFileManager::LFS_Error:
+      Locker.reset();
+      break;
+    }
+  }
+
+  PendingEntry &Entry = Pending[M];
+  delete Entry.Locker;
+  Entry.Key = Key;
+  Entry.Locker = Locker.release();
+  return nullptr;
+}
+
+void FileSystemObjectCache::notifyObjectCompiled(const Module *M,
+                                                 const MemoryBuffer *Obj) {
+  SmallString<32> Key;
+  std::unique_ptr<LockFileManager> Locker;
+  {
+    MutexGuard Guard(Lock);
+    DenseMap<const Module*, PendingEntry>::iterator I = Pending.find(M);
+    if (I != Pending.end()) {
+      Key = I->second.Key;
+      Locker.reset(I->second.Locker);
+      Pending.erase(I);
+    }
+  }
+  if (Key.empty() && !computeKey(M, Key))
+    return;
+
+  // Write to a unique temporary and rename it into place, so that readers
+  // see either the whole object or nothing.
+  std::string Path = getEntryPath(Key);
+  sys::fs::create_directories(CacheDir);
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::createUniqueFile(Path + "-%%%%%%" + TempSuffix, FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS.write(Obj->getBufferStart(), Obj->getBufferSize());
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath.str());
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath.str(), Path)) {
+    sys::fs::remove(TempPath.str());
+    return;
+  }
+
+  // Release the entry before pruning so waiting processes can proceed.
+  Locker.reset();
+  prune();
+}
+
+namespace {
+struct CacheEntry {
+  std::string Path;
+  uint64_t Size;
+  sys::TimeValue LastUse;
+};
+
+bool isLessRecentlyUsed(const CacheEntry &A, const CacheEntry &B) {
+  return A.LastUse < B.LastUse;
+}
+}
+
+void FileSystemObjectCache::prune() {
+  // One process prunes at a time; whoever holds the lock does the work.
+  SmallString<128> LockPath(CacheDir);
+  sys::path::append(LockPath, Twine(EntryPrefix) + "prune");
+  LockFileManager Locker(LockPath);
+  if (Locker.getState() != LockFileManager::LFS_Owned)
+    return;
+
+  sys::TimeValue StaleBefore =
+      sys::TimeValue::now() - sys::TimeValue(StaleTempSeconds, 0);
+  std::vector<CacheEntry> Entries;
+  uint64_t TotalSize = 0;
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+       I.increment(EC)) {
+    StringRef Name = sys::path::filename(I->path());
+    if (!Name.startswith(EntryPrefix))
+      continue;
+    sys::fs::file_status Status;
+    if (I->status(Status))
+      continue;
+
+    // A temporary may still be being written by another process; only old
+    // ones are removed, and the rest count towards the limit.
+    if (Name.endswith(TempSuffix)) {
+      if (Status.getLastModificationTime() < StaleBefore &&
+          !sys::fs::remove(I->path()))
+        continue;
+      TotalSize += Status.getSize();
+      continue;
+    }
+    if (!Name.endswith(EntrySuffix))
+      continue;
+    CacheEntry Entry;
+    Entry.Path = I->path();
+    Entry.Size = Status.getSize();
+    Entry.LastUse = Status.getLastModificationTime();
+    Entries.push_back(Entry);
+    TotalSize += Entry.Size;
+  }
+  if (!MaxSize || TotalSize <= MaxSize)
+    return;
+
+  std::sort(Entries.begin(), Entries.end(), isLessRecentlyUsed);
+  for (unsigned i = 0, e = Entries.size(); i != e && TotalSize > MaxSize; ++i)
+    if (!sys::fs::remove(Entries[i].Path))
+      TotalSize -= Entries[i].Size;
+}
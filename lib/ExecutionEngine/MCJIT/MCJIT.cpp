@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "MCJIT.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
@@ -16,8 +17,10 @@
 #include "llvm/ExecutionEngine/ObjectImage.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Mangler.h"
 #include "llvm/IR/Module.h"
 #include "llvm/MC/MCAsmInfo.h"
@@ -27,7 +30,11 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetLowering.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
 
 using namespace llvm;
 
@@ -58,7 +65,7 @@ ExecutionEngine *MCJIT::createJIT(Module *M,
 
 MCJIT::MCJIT(Module *m, TargetMachine *tm, RTDyldMemoryManager *MM,
              bool AllocateGVsWithCode)
-  : ExecutionEngine(m), TM(tm), Ctx(nullptr), MemMgr(this, MM), Dyld(&MemMgr),
+  : ExecutionEngine(m), TM(tm), MemMgr(this, MM), Dyld(&MemMgr),
     ObjCache(nullptr) {
 
   OwnedModules.addModule(m);
@@ -67,6 +74,12 @@ MCJIT::MCJIT(Module *m, TargetMachine *tm, RTDyldMemoryManager *MM,
 
 MCJIT::~MCJIT() {
   MutexGuard locked(lock);
+
+  // Let the workers finish before the modules they compile go away.
+  if (CompilePool)
+    CompilePool->wait();
+  while (!PendingCompiles.empty())
+    discardBackgroundObject(PendingCompiles.begin()->first);
   // FIXME: We are managing our modules, so we do not want the base class
   // ExecutionEngine to manage them as well. To avoid double destruction
   // of the first (and only) module added in ExecutionEngine constructor
@@ -98,19 +111,147 @@ MCJIT::~MCJIT() {
   }
   Archives.clear();
 
+  for (unsigned i = 0, e = LazyFunctions.size(); i != e; ++i)
+    delete LazyFunctions[i];
+  LazyFunctions.clear();
+  for (unsigned i = 0, e = LazySourceModules.size(); i != e; ++i)
+    delete LazySourceModules[i];
+  LazySourceModules.clear();
+
+  for (DenseMap<LLVMContext*, sys::Mutex*>::iterator I = ContextLocks.begin(),
+                                                     E = ContextLocks.end();
+       I != E; ++I)
+    delete I->second;
+  ContextLocks.clear();
+
   delete TM;
 }
 
 void MCJIT::addModule(Module *M) {
   MutexGuard locked(lock);
   OwnedModules.addModule(M);
+  scheduleBackgroundCompile(M);
 }
 
 bool MCJIT::removeModule(Module *M) {
   MutexGuard locked(lock);
+  discardBackgroundObject(M);
   return OwnedModules.removeModule(M);
 }
 
+void MCJIT::setBackgroundCompilation(unsigned NumThreads) {
+#if LLVM_ENABLE_THREADS
+  MutexGuard locked(lock);
+
+  // Compiles already queued keep their results; only new work is affected.
+  if (CompilePool) {
+    CompilePool->wait();
+    CompilePool.reset();
+  }
+  if (NumThreads == 0)
+    return;
+
+  CompilePool.reset(new ThreadPool(NumThreads));
+  for (ModulePtrSet::iterator I = OwnedModules.begin_added(),
+                              E = OwnedModules.end_added();
+       I != E; ++I)
+    scheduleBackgroundCompile(*I);
+#endif
+}
+
+sys::Mutex &MCJIT::getContextLock(LLVMContext &C) {
+  MutexGuard locked(lock);
+  sys::Mutex *&L = ContextLocks[&C];
+  if (!L)
+    L = new sys::Mutex();
+  return *L;
+}
+
+void MCJIT::scheduleBackgroundCompile(Module *M) {
+#if LLVM_ENABLE_THREADS
+  MutexGuard locked(lock);
+
+  // Lazily compiled modules are split before they are compiled, and that
+  // has to happen on the thread that needs them.
+  if (!CompilePool || isCompilingLazily() || PendingCompiles.count(M))
+    return;
+
+  PendingCompile *PC = new PendingCompile();
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (!I->isDeclaration())
+      PC->Definitions[I->getName()] = true;
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    if (!I->isDeclaration())
+      PC->Definitions[I->getName()] = false;
+  PendingCompiles[M] = PC;
+
+  std::shared_ptr<std::promise<ObjectBuffer*> > Promise(
+      new std::promise<ObjectBuffer*>());
+  PC->Object = Promise->get_future().share();
+
+  // A cached object is as good as a finished compile.  The cache may read
+  // the module, so it is asked under the context lock like a compile.
+  sys::Mutex *ContextLock = &getContextLock(M->getContext());
+  if (ObjCache) {
+    MutexGuard ContextLocked(*ContextLock);
+    if (MemoryBuffer *PreCompiledObject = ObjCache->getObject(M)) {
+      PC->FromCache = true;
+      Promise->set_value(new ObjectBuffer(PreCompiledObject));
+      return;
+    }
+  }
+  PC->FromCache = false;
+
+  // Code generation points the TargetMachine's object file lowering at the
+  // MCContext of the module being compiled, so no two compiles may share a
+  // TargetMachine.  Each background compile gets a copy of the engine's.
+  CompilePool->async([this, M, ContextLock, Promise]() {
+    std::unique_ptr<TargetMachine> CompileTM(
+        TM->getTarget().createTargetMachine(
+            TM->getTargetTriple(), TM->getTargetCPU(),
+            TM->getTargetFeatureString(), TM->Options,
+            TM->getRelocationModel(), TM->getCodeModel(),
+            TM->getOptLevel()));
+    MutexGuard ContextLocked(*ContextLock);
+    Promise->set_value(compileModule(M, *CompileTM));
+  });
+#endif
+}
+
+ObjectBuffer *MCJIT::takeBackgroundObject(Module *M) {
+  MutexGuard locked(lock);
+  DenseMap<Module*, PendingCompile*>::iterator I = PendingCompiles.find(M);
+  if (I == PendingCompiles.end())
+    return nullptr;
+
+  PendingCompile *PC = I->second;
+  PendingCompiles.erase(I);
+  ObjectBuffer *Obj = PC->waitForObject();
+  if (!PC->FromCache)
+    notifyObjectCompiled(M, *Obj);
+  delete PC;
+  return Obj;
+}
+
+void MCJIT::discardBackgroundObject(Module *M) {
+  MutexGuard locked(lock);
+  DenseMap<Module*, PendingCompile*>::iterator I = PendingCompiles.find(M);
+  if (I == PendingCompiles.end())
+    return;
+
+  PendingCompile *PC = I->second;
+  PendingCompiles.erase(I);
+  // The object cache holds its entry locked from the miss until it is told
+  // about the object.  The compile is finished either way, so store it
+  // rather than leave other processes waiting on the lock.
+  ObjectBuffer *Obj = PC->waitForObject();
+  if (!PC->FromCache)
+    notifyObjectCompiled(M, *Obj);
+  delete Obj;
+  delete PC;
+}
+
 
 
 void MCJIT::addObjectFile(std::unique_ptr<object::ObjectFile> Obj) {
@@ -140,9 +281,20 @@ ObjectBufferStream* MCJIT::emitObject(Module *M) {
   // MCJIT instance, since these conditions are tested by our caller,
   // generateCodeForModule.
 
+  ObjectBufferStream *CompiledObject;
+  {
+    MutexGuard ContextLocked(getContextLock(M->getContext()));
+    CompiledObject = compileModule(M, *TM);
+  }
+
+  notifyObjectCompiled(M, *CompiledObject);
+  return CompiledObject;
+}
+
+ObjectBufferStream *MCJIT::compileModule(Module *M, TargetMachine &CompileTM) {
   PassManager PM;
 
-  M->setDataLayout(TM->getDataLayout());
+  M->setDataLayout(CompileTM.getDataLayout());
   PM.add(new DataLayoutPass(M));
 
   // The RuntimeDyld will take ownership of this shortly
@@ -150,8 +302,9 @@ ObjectBufferStream* MCJIT::emitObject(Module *M) {
 
   // Turn the machine code intermediate representation into bytes in memory
   // that may be executed.
-  if (TM->addPassesToEmitMC(PM, Ctx, CompiledObject->getOStream(),
-                            !getVerifyModules())) {
+  MCContext *Ctx;
+  if (CompileTM.addPassesToEmitMC(PM, Ctx, CompiledObject->getOStream(),
+                                 !getVerifyModules())) {
     report_fatal_error("Target does not support MC emission!");
   }
 
@@ -160,16 +313,19 @@ ObjectBufferStream* MCJIT::emitObject(Module *M) {
   // Flush the output buffer to get the generated code into memory
   CompiledObject->flush();
 
+  return CompiledObject.release();
+}
+
+void MCJIT::notifyObjectCompiled(Module *M, const ObjectBuffer &Obj) {
   // If we have an object cache, tell it about the new object.
   // Note that we're using the compiled image, not the loaded image (as below).
-  if (ObjCache) {
+  if (ObjCache && !LazyModules.count(M)) {
     // MemoryBuffer is a thin wrapper around the actual memory, so it's OK
     // to create a temporary object here and delete it after the call.
-    std::unique_ptr<MemoryBuffer> MB(CompiledObject->getMemBuffer());
+    std::unique_ptr<MemoryBuffer> MB(Obj.getMemBuffer());
+    MutexGuard ContextLocked(getContextLock(M->getContext()));
     ObjCache->notifyObjectCompiled(M, MB.get());
   }
-
-  return CompiledObject.release();
 }
 
 void MCJIT::generateCodeForModule(Module *M) {
@@ -184,9 +340,17 @@ void MCJIT::generateCodeForModule(Module *M) {
   if (OwnedModules.hasModuleBeenLoaded(M))
     return;
 
-  std::unique_ptr<ObjectBuffer> ObjectToLoad;
+  // If the module was compiled in the background, wait for that result.
+  std::unique_ptr<ObjectBuffer> ObjectToLoad(takeBackgroundObject(M));
+
+  if (!ObjectToLoad && isCompilingLazily() && !LazyModules.count(M)) {
+    MutexGuard ContextLocked(getContextLock(M->getContext()));
+    partitionModuleForLazyCompilation(M);
+  }
+
   // Try to load the pre-compiled object from cache if possible
-  if (ObjCache) {
+  if (!ObjectToLoad && ObjCache && !LazyModules.count(M)) {
+    MutexGuard ContextLocked(getContextLock(M->getContext()));
     std::unique_ptr<MemoryBuffer> PreCompiledObject(ObjCache->getObject(M));
     if (PreCompiledObject.get())
       ObjectToLoad.reset(new ObjectBuffer(PreCompiledObject.release()));
@@ -213,6 +377,271 @@ void MCJIT::generateCodeForModule(Module *M) {
   OwnedModules.markModuleAsLoaded(M);
 }
 
+/// isLazyCompilable - Return true if calls to F can be forwarded through a
+/// stub and its body compiled on its own.
+static bool isLazyCompilable(const Function &F) {
+  if (F.isDeclaration() || F.isIntrinsic() || F.isVarArg() ||
+      F.hasAvailableExternallyLinkage() || F.hasPrefixData() ||
+      F.hasFnAttribute(Attribute::Naked))
+    return false;
+
+  // inalloca arguments cannot be forwarded by an ordinary call.
+  for (Function::const_arg_iterator I = F.arg_begin(), E = F.arg_end();
+       I != E; ++I)
+    if (I->hasInAllocaAttr())
+      return false;
+
+  // The blocks of a function whose block addresses are taken must stay put.
+  for (Function::const_iterator I = F.begin(), E = F.end(); I != E; ++I)
+    if (I->hasAddressTaken())
+      return false;
+
+  return true;
+}
+
+/// collectReferencedGlobals - Add every global value used by the body of F,
+/// looking through constant expressions and aggregates, to GVs.
+static void collectReferencedGlobals(const Function &F,
+                                     SmallPtrSet<GlobalValue*, 16> &GVs) {
+  SmallVector<const Constant*, 16> Worklist;
+  SmallPtrSet<const Constant*, 16> Visited;
+  for (Function::const_iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB)
+    for (BasicBlock::const_iterator I = BB->begin(), IE = BB->end(); I != IE;
+         ++I)
+      for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end();
+           OI != OE; ++OI)
+        if (const Constant *C = dyn_cast<Constant>(*OI))
+          if (Visited.insert(C))
+            Worklist.push_back(C);
+
+  while (!Worklist.empty()) {
+    const Constant *C = Worklist.pop_back_val();
+    if (const GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+      GVs.insert(const_cast<GlobalValue*>(GV));
+      continue;
+    }
+    for (User::const_op_iterator OI = C->op_begin(), OE = C->op_end();
+         OI != OE; ++OI)
+      if (const Constant *Op = dyn_cast<Constant>(*OI))
+        if (Visited.insert(Op))
+          Worklist.push_back(Op);
+  }
+}
+
+/// declareGlobalInModule - Create an external declaration of GV in M.
+static GlobalValue *declareGlobalInModule(GlobalValue *GV, Module *M) {
+  Type *Ty = GV->getType()->getElementType();
+  GlobalValue *Decl;
+  if (FunctionType *FTy = dyn_cast<FunctionType>(Ty)) {
+    Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                   GV->getName(), M);
+    if (Function *Orig = dyn_cast<Function>(GV)) {
+      F->setCallingConv(Orig->getCallingConv());
+      F->setAttributes(Orig->getAttributes());
+    }
+    Decl = F;
+  } else {
+    GlobalVariable *Orig = dyn_cast<GlobalVariable>(GV);
+    Decl = new GlobalVariable(
+        *M, Ty, Orig && Orig->isConstant(), GlobalValue::ExternalLinkage,
+        nullptr, GV->getName(), nullptr,
+        Orig ? Orig->getThreadLocalMode() : GlobalValue::NotThreadLocal,
+        GV->getType()->getAddressSpace());
+  }
+  Decl->setVisibility(GV->getVisibility());
+  return Decl;
+}
+
+void MCJIT::partitionModuleForLazyCompilation(Module *M) {
+  // Stubs call back into this process, so they only make sense when the
+  // target shares the host's pointer size.
+  const DataLayout *DL = TM->getDataLayout();
+  if (DL->getPointerSize() != sizeof(void*))
+    return;
+
+  // The bodies are extracted from a clone, so they must all be in memory.
+  if (std::error_code EC = M->materializeAllPermanently())
+    report_fatal_error("Unable to materialize module for lazy compilation: " +
+                       EC.message());
+
+  SmallVector<Function*, 16> Lazy;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (isLazyCompilable(*I))
+      Lazy.push_back(I);
+  if (Lazy.empty())
+    return;
+
+  // Extracted bodies live in other modules and refer back to this one by
+  // name, so nothing here may keep local linkage.  The module number keeps
+  // the promoted names distinct across modules.
+  std::string Prefix = "__mcjit_lazy" + utostr(LazySourceModules.size()) + ".";
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    if (I->hasLocalLinkage() && !I->getName().startswith("llvm.")) {
+      I->setName(Prefix + I->getName());
+      I->setLinkage(GlobalValue::ExternalLinkage);
+      I->setVisibility(GlobalValue::HiddenVisibility);
+    }
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (I->hasLocalLinkage()) {
+      I->setName(Prefix + I->getName());
+      I->setLinkage(GlobalValue::ExternalLinkage);
+      I->setVisibility(GlobalValue::HiddenVisibility);
+    }
+  for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    if (I->hasLocalLinkage()) {
+      I->setName(Prefix + I->getName());
+      I->setLinkage(GlobalValue::ExternalLinkage);
+      I->setVisibility(GlobalValue::HiddenVisibility);
+    }
+
+  ValueToValueMapTy VMap;
+  Module *Source = CloneModule(M, VMap);
+  LazySourceModules.push_back(Source);
+
+  for (unsigned i = 0, e = Lazy.size(); i != e; ++i) {
+    LazyFunction *LF = new LazyFunction();
+    LF->Engine = this;
+    LF->Body = cast<Function>(VMap[Lazy[i]]);
+    LF->Address = 0;
+    LazyFunctions.push_back(LF);
+    emitLazyStub(Lazy[i], LF);
+  }
+
+  LazyModules.insert(M);
+}
+
+/// emitLazyStub - Replace the body of F with a stub that forwards to the
+/// compiled body, compiling it on first use.  In pseudo-C:
+///
+///   if (!(addr = atomic_load_acquire(&F.lazy_addr)))
+///     atomic_store_release(&F.lazy_addr, addr = lazyCompileCallback(LF));
+///   return ((typeof(F)*)addr)(args...);
+void MCJIT::emitLazyStub(Function *F, LazyFunction *LF) {
+  LLVMContext &C = F->getContext();
+  const DataLayout *DL = TM->getDataLayout();
+  IntegerType *IntPtrTy = DL->getIntPtrType(C);
+  unsigned PtrAlign = DL->getPointerABIAlignment();
+
+  // The call into the body carries the original attributes; the stub itself
+  // writes memory, so it must not claim otherwise.
+  AttributeSet Attrs = F->getAttributes();
+  GlobalValue::LinkageTypes Linkage = F->getLinkage();
+  F->deleteBody();
+  F->setLinkage(Linkage);
+  F->removeFnAttr(Attribute::ReadNone);
+  F->removeFnAttr(Attribute::ReadOnly);
+
+  GlobalVariable *Slot =
+      new GlobalVariable(*F->getParent(), IntPtrTy, false,
+                         GlobalValue::InternalLinkage,
+                         ConstantInt::get(IntPtrTy, 0),
+                         F->getName() + ".lazy_addr");
+  Slot->setAlignment(PtrAlign);
+
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+  BasicBlock *Compile = BasicBlock::Create(C, "compile", F);
+  BasicBlock *Call = BasicBlock::Create(C, "call", F);
+
+  IRBuilder<> B(Entry);
+  LoadInst *Addr = B.CreateLoad(Slot, "addr");
+  Addr->setAtomic(Acquire);
+  Addr->setAlignment(PtrAlign);
+  B.CreateCondBr(B.CreateIsNull(Addr), Compile, Call);
+
+  B.SetInsertPoint(Compile);
+  Type *IntPtrArg[] = { IntPtrTy };
+  FunctionType *CallbackTy = FunctionType::get(IntPtrTy, IntPtrArg, false);
+  Constant *Callback = ConstantExpr::getIntToPtr(
+      ConstantInt::get(IntPtrTy, (uintptr_t)&MCJIT::lazyCompileCallback),
+      CallbackTy->getPointerTo());
+  Value *NewAddr =
+      B.CreateCall(Callback, ConstantInt::get(IntPtrTy, (uintptr_t)LF));
+  StoreInst *Store = B.CreateStore(NewAddr, Slot);
+  Store->setAtomic(Release);
+  Store->setAlignment(PtrAlign);
+  B.CreateBr(Call);
+
+  B.SetInsertPoint(Call);
+  PHINode *Target = B.CreatePHI(IntPtrTy, 2, "target");
+  Target->addIncoming(Addr, Entry);
+  Target->addIncoming(NewAddr, Compile);
+  SmallVector<Value*, 8> Args;
+  for (Function::arg_iterator I = F->arg_begin(), E = F->arg_end(); I != E;
+       ++I)
+    Args.push_back(I);
+  CallInst *Fwd = B.CreateCall(B.CreateIntToPtr(Target, F->getType()), Args);
+  Fwd->setCallingConv(F->getCallingConv());
+  Fwd->setAttributes(Attrs);
+  Fwd->setTailCall();
+  if (Fwd->getType()->isVoidTy())
+    B.CreateRetVoid();
+  else
+    B.CreateRet(Fwd);
+}
+
+uint64_t MCJIT::compileLazyFunction(LazyFunction *LF) {
+  MutexGuard locked(lock);
+
+  // Another thread may have compiled the body while we waited for the lock.
+  if (LF->Address)
+    return LF->Address;
+
+  Function *Src = LF->Body;
+  Module *SrcM = Src->getParent();
+  MutexGuard ContextLocked(getContextLock(Src->getContext()));
+  Module *M = new Module((Src->getName() + ".lazy").str(), Src->getContext());
+  M->setTargetTriple(SrcM->getTargetTriple());
+  M->setDataLayout(SrcM->getDataLayout());
+
+  // Everything the body refers to, itself included, is defined in the stub
+  // module and is found by name when the new module is linked.  Self calls
+  // go through the stub so that the function's address stays unique.
+  ValueToValueMapTy VMap;
+  SmallPtrSet<GlobalValue*, 16> Referenced;
+  collectReferencedGlobals(*Src, Referenced);
+  for (SmallPtrSet<GlobalValue*, 16>::iterator I = Referenced.begin(),
+                                               E = Referenced.end();
+       I != E; ++I)
+    VMap[*I] = declareGlobalInModule(*I, M);
+
+  Function *F = Function::Create(Src->getFunctionType(),
+                                 GlobalValue::ExternalLinkage,
+                                 Src->getName() + ".lazy_body", M);
+  F->setVisibility(GlobalValue::HiddenVisibility);
+  Function::arg_iterator DestI = F->arg_begin();
+  for (Function::const_arg_iterator I = Src->arg_begin(), E = Src->arg_end();
+       I != E; ++I, ++DestI) {
+    DestI->setName(I->getName());
+    VMap[I] = DestI;
+  }
+  SmallVector<ReturnInst*, 8> Returns;
+  CloneFunctionInto(F, Src, VMap, /*ModuleLevelChanges=*/true, Returns);
+
+  // The debug info metadata still describes the source module.
+  StripDebugInfo(*M);
+
+  // The source body is no longer needed.
+  Src->deleteBody();
+  LF->Body = nullptr;
+
+  LazyModules.insert(M);
+  OwnedModules.addModule(M);
+  generateCodeForModule(M);
+  finalizeLoadedModules();
+
+  LF->Address = getExistingSymbolAddress(F->getName());
+  if (!LF->Address)
+    report_fatal_error("Lazy compilation of '" + F->getName() + "' failed");
+  return LF->Address;
+}
+
+uintptr_t MCJIT::lazyCompileCallback(uintptr_t Handle) {
+  LazyFunction *LF = reinterpret_cast<LazyFunction*>(Handle);
+  return (uintptr_t)LF->Engine->compileLazyFunction(LF);
+}
+
 void MCJIT::finalizeLoadedModules() {
   MutexGuard locked(lock);
 
@@ -275,6 +704,16 @@ Module *MCJIT::findModuleForSymbol(const std::string &Name,
                               E = OwnedModules.end_added();
        I != E; ++I) {
     Module *M = *I;
+    // A worker may be compiling this module; use the names recorded when it
+    // was scheduled.
+    DenseMap<Module*, PendingCompile*>::iterator P = PendingCompiles.find(M);
+    if (P != PendingCompiles.end()) {
+      StringMap<bool>::iterator D = P->second->Definitions.find(Name);
+      if (D != P->second->Definitions.end() &&
+          (D->second || !CheckFunctionsOnly))
+        return M;
+      continue;
+    }
     Function *F = M->getFunction(Name);
     if (F && !F->isDeclaration())
       return M;
@@ -411,6 +850,7 @@ Function *MCJIT::FindFunctionNamedInModulePtrSet(const char *FnName,
                                                  ModulePtrSet::iterator I,
                                                  ModulePtrSet::iterator E) {
   for (; I != E; ++I) {
+    MutexGuard ContextLocked(getContextLock((*I)->getContext()));
     if (Function *F = (*I)->getFunction(FnName))
       return F;
   }
@@ -418,6 +858,7 @@ Function *MCJIT::FindFunctionNamedInModulePtrSet(const char *FnName,
 }
 
 Function *MCJIT::FindFunctionNamed(const char *FnName) {
+  MutexGuard locked(lock);
   Function *F = FindFunctionNamedInModulePtrSet(
       FnName, OwnedModules.begin_added(), OwnedModules.end_added());
   if (!F)
@@ -13,14 +13,21 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/ObjectImage.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/IR/Module.h"
 
+#if LLVM_ENABLE_THREADS
+#include <future>
+#endif
+
 namespace llvm {
 class MCJIT;
+class ThreadPool;
 
 // This is a helper class that the MCJIT execution engine uses for linking
 // functions across modules that it owns.  It aggregates the memory manager
@@ -209,7 +216,6 @@ class MCJIT : public ExecutionEngine {
   };
 
   TargetMachine *TM;
-  MCContext *Ctx;
   LinkingMemoryManager MemMgr;
   RuntimeDyld Dyld;
   SmallVector<JITEventListener*, 2> EventListeners;
@@ -233,6 +239,61 @@ class MCJIT : public ExecutionEngine {
                                                       ModulePtrSet::iterator I,
                                                       ModulePtrSet::iterator E);
 
+  // Lazy compilation.  When lazy compilation is enabled, each module is split
+  // just before it is compiled: the module keeps its global variables and a
+  // call-through stub for every function, while the function bodies move to
+  // a private clone.  The first call through a stub extracts that one body
+  // into a module of its own, compiles it and caches its address in a slot
+  // that later calls load directly.
+  struct LazyFunction {
+    MCJIT *Engine;
+    // The definition in the source clone, or null once it has been compiled.
+    Function *Body;
+    uint64_t Address;
+  };
+
+  SmallVector<Module*, 2> LazySourceModules;
+  std::vector<LazyFunction*> LazyFunctions;
+
+  // Modules produced by lazy splitting.  The stubs embed host addresses, so
+  // these are never handed to the object cache.
+  ModulePtrSet LazyModules;
+
+  // Background compilation.  While a pool is active, each added module is
+  // compiled to an object buffer by a worker as soon as it is added; the
+  // buffer is waited for and loaded the first time the module is needed.
+  // Code generation is serialized per LLVMContext, since a context may not be
+  // used by two threads at once.  Without threads no pool is ever created and
+  // nothing is pending.
+  struct PendingCompile {
+#if LLVM_ENABLE_THREADS
+    std::shared_future<ObjectBuffer*> Object;
+    ObjectBuffer *waitForObject() { return Object.get(); }
+#else
+    ObjectBuffer *Object;
+    ObjectBuffer *waitForObject() { return Object; }
+#endif
+    // True if the object came from the ObjectCache rather than a worker.
+    bool FromCache;
+    // Names the module defines (true for functions), recorded when it was
+    // scheduled so that symbol lookup never reads IR a worker is compiling.
+    StringMap<bool> Definitions;
+  };
+
+  std::unique_ptr<ThreadPool> CompilePool;
+  DenseMap<Module*, PendingCompile*> PendingCompiles;
+  DenseMap<LLVMContext*, sys::Mutex*> ContextLocks;
+
+  sys::Mutex &getContextLock(LLVMContext &C);
+  void scheduleBackgroundCompile(Module *M);
+  ObjectBuffer *takeBackgroundObject(Module *M);
+  void discardBackgroundObject(Module *M);
+
+  void partitionModuleForLazyCompilation(Module *M);
+  void emitLazyStub(Function *F, LazyFunction *LF);
+  uint64_t compileLazyFunction(LazyFunction *LF);
+  static uintptr_t lazyCompileCallback(uintptr_t Handle);
+
 public:
   ~MCJIT();
 
@@ -257,6 +318,8 @@ public:
 
   void generateCodeForModule(Module *M) override;
 
+  void setBackgroundCompilation(unsigned NumThreads) override;
+
   /// finalizeObject - ensure the module is fully processed and is usable.
   ///
   /// It is the user-level function for completing the process of making the
@@ -346,6 +409,14 @@ protected:
   /// the future.
   ObjectBufferStream* emitObject(Module *M);
 
+  /// compileModule - Run code generation for M with CompileTM into a new
+  /// object buffer.  This touches neither the engine state nor the engine
+  /// lock, so it may run on a worker thread; the caller must hold M's context
+  /// lock and must not share CompileTM with another compile in flight.
+  ObjectBufferStream *compileModule(Module *M, TargetMachine &CompileTM);
+
+  void notifyObjectCompiled(Module *M, const ObjectBuffer &Obj);
+
   void NotifyObjectEmitted(const ObjectImage& Obj);
   void NotifyFreeingObject(const ObjectImage& Obj);
 
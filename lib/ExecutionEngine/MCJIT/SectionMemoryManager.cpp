@@ -15,9 +15,14 @@
 #include "llvm/Config/config.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
 
 namespace llvm {
 
+const uintptr_t SectionMemoryManager::DefaultSlabSize;
+const uintptr_t SectionMemoryManager::HugePageSize;
+
 uint8_t *SectionMemoryManager::allocateDataSection(uintptr_t Size,
                                                    unsigned Alignment,
                                                    unsigned SectionID,
@@ -58,25 +63,31 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
       // Store cutted free memory block.
       MemGroup.FreeMem[i] = sys::MemoryBlock((void*)(Addr + Size),
                                              EndOfBlock - Addr - Size);
+      MemGroup.PendingMem.push_back(sys::MemoryBlock((void*)Addr, Size));
       return (uint8_t*)Addr;
     }
   }
 
-  // No pre-allocated free block was large enough. Allocate a new memory region.
-  // Note that all sections get allocated as read-write.  The permissions will
-  // be updated later based on memory group.
-  //
-  // FIXME: It would be useful to define a default allocation size (or add
-  // it as a constructor parameter) to minimize the number of allocations.
+  // No pre-allocated free block was large enough. Map a new slab, which will
+  // also serve later requests.  Note that all sections get allocated as
+  // read-write.  The permissions will be updated later based on memory group.
   //
   // FIXME: Initialize the Near member for each memory group to avoid
   // interleaving.
   std::error_code ec;
-  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(RequiredSize,
-                                                          &MemGroup.Near,
-                                                          sys::Memory::MF_READ |
-                                                            sys::Memory::MF_WRITE,
-                                                          ec);
+  unsigned Flags = sys::Memory::MF_READ | sys::Memory::MF_WRITE;
+  uintptr_t SlabBytes = std::max(RequiredSize, SlabSize);
+  uintptr_t MapSize = SlabBytes;
+  if (UseHugePages) {
+    // The system only gives huge pages to aligned runs of them.  Mapping
+    // one more huge page than needed leaves room to start the slab on a
+    // boundary; the unused head is never touched, so it costs no memory.
+    Flags |= sys::Memory::MF_HUGE_HINT;
+    SlabBytes = RoundUpToAlignment(SlabBytes, HugePageSize);
+    MapSize = SlabBytes + HugePageSize;
+  }
+  sys::MemoryBlock MB =
+      sys::Memory::allocateMappedMemory(MapSize, &MemGroup.Near, Flags, ec);
   if (ec) {
     // FIXME: Add error propagation to the interface.
     return nullptr;
@@ -88,16 +99,24 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
   MemGroup.AllocatedMem.push_back(MB);
   Addr = (uintptr_t)MB.base();
   uintptr_t EndOfBlock = Addr + MB.size();
+  if (UseHugePages) {
+    // Use only the whole huge pages, so that finalizeMemory can protect
+    // them as units.
+    Addr = RoundUpToAlignment(Addr, HugePageSize);
+    EndOfBlock = Addr + SlabBytes;
+  }
 
   // Align the address.
   Addr = (Addr + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
 
-  // The allocateMappedMemory may allocate much more memory than we need. In
-  // this case, we store the unused memory as a free memory block.
-  unsigned FreeSize = EndOfBlock-Addr-Size;
+  // The slab is usually much larger than this request; store the unused
+  // memory as a free memory block.
+  uintptr_t FreeSize = EndOfBlock-Addr-Size;
   if (FreeSize > 16)
     MemGroup.FreeMem.push_back(sys::MemoryBlock((void*)(Addr + Size), FreeSize));
 
+  MemGroup.PendingMem.push_back(sys::MemoryBlock((void*)Addr, Size));
+
   // Return aligned address
   return (uint8_t*)Addr;
 }
@@ -107,9 +126,6 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
   // FIXME: Should in-progress permissions be reverted if an error occurs?
   std::error_code ec;
 
-  // Don't allow free memory blocks to be used after setting protection flags.
-  CodeMem.FreeMem.clear();
-
   // Make code memory executable.
   ec = applyMemoryGroupPermissions(CodeMem,
                                    sys::Memory::MF_READ | sys::Memory::MF_EXEC);
@@ -120,9 +136,6 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
     return true;
   }
 
-  // Don't allow free memory blocks to be used after setting protection flags.
-  RODataMem.FreeMem.clear();
-
   // Make read-only data memory read-only.
   ec = applyMemoryGroupPermissions(RODataMem,
                                    sys::Memory::MF_READ | sys::Memory::MF_EXEC);
@@ -134,6 +147,7 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
   }
 
   // Read-write data memory already has the correct permissions
+  RWDataMem.PendingMem.clear();
 
   // Some platforms with separate data cache and instruction cache require
   // explicit cache flush, otherwise JIT code manipulations (like resolved
@@ -146,15 +160,60 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
 std::error_code
 SectionMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                                   unsigned Permissions) {
+  static const uintptr_t PageSize = sys::process::get_self()->page_size();
+
+  // Only the pages holding sections allocated since the last finalization
+  // change.  Round each section out to whole pages and merge neighbours so
+  // that each run of pages takes a single call.  Protecting part of a huge
+  // page would split it, so huge-page slabs are protected in whole huge
+  // pages.
+  const uintptr_t Unit = UseHugePages ? HugePageSize : PageSize;
+  typedef std::pair<uintptr_t, uintptr_t> PageRange;
+  SmallVector<PageRange, 16> Ranges;
+  for (unsigned i = 0, e = MemGroup.PendingMem.size(); i != e; ++i) {
+    uintptr_t Start = (uintptr_t)MemGroup.PendingMem[i].base();
+    uintptr_t End = Start + MemGroup.PendingMem[i].size();
+    Ranges.push_back(PageRange(Start & ~(Unit - 1),
+                               (End + Unit - 1) & ~(Unit - 1)));
+  }
+  MemGroup.PendingMem.clear();
+  std::sort(Ranges.begin(), Ranges.end());
+
+  SmallVector<PageRange, 16> Merged;
+  for (unsigned i = 0, e = Ranges.size(); i != e; ++i) {
+    if (!Merged.empty() && Ranges[i].first <= Merged.back().second)
+      Merged.back().second = std::max(Merged.back().second, Ranges[i].second);
+    else
+      Merged.push_back(Ranges[i]);
+  }
 
-  for (int i = 0, e = MemGroup.AllocatedMem.size(); i != e; ++i) {
-    std::error_code ec;
-    ec =
-        sys::Memory::protectMappedMemory(MemGroup.AllocatedMem[i], Permissions);
-    if (ec) {
+  for (unsigned i = 0, e = Merged.size(); i != e; ++i) {
+    sys::MemoryBlock MB((void*)Merged[i].first,
+                        Merged[i].second - Merged[i].first);
+    if (std::error_code ec = sys::Memory::protectMappedMemory(MB, Permissions))
       return ec;
+  }
+
+  // Free space on the pages just protected can no longer be written; keep
+  // only the parts of each free block outside them.
+  SmallVector<sys::MemoryBlock, 16> StillFree;
+  for (unsigned i = 0, e = MemGroup.FreeMem.size(); i != e; ++i) {
+    uintptr_t Cur = (uintptr_t)MemGroup.FreeMem[i].base();
+    uintptr_t End = Cur + MemGroup.FreeMem[i].size();
+    for (unsigned j = 0, je = Merged.size(); j != je && Cur < End; ++j) {
+      if (Merged[j].second <= Cur)
+        continue;
+      if (Merged[j].first >= End)
+        break;
+      if (Merged[j].first > Cur)
+        StillFree.push_back(sys::MemoryBlock((void*)Cur,
+                                             Merged[j].first - Cur));
+      Cur = Merged[j].second;
     }
+    if (Cur < End)
+      StillFree.push_back(sys::MemoryBlock((void*)Cur, End - Cur));
   }
+  MemGroup.FreeMem.swap(StillFree);
 
   return std::error_code();
 }
@@ -560,6 +560,13 @@ uint8_t *RuntimeDyldImpl::createStubFunction(uint8_t *Addr) {
     StubAddr++;
     *StubAddr = NopInstr;
     return Addr;
+  } else if (Arch == Triple::or1k || Arch == Triple::or1kle) {
+    // The stub may clobber r13, a call-clobbered temporary.
+    writeInt32BE(Addr,    0x19A00000); // l.movhi r13, hi(addr)
+    writeInt32BE(Addr+4,  0xA9AD0000); // l.ori   r13, r13, lo(addr)
+    writeInt32BE(Addr+8,  0x44006800); // l.jr    r13
+    writeInt32BE(Addr+12, 0x15000000); // l.nop
+    return Addr;
   } else if (Arch == Triple::ppc64 || Arch == Triple::ppc64le) {
     // PowerPC64 stub: the address points to a function descriptor
     // instead of the function itself. Load the function address
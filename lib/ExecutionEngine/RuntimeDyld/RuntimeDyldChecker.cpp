@@ -634,9 +634,13 @@ uint64_t RuntimeDyldChecker::getSymbolAddress(StringRef Symbol) const {
 uint64_t RuntimeDyldChecker::readMemoryAtSymbol(StringRef Symbol,
                                                 int64_t Offset,
                                                 unsigned Size) const {
-  uint8_t *Src = RTDyld.getSymbolAddress(Symbol);
+  uint8_t *Src = RTDyld.getSymbolAddress(Symbol) + Offset;
+  // The linked image holds values in target byte order.
   uint64_t Result = 0;
-  memcpy(&Result, Src + Offset, Size);
+  for (unsigned i = 0; i != Size; ++i) {
+    unsigned Byte = RTDyld.IsTargetLittleEndian ? Size - 1 - i : i;
+    Result = (Result << 8) | Src[Byte];
+  }
   return Result;
 }
 
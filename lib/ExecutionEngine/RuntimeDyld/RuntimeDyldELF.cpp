@@ -870,6 +870,100 @@ void RuntimeDyldELF::resolveSystemZRelocation(const SectionEntry &Section,
   }
 }
 
+void RuntimeDyldELF::resolveOR1KRelocation(const SectionEntry &Section,
+                                           uint64_t Offset, uint32_t Value,
+                                           uint32_t Type, int32_t Addend,
+                                           unsigned GOTSectionID) {
+  uint8_t *LocalAddress = Section.Address + Offset;
+  uint32_t FinalAddress = (Section.LoadAddress + Offset) & 0xFFFFFFFF;
+  // Instruction fields are masked out before they are filled in, so that
+  // resolving a relocation again after a section moves gives the same result.
+  uint32_t Insn;
+
+  DEBUG(dbgs() << "resolveOR1KRelocation, LocalAddress: "
+               << format("%p", LocalAddress) << " FinalAddress: "
+               << format("%x", FinalAddress) << " Value: "
+               << format("%x", Value) << " Type: " << format("%x", Type)
+               << " Addend: " << format("%x", Addend) << "\n");
+
+  switch (Type) {
+  default:
+    llvm_unreachable("Relocation type not implemented yet!");
+    break;
+  case ELF::R_OR1K_NONE:
+    break;
+  case ELF::R_OR1K_32:
+  case ELF::R_OR1K_GLOB_DAT:
+  case ELF::R_OR1K_JMP_SLOT:
+    writeInt32BE(LocalAddress, Value + Addend);
+    break;
+  case ELF::R_OR1K_16:
+    writeInt16BE(LocalAddress, Value + Addend);
+    break;
+  case ELF::R_OR1K_8:
+    *LocalAddress = uint8_t(Value + Addend);
+    break;
+  case ELF::R_OR1K_32_PCREL:
+    writeInt32BE(LocalAddress, Value + Addend - FinalAddress);
+    break;
+  case ELF::R_OR1K_16_PCREL: {
+    int32_t Delta = Value + Addend - FinalAddress;
+    assert(int16_t(Delta) == Delta && "R_OR1K_16_PCREL overflow");
+    writeInt16BE(LocalAddress, Delta);
+    break;
+  }
+  case ELF::R_OR1K_8_PCREL: {
+    int32_t Delta = Value + Addend - FinalAddress;
+    assert(int8_t(Delta) == Delta && "R_OR1K_8_PCREL overflow");
+    *LocalAddress = uint8_t(Delta);
+    break;
+  }
+  case ELF::R_OR1K_INSN_REL_26:
+  case ELF::R_OR1K_PLT26: {
+    int32_t Delta = Value + Addend - FinalAddress;
+    assert((Delta & 3) == 0 && "Misaligned branch target");
+    assert(Delta >= -(1 << 27) && Delta < (1 << 27) &&
+           "Branch target out of range");
+    Insn = readInt32BE(LocalAddress);
+    writeInt32BE(LocalAddress,
+                 (Insn & 0xfc000000) | ((uint32_t(Delta) >> 2) & 0x03ffffff));
+    break;
+  }
+  case ELF::R_OR1K_HI_16_IN_INSN:
+    Insn = readInt32BE(LocalAddress);
+    writeInt32BE(LocalAddress,
+                 (Insn & 0xffff0000) | (((Value + Addend) >> 16) & 0xffff));
+    break;
+  case ELF::R_OR1K_LO_16_IN_INSN:
+  case ELF::R_OR1K_GOT16:
+    // For GOT16, Value is the offset of the GOT slot from the GOT base.
+    Insn = readInt32BE(LocalAddress);
+    writeInt32BE(LocalAddress,
+                 (Insn & 0xffff0000) | ((Value + Addend) & 0xffff));
+    break;
+  case ELF::R_OR1K_GOTPC_HI16:
+  case ELF::R_OR1K_GOTPC_LO16: {
+    // Value is the address of the GOT.
+    uint32_t Delta = Value + Addend - FinalAddress;
+    if (Type == ELF::R_OR1K_GOTPC_HI16)
+      Delta >>= 16;
+    Insn = readInt32BE(LocalAddress);
+    writeInt32BE(LocalAddress, (Insn & 0xffff0000) | (Delta & 0xffff));
+    break;
+  }
+  case ELF::R_OR1K_GOTOFF_HI16:
+  case ELF::R_OR1K_GOTOFF_LO16: {
+    uint32_t GOTAddress = getSectionLoadAddress(GOTSectionID);
+    uint32_t GOTOffset = Value + Addend - GOTAddress;
+    if (Type == ELF::R_OR1K_GOTOFF_HI16)
+      GOTOffset >>= 16;
+    Insn = readInt32BE(LocalAddress);
+    writeInt32BE(LocalAddress, (Insn & 0xffff0000) | (GOTOffset & 0xffff));
+    break;
+  }
+  }
+}
+
 // The target location for the relocation is described by RE.SectionID and
 // RE.Offset.  RE.SectionID can be used to find the SectionEntry.  Each
 // SectionEntry has three members describing its location.
@@ -894,13 +988,14 @@ void RuntimeDyldELF::resolveRelocation(const RelocationEntry &RE,
                                        uint64_t Value) {
   const SectionEntry &Section = Sections[RE.SectionID];
   return resolveRelocation(Section, RE.Offset, Value, RE.RelType, RE.Addend,
-                           RE.SymOffset);
+                           RE.SymOffset, RE.GOTSectionID);
 }
 
 void RuntimeDyldELF::resolveRelocation(const SectionEntry &Section,
                                        uint64_t Offset, uint64_t Value,
                                        uint32_t Type, int64_t Addend,
-                                       uint64_t SymOffset) {
+                                       uint64_t SymOffset,
+                                       unsigned GOTSectionID) {
   switch (Arch) {
   case Triple::x86_64:
     resolveX86_64Relocation(Section, Offset, Value, Type, Addend, SymOffset);
@@ -934,6 +1029,12 @@ void RuntimeDyldELF::resolveRelocation(const SectionEntry &Section,
   case Triple::systemz:
     resolveSystemZRelocation(Section, Offset, Value, Type, Addend);
     break;
+  case Triple::or1k:
+  case Triple::or1kle:
+    resolveOR1KRelocation(Section, Offset, (uint32_t)(Value & 0xffffffffL),
+                          Type, (uint32_t)(Addend & 0xffffffffL),
+                          GOTSectionID);
+    break;
   default:
     llvm_unreachable("Unsupported CPU type!");
   }
@@ -1377,6 +1478,65 @@ relocation_iterator RuntimeDyldELF::processRelocationRef(
                          Value.Offset);
       addRelocationForSection(RE, Value.SectionID);
     }
+  } else if ((Arch == Triple::or1k || Arch == Triple::or1kle) &&
+             (RelType == ELF::R_OR1K_INSN_REL_26 ||
+              RelType == ELF::R_OR1K_PLT26) &&
+             (Value.SymbolName || Value.SectionID != SectionID)) {
+    // This is an OR1K branch to another section or to an external symbol,
+    // which may be further away than the 26-bit displacement can reach.
+    // Branch to a stub that jumps to the full 32-bit address instead.
+    DEBUG(dbgs() << "\t\tThis is an OR1K branch relocation.");
+    SectionEntry &Section = Sections[SectionID];
+
+    // Look for an existing stub.
+    StubMap::const_iterator i = Stubs.find(Value);
+    if (i != Stubs.end()) {
+      RelocationEntry RE(SectionID, Offset, RelType, i->second);
+      addRelocationForSection(RE, SectionID);
+      DEBUG(dbgs() << " Stub function found\n");
+    } else {
+      // Create a new stub function.
+      DEBUG(dbgs() << " Create a new stub function\n");
+      Stubs[Value] = Section.StubOffset;
+      uint8_t *StubTargetAddr =
+          createStubFunction(Section.Address + Section.StubOffset);
+
+      RelocationEntry REHi(SectionID, StubTargetAddr - Section.Address,
+                           ELF::R_OR1K_HI_16_IN_INSN, Value.Addend);
+      RelocationEntry RELo(SectionID, StubTargetAddr - Section.Address + 4,
+                           ELF::R_OR1K_LO_16_IN_INSN, Value.Addend);
+      if (Value.SymbolName) {
+        addRelocationForSymbol(REHi, Value.SymbolName);
+        addRelocationForSymbol(RELo, Value.SymbolName);
+      } else {
+        addRelocationForSection(REHi, Value.SectionID);
+        addRelocationForSection(RELo, Value.SectionID);
+      }
+
+      RelocationEntry RE(SectionID, Offset, RelType, Section.StubOffset);
+      addRelocationForSection(RE, SectionID);
+      Section.StubOffset += getMaxStubSize();
+    }
+  } else if ((Arch == Triple::or1k || Arch == Triple::or1kle) &&
+             RelType == ELF::R_OR1K_GOT16) {
+    // The slot's offset in this object's GOT is known now, so the
+    // instruction can be filled in immediately. The slot itself is filled in
+    // once finalizeLoad has allocated the GOT.
+    uint64_t SlotOffset = GOTEntries.size() * getGOTEntrySize();
+    GOTEntries.push_back(Value);
+    PendingGOTSlotRelocs.push_back(std::make_pair(
+        RelocationEntry(SectionID, SlotOffset, ELF::R_OR1K_32, Value.Addend),
+        Value));
+    resolveRelocation(Sections[SectionID], Offset, SlotOffset, RelType, 0);
+  } else if ((Arch == Triple::or1k || Arch == Triple::or1kle) &&
+             (RelType == ELF::R_OR1K_GOTPC_HI16 ||
+              RelType == ELF::R_OR1K_GOTPC_LO16 ||
+              RelType == ELF::R_OR1K_GOTOFF_HI16 ||
+              RelType == ELF::R_OR1K_GOTOFF_LO16)) {
+    // These are relative to the GOT, which does not exist yet.
+    NeedsGOT = true;
+    PendingGOTRelativeRelocs.push_back(std::make_pair(
+        RelocationEntry(SectionID, Offset, RelType, Value.Addend), Value));
   } else {
     if (Arch == Triple::x86_64 && RelType == ELF::R_X86_64_GOTPCREL) {
       GOTEntries.push_back(Value);
@@ -1426,6 +1586,8 @@ size_t RuntimeDyldELF::getGOTEntrySize() {
   case Triple::thumb:
   case Triple::mips:
   case Triple::mipsel:
+  case Triple::or1k:
+  case Triple::or1kle:
     Result = sizeof(uint32_t);
     break;
   default:
@@ -1494,10 +1656,12 @@ void RuntimeDyldELF::finalizeLoad(ObjectImage &ObjImg,
   if (MemMgr) {
     // Allocate the GOT if necessary
     size_t numGOTEntries = GOTEntries.size();
-    if (numGOTEntries != 0) {
-      // Allocate memory for the section
+    if (numGOTEntries != 0 || NeedsGOT) {
+      // Allocate memory for the section. Code may refer to an empty GOT, so
+      // give it at least one entry to have an address.
       unsigned SectionID = Sections.size();
-      size_t TotalSize = numGOTEntries * getGOTEntrySize();
+      size_t TotalSize =
+          std::max<size_t>(numGOTEntries, 1) * getGOTEntrySize();
       uint8_t *Addr = MemMgr->allocateDataSection(TotalSize, getGOTEntrySize(),
                                                   SectionID, ".got", false);
       if (!Addr)
@@ -1508,7 +1672,32 @@ void RuntimeDyldELF::finalizeLoad(ObjectImage &ObjImg,
       // For now, initialize all GOT entries to zero.  We'll fill them in as
       // needed when GOT-based relocations are applied.
       memset(Addr, 0, TotalSize);
+
+      // Fill in the OR1K GOT slots and resolve references to the GOT.
+      for (auto &P : PendingGOTSlotRelocs) {
+        RelocationEntry &RE = P.first;
+        RE.SectionID = SectionID;
+        if (P.second.SymbolName)
+          addRelocationForSymbol(RE, P.second.SymbolName);
+        else
+          addRelocationForSection(RE, P.second.SectionID);
+      }
+      for (auto &P : PendingGOTRelativeRelocs) {
+        RelocationEntry &RE = P.first;
+        RE.GOTSectionID = SectionID;
+        if (RE.RelType == ELF::R_OR1K_GOTPC_HI16 ||
+            RE.RelType == ELF::R_OR1K_GOTPC_LO16)
+          addRelocationForSection(RE, SectionID);
+        else if (P.second.SymbolName)
+          addRelocationForSymbol(RE, P.second.SymbolName);
+        else
+          addRelocationForSection(RE, P.second.SectionID);
+      }
     }
+    GOTEntries.clear();
+    PendingGOTSlotRelocs.clear();
+    PendingGOTRelativeRelocs.clear();
+    NeedsGOT = false;
   } else {
     report_fatal_error("Unable to allocate memory for GOT!");
   }
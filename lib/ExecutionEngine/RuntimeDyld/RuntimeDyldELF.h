@@ -33,7 +33,7 @@ std::error_code Check(std::error_code Err) {
 class RuntimeDyldELF : public RuntimeDyldImpl {
   void resolveRelocation(const SectionEntry &Section, uint64_t Offset,
                          uint64_t Value, uint32_t Type, int64_t Addend,
-                         uint64_t SymOffset = 0);
+                         uint64_t SymOffset = 0, unsigned GOTSectionID = 0);
 
   void resolveX86_64Relocation(const SectionEntry &Section, uint64_t Offset,
                                uint64_t Value, uint32_t Type, int64_t Addend,
@@ -57,6 +57,10 @@ class RuntimeDyldELF : public RuntimeDyldImpl {
   void resolveSystemZRelocation(const SectionEntry &Section, uint64_t Offset,
                                 uint64_t Value, uint32_t Type, int64_t Addend);
 
+  void resolveOR1KRelocation(const SectionEntry &Section, uint64_t Offset,
+                             uint32_t Value, uint32_t Type, int32_t Addend,
+                             unsigned GOTSectionID);
+
   unsigned getMaxStubSize() override {
     if (Arch == Triple::aarch64 || Arch == Triple::arm64 ||
         Arch == Triple::aarch64_be || Arch == Triple::arm64_be)
@@ -71,6 +75,8 @@ class RuntimeDyldELF : public RuntimeDyldImpl {
       return 6; // 2-byte jmp instruction + 32-bit relative address
     else if (Arch == Triple::systemz)
       return 16;
+    else if (Arch == Triple::or1k || Arch == Triple::or1kle)
+      return 16; // l.movhi; l.ori; l.jr; l.nop
     else
       return 0;
   }
@@ -98,6 +104,15 @@ class RuntimeDyldELF : public RuntimeDyldImpl {
   GOTRelocations GOTEntries; // List of entries requiring finalization.
   SmallVector<std::pair<SID, GOTRelocations>, 8> GOTs; // Allocated tables.
 
+  // OR1K relocations that need the address of the GOT being built, which is
+  // only allocated in finalizeLoad. Each entry is the relocation and the
+  // value it refers to; for GOT slots, the entry's offset is the slot index.
+  SmallVector<std::pair<RelocationEntry, RelocationValueRef>, 4>
+      PendingGOTRelativeRelocs;
+  SmallVector<std::pair<RelocationEntry, RelocationValueRef>, 4>
+      PendingGOTSlotRelocs;
+  bool NeedsGOT;
+
   // When a module is loaded we save the SectionID of the EH frame section
   // in a table until we receive a request to register all unregistered
   // EH frame sections with the memory manager.
@@ -105,7 +120,8 @@ class RuntimeDyldELF : public RuntimeDyldImpl {
   SmallVector<SID, 2> RegisteredEHFrameSections;
 
 public:
-  RuntimeDyldELF(RTDyldMemoryManager *mm) : RuntimeDyldImpl(mm) {}
+  RuntimeDyldELF(RTDyldMemoryManager *mm)
+      : RuntimeDyldImpl(mm), NeedsGOT(false) {}
 
   void resolveRelocation(const RelocationEntry &RE, uint64_t Value) override;
   relocation_iterator
@@ -109,26 +109,30 @@ public:
   /// The size of this relocation (MachO specific).
   unsigned Size;
 
+  /// GOTSectionID - the GOT that a GOT-relative relocation is resolved
+  /// against (ELF OR1K specific).
+  unsigned GOTSectionID;
+
   RelocationEntry(unsigned id, uint64_t offset, uint32_t type, int64_t addend)
       : SectionID(id), Offset(offset), RelType(type), Addend(addend),
-        SymOffset(0), IsPCRel(false), Size(0) {}
+        SymOffset(0), IsPCRel(false), Size(0), GOTSectionID(0) {}
 
   RelocationEntry(unsigned id, uint64_t offset, uint32_t type, int64_t addend,
                   uint64_t symoffset)
       : SectionID(id), Offset(offset), RelType(type), Addend(addend),
-        SymOffset(symoffset), IsPCRel(false), Size(0) {}
+        SymOffset(symoffset), IsPCRel(false), Size(0), GOTSectionID(0) {}
 
   RelocationEntry(unsigned id, uint64_t offset, uint32_t type, int64_t addend,
                   bool IsPCRel, unsigned Size)
       : SectionID(id), Offset(offset), RelType(type), Addend(addend),
-        SymOffset(0), IsPCRel(IsPCRel), Size(Size) {}
+        SymOffset(0), IsPCRel(IsPCRel), Size(Size), GOTSectionID(0) {}
 
   RelocationEntry(unsigned id, uint64_t offset, uint32_t type, int64_t addend,
                   unsigned SectionA, uint64_t SectionAOffset, unsigned SectionB,
                   uint64_t SectionBOffset, bool IsPCRel, unsigned Size)
       : SectionID(id), Offset(offset), RelType(type),
         Addend(SectionAOffset - SectionBOffset + addend), IsPCRel(IsPCRel),
-        Size(Size) {
+        Size(Size), GOTSectionID(0) {
     Sections.SectionA = SectionA;
     Sections.SectionB = SectionB;
   }
@@ -269,6 +273,14 @@ protected:
     *(Addr + 3) = Value & 0xFF;
   }
 
+  uint32_t readInt32BE(const uint8_t *Addr) {
+    uint32_t Value = ((uint32_t)*Addr << 24) | ((uint32_t)*(Addr + 1) << 16) |
+                     ((uint32_t)*(Addr + 2) << 8) | (uint32_t)*(Addr + 3);
+    if (IsTargetLittleEndian)
+      sys::swapByteOrder(Value);
+    return Value;
+  }
+
   void writeInt64BE(uint8_t *Addr, uint64_t Value) {
     if (IsTargetLittleEndian)
       sys::swapByteOrder(Value);
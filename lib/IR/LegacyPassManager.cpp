@@ -504,7 +504,8 @@ static TimingInfo *TheTimeInfo;
 // PMTopLevelManager implementation
 
 /// Initialize top level manager. Create first pass manager.
-PMTopLevelManager::PMTopLevelManager(PMDataManager *PMDM) {
+PMTopLevelManager::PMTopLevelManager(PMDataManager *PMDM)
+  : StreamFunctions(false) {
   PMDM->setTopLevelManager(this);
   addPassManager(PMDM);
   activeStack.push(PMDM);
@@ -1558,11 +1559,36 @@ bool FPPassManager::runOnFunction(Function &F) {
   return Changed;
 }
 
+/// hasAddressTakenBlocks - Return true if a blockaddress refers to one of F's
+/// blocks. Dropping such a body would rewrite the blockaddress users in other
+/// functions and globals, so these functions stay materialized.
+static bool hasAddressTakenBlocks(const Function &F) {
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    if (BB->hasAddressTaken())
+      return true;
+  return false;
+}
+
 bool FPPassManager::runOnModule(Module &M) {
   bool Changed = false;
+  bool Stream = TPM->shouldStreamFunctions();
+
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    Function &F = *I;
+    if (Stream && F.isMaterializable()) {
+      std::string ErrInfo;
+      if (F.Materialize(&ErrInfo))
+        report_fatal_error("Error reading bitcode file: " + Twine(ErrInfo));
+    }
 
-  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
-    Changed |= runOnFunction(*I);
+    Changed |= runOnFunction(F);
+
+    // Only the last function pass manager may drop the body; earlier ones
+    // would throw away the changes their passes made.
+    if (Stream && ReleaseFunctions && F.isDematerializable() &&
+        !hasAddressTakenBlocks(F))
+      F.Dematerialize();
+  }
 
   return Changed;
 }
@@ -1607,6 +1633,21 @@ MPPassManager::runOnModule(Module &M) {
   for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index)
     Changed |= getContainedPass(Index)->doInitialization(M);
 
+  // When streaming function bodies, each body stays resident from the first
+  // function pass manager that runs on it until the last one is done.
+  if (TPM->shouldStreamFunctions()) {
+    FPPassManager *LastFPPM = nullptr;
+    for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+      PMDataManager *PMD = getContainedPass(Index)->getAsPMDataManager();
+      if (PMD && PMD->getPassManagerType() == PMT_FunctionPassManager) {
+        LastFPPM = static_cast<FPPassManager *>(PMD);
+        LastFPPM->setReleaseFunctions(false);
+      }
+    }
+    if (LastFPPM)
+      LastFPPM->setReleaseFunctions(true);
+  }
+
   for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
     ModulePass *MP = getContainedPass(Index);
     bool LocalChanged = false;
@@ -1767,6 +1808,10 @@ bool PassManager::run(Module &M) {
   return PM->run(M);
 }
 
+void PassManager::setStreamFunctions(bool Stream) {
+  PM->setStreamFunctions(Stream);
+}
+
 //===----------------------------------------------------------------------===//
 // TimingInfo implementation
 
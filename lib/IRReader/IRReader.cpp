@@ -49,10 +49,29 @@ static Module *getLazyIRModule(MemoryBuffer *Buffer, SMDiagnostic &Err,
   return ParseAssembly(Buffer, nullptr, Err, Context);
 }
 
+/// Open an IR file for parsing. Bitcode does not need a trailing null, so the
+/// file is first mapped without one: this keeps large bitcode files zero-copy
+/// even when their size is a multiple of the page size. Anything else is
+/// textual IR, which is reopened with the null terminator the lexer needs.
+static ErrorOr<std::unique_ptr<MemoryBuffer>>
+openIRFile(const std::string &Filename) {
+  if (Filename != "-") {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
+        MemoryBuffer::getFile(Filename, -1, /*RequiresNullTerminator=*/false);
+    if (FileOrErr.getError())
+      return FileOrErr;
+    MemoryBuffer *Buffer = FileOrErr.get().get();
+    if (isBitcode((const unsigned char *)Buffer->getBufferStart(),
+                  (const unsigned char *)Buffer->getBufferEnd()))
+      return FileOrErr;
+  }
+
+  return MemoryBuffer::getFileOrSTDIN(Filename);
+}
+
 Module *llvm::getLazyIRFileModule(const std::string &Filename, SMDiagnostic &Err,
                                   LLVMContext &Context) {
-  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
-      MemoryBuffer::getFileOrSTDIN(Filename);
+  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr = openIRFile(Filename);
   if (std::error_code EC = FileOrErr.getError()) {
     Err = SMDiagnostic(Filename, SourceMgr::DK_Error,
                        "Could not open input file: " + EC.message());
@@ -86,8 +105,7 @@ Module *llvm::ParseIR(MemoryBuffer *Buffer, SMDiagnostic &Err,
 
 Module *llvm::ParseIRFile(const std::string &Filename, SMDiagnostic &Err,
                           LLVMContext &Context) {
-  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
-      MemoryBuffer::getFileOrSTDIN(Filename);
+  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr = openIRFile(Filename);
   if (std::error_code EC = FileOrErr.getError()) {
     Err = SMDiagnostic(Filename, SourceMgr::DK_Error,
                        "Could not open input file: " + EC.message());
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/LTO/LTOCodeGenerator.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -33,15 +34,20 @@
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Object/ObjectFile.h"
 #include "llvm/PassManager.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetLibraryInfo.h"
@@ -66,7 +72,8 @@ LTOCodeGenerator::LTOCodeGenerator()
     : Context(getGlobalContext()), IRLinker(new Module("ld-temp.o", Context)),
       TargetMach(nullptr), EmitDwarfDebugInfo(false),
       ScopeRestrictionsDone(false), CodeModel(LTO_CODEGEN_PIC_MODEL_DEFAULT),
-      NativeObjectFile(nullptr), DiagHandler(nullptr), DiagContext(nullptr) {
+      NativeObjectFile(nullptr), CodeGenPartitions(1), CacheSizeLimit(0),
+      DiagHandler(nullptr), DiagContext(nullptr) {
   initializeLTOPasses();
 }
 
@@ -202,8 +209,12 @@ bool LTOCodeGenerator::compile_to_file(const char** name,
   // generate object file
   tool_output_file objFile(Filename.c_str(), FD);
 
-  bool genResult = generateObjectFile(objFile.os(), disableOpt, disableInline,
-                                      disableGVNLoadPRE, errMsg);
+  bool genResult =
+      CacheDir.empty()
+          ? generateObjectFile(objFile.os(), disableOpt, disableInline,
+                               disableGVNLoadPRE, errMsg)
+          : generateCachedObjectFile(objFile.os(), disableOpt, disableInline,
+                                     disableGVNLoadPRE, errMsg);
   objFile.os().close();
   if (objFile.os().has_error()) {
     objFile.os().clear_error();
@@ -440,11 +451,10 @@ void LTOCodeGenerator::applyScopeRestrictions() {
 }
 
 /// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
-                                          bool DisableOpt,
-                                          bool DisableInline,
-                                          bool DisableGVNLoadPRE,
-                                          std::string &errMsg) {
+bool LTOCodeGenerator::optimize(bool DisableOpt,
+                                bool DisableInline,
+                                bool DisableGVNLoadPRE,
+                                std::string &errMsg) {
   if (!this->determineTarget(errMsg))
     return false;
 
@@ -482,9 +492,17 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   passes.add(createVerifierPass());
   passes.add(createDebugInfoVerifierPass());
 
+  // Run our queue of passes all at once now, efficiently.
+  passes.run(*mergedModule);
+  return true;
+}
+
+/// Run the code generator for TM over M, writing an object file to out.
+static bool emitObjectFile(Module &M, TargetMachine &TM, raw_ostream &out,
+                           std::string &errMsg) {
   PassManager codeGenPasses;
 
-  codeGenPasses.add(new DataLayoutPass(mergedModule));
+  codeGenPasses.add(new DataLayoutPass(&M));
 
   formatted_raw_ostream Out(out);
 
@@ -492,18 +510,858 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   // the ObjCARCContractPass must be run, so do it unconditionally here.
   codeGenPasses.add(createObjCARCContractPass());
 
-  if (TargetMach->addPassesToEmitFile(codeGenPasses, Out,
-                                      TargetMachine::CGFT_ObjectFile)) {
+  if (TM.addPassesToEmitFile(codeGenPasses, Out,
+                             TargetMachine::CGFT_ObjectFile)) {
     errMsg = "target file type not supported";
     return false;
   }
 
-  // Run our queue of passes all at once now, efficiently.
-  passes.run(*mergedModule);
-
   // Run the code generator, and write assembly file
-  codeGenPasses.run(*mergedModule);
+  codeGenPasses.run(M);
+
+  return true;
+}
+
+bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
+                                          bool DisableOpt,
+                                          bool DisableInline,
+                                          bool DisableGVNLoadPRE,
+                                          std::string &errMsg) {
+  if (!optimize(DisableOpt, DisableInline, DisableGVNLoadPRE, errMsg))
+    return false;
+
+  return emitObjectFile(*IRLinker.getModule(), *TargetMach, out, errMsg);
+}
+
+//===----------------------------------------------------------------------===//
+// Object cache
+//===----------------------------------------------------------------------===//
+//
+// The cache directory holds two kinds of entries, both named after the MD5 of
+// a module's bitcode together with everything else that affects the code
+// generated for it:
+//
+//   llvm-lto-<hash>.o    the native object for a module.
+//   llvm-lto-<hash>.lst  for a partitioned link, the hashes of the objects of
+//                        its partitions, one per line.
+//
+// Entries are written to a temporary file and renamed into place, so readers
+// never see a partial entry. Links that need the same missing object take a
+// lock on it and all but one wait for it to be generated.
+
+/// Serialize M into Buffer.
+static void writeModuleToBuffer(Module &M, SmallVectorImpl<char> &Buffer) {
+  raw_svector_ostream OS(Buffer);
+  WriteBitcodeToFile(&M, OS);
+}
+
+/// Return the MD5 of Config and Bitcode as a hex string.
+static std::string computeCacheKey(StringRef Config, StringRef Bitcode) {
+  MD5 Hash;
+  Hash.update(Config);
+  Hash.update(Bitcode);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+  return Str.str();
+}
+
+static std::string getCacheEntryPath(StringRef CacheDir, StringRef Key,
+                                     StringRef Ext) {
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, "llvm-lto-" + Key + "." + Ext);
+  return Path.str();
+}
+
+/// Read the cache entry at Path, and mark it as recently used.
+static std::unique_ptr<MemoryBuffer> readCacheEntry(StringRef Path) {
+  int FD;
+  if (sys::fs::openFileForRead(Path, FD))
+    return nullptr;
+
+  // Pruning removes the entries with the oldest modification time first.
+  // Touch the file that was opened; reopening the path could recreate an
+  // entry that a concurrent prune just removed.
+  sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getOpenFile(FD, Path.str().c_str(), -1, false);
+  raw_fd_ostream Closer(FD, /*shouldClose=*/true);
+  if (BufferOrErr.getError())
+    return nullptr;
+  return std::move(BufferOrErr.get());
+}
+
+/// Read the cached object at Path. An entry that is not a valid object file
+/// is removed, and the object is generated again.
+static std::unique_ptr<MemoryBuffer> readCachedObject(StringRef Path) {
+  std::unique_ptr<MemoryBuffer> Entry = readCacheEntry(Path);
+  if (!Entry)
+    return nullptr;
+
+  std::unique_ptr<MemoryBuffer> Contents(MemoryBuffer::getMemBuffer(
+      Entry->getBuffer(), Path, /*RequiresNullTerminator=*/false));
+  ErrorOr<object::ObjectFile *> Obj =
+      object::ObjectFile::createObjectFile(Contents);
+  if (!Obj) {
+    sys::fs::remove(Path);
+    return nullptr;
+  }
+  delete Obj.get();
+  return Entry;
+}
+
+/// Atomically store Data as the cache entry at Path. Failing to do so is not
+/// an error; the entry is simply not cached.
+static void writeCacheEntry(StringRef Path, StringRef Data) {
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::createUniqueFile(Path + ".tmp-%%%%%%", FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Data;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath.str());
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath.str(), Path))
+    sys::fs::remove(TempPath.str());
+}
+
+typedef std::function<bool(raw_ostream &, std::string &)> ObjectGeneratorTy;
+
+/// Write the object cached under Key to Out. If it is not cached yet, generate
+/// it with Generate and store it.
+static bool getCachedObject(StringRef CacheDir, StringRef Key, raw_ostream &Out,
+                            std::string &errMsg,
+                            const ObjectGeneratorTy &Generate) {
+  std::string Path = getCacheEntryPath(CacheDir, Key, "o");
+  while (true) {
+    if (std::unique_ptr<MemoryBuffer> Entry = readCachedObject(Path)) {
+      Out << Entry->getBuffer();
+      return true;
+    }
+
+    LockFileManager Lock(Path);
+    switch (Lock.getState()) {
+    case LockFileManager::LFS_Error:
+      // The cache directory is not usable; just generate the object.
+      return Generate(Out, errMsg);
+
+    case LockFileManager::LFS_Owned: {
+      // Another link may have stored the entry before we took the lock.
+      if (std::unique_ptr<MemoryBuffer> Entry = readCachedObject(Path)) {
+        Out << Entry->getBuffer();
+        return true;
+      }
+      SmallVector<char, 0> Object;
+      {
+        raw_svector_ostream OS(Object);
+        if (!Generate(OS, errMsg))
+          return false;
+      }
+      StringRef Data(Object.data(), Object.size());
+      writeCacheEntry(Path, Data);
+      Out << Data;
+      return true;
+    }
+
+    case LockFileManager::LFS_Shared:
+      // Another link is generating this object. If it finishes, pick up its
+      // entry; if it died, try to take the lock ourselves.
+      if (Lock.waitForUnlock() == LockFileManager::Res_Timeout)
+        return Generate(Out, errMsg);
+      break;
+    }
+  }
+}
+
+/// Read the objects recorded in the partition list LinkKey. Returns false
+/// unless the list and every object it names are in the cache.
+static bool
+readCachedPartitions(StringRef CacheDir, StringRef LinkKey, unsigned Count,
+                     std::vector<std::unique_ptr<MemoryBuffer> > &Objects) {
+  std::unique_ptr<MemoryBuffer> List =
+      readCacheEntry(getCacheEntryPath(CacheDir, LinkKey, "lst"));
+  if (!List)
+    return false;
+
+  SmallVector<StringRef, 16> Keys;
+  List->getBuffer().split(Keys, "\n", -1, /*KeepEmpty=*/false);
+  if (Keys.size() != Count)
+    return false;
+
+  for (unsigned I = 0; I != Count; ++I) {
+    std::unique_ptr<MemoryBuffer> Object =
+        readCachedObject(getCacheEntryPath(CacheDir, Keys[I], "o"));
+    if (!Object)
+      return false;
+    Objects.push_back(std::move(Object));
+  }
+  return true;
+}
+
+namespace {
+struct CacheEntryInfo {
+  sys::TimeValue Time;
+  uint64_t Size;
+  std::string Path;
+
+  bool operator<(const CacheEntryInfo &RHS) const { return Time < RHS.Time; }
+};
+}
+
+/// Temporaries and lock files older than this many seconds were left behind
+/// by a link that crashed. A live link renames or removes its temporaries
+/// within seconds, and LockFileManager stops waiting after five minutes.
+static const uint64_t StaleCacheFileSeconds = 60 * 60;
+
+/// Remove the least recently used entries of the cache until it takes up no
+/// more than Limit bytes. A Limit of zero means no entry is evicted.
+/// Stale temporaries and lock files are always removed; fresh ones count
+/// against the limit but belong to a running link and are left alone.
+static void pruneCache(StringRef CacheDir, uint64_t Limit) {
+  sys::TimeValue StaleBefore =
+      sys::TimeValue::now() - sys::TimeValue(StaleCacheFileSeconds, 0);
+  std::vector<CacheEntryInfo> Entries;
+  uint64_t TotalSize = 0;
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+       I.increment(EC)) {
+    StringRef Name = sys::path::filename(I->path());
+    if (!Name.startswith("llvm-lto-"))
+      continue;
+    bool IsEntry = Name.endswith(".o") || Name.endswith(".lst");
+    bool IsScratch = Name.find(".tmp-") != StringRef::npos ||
+                     Name.find(".lock") != StringRef::npos;
+    if (!IsEntry && !IsScratch)
+      continue;
+    sys::fs::file_status Status;
+    if (I->status(Status))
+      continue;
+    if (IsScratch) {
+      if (Status.getLastModificationTime() < StaleBefore &&
+          !sys::fs::remove(I->path()))
+        continue;
+      TotalSize += Status.getSize();
+      continue;
+    }
+    CacheEntryInfo Entry;
+    Entry.Time = Status.getLastModificationTime();
+    Entry.Size = Status.getSize();
+    Entry.Path = I->path();
+    Entries.push_back(Entry);
+    TotalSize += Entry.Size;
+  }
+
+  if (!Limit || TotalSize <= Limit)
+    return;
+  std::sort(Entries.begin(), Entries.end());
+  for (unsigned I = 0, E = Entries.size(); I != E && TotalSize > Limit; ++I) {
+    if (!sys::fs::remove(Entries[I].Path))
+      TotalSize -= Entries[I].Size;
+  }
+}
+
+/// Describe everything besides the bitcode that affects the generated code,
+/// for use in cache keys.
+std::string LTOCodeGenerator::getCacheConfig(bool DisableOpt,
+                                             bool DisableInline,
+                                             bool DisableGVNLoadPRE) {
+  std::string Config;
+  raw_string_ostream OS(Config);
+  OS << getVersionString() << '\n'
+     << TargetMach->getTargetTriple() << '\n'
+     << TargetMach->getTargetCPU() << '\n'
+     << TargetMach->getTargetFeatureString() << '\n'
+     << TargetMach->getRelocationModel() << ' ' << TargetMach->getCodeModel()
+     << ' ' << TargetMach->getOptLevel() << ' ' << CodeGenPartitions << ' '
+     << DisableOpt << DisableInline << DisableGVNLoadPRE << EmitDwarfDebugInfo
+     << '\n';
+
+  const TargetOptions &TO = TargetMach->Options;
+  OS << TO.NoFramePointerElim << TO.LessPreciseFPMADOption << TO.UnsafeFPMath
+     << TO.NoInfsFPMath << TO.NoNaNsFPMath
+     << TO.HonorSignDependentRoundingFPMathOption << TO.UseSoftFloat
+     << TO.NoZerosInBSS << TO.GuaranteedTailCallOpt << TO.DisableTailCalls
+     << TO.EnableFastISel << TO.PositionIndependentExecutable
+     << TO.UseInitArray << TO.CompressDebugSections << TO.FunctionSections
+     << TO.DataSections << TO.TrapUnreachable << ' ' << TO.StackAlignmentOverride
+     << ' ' << TO.FloatABIType << ' ' << TO.AllowFPOpFusion << ' '
+     << TO.TrapFuncName << '\n';
+
+  for (unsigned I = 0, E = CodegenOptions.size(); I != E; ++I)
+    OS << CodegenOptions[I] << '\n';
+  return OS.str();
+}
+
+bool LTOCodeGenerator::generateCachedObjectFile(raw_ostream &out,
+                                                bool DisableOpt,
+                                                bool DisableInline,
+                                                bool DisableGVNLoadPRE,
+                                                std::string &errMsg) {
+  if (!determineTarget(errMsg))
+    return false;
+  applyScopeRestrictions();
+
+  // The key covers the merged module as it is before optimization, so a hit
+  // skips both the optimizer and the code generator.
+  SmallVector<char, 0> Bitcode;
+  writeModuleToBuffer(*IRLinker.getModule(), Bitcode);
+  std::string Key =
+      computeCacheKey(getCacheConfig(DisableOpt, DisableInline,
+                                     DisableGVNLoadPRE),
+                      StringRef(Bitcode.data(), Bitcode.size()));
+  Bitcode.clear();
+
+  bool Result = getCachedObject(
+      CacheDir, Key, out, errMsg, [&](raw_ostream &OS, std::string &Err) {
+        return generateObjectFile(OS, DisableOpt, DisableInline,
+                                  DisableGVNLoadPRE, Err);
+      });
+  pruneCache(CacheDir, CacheSizeLimit);
+  return Result;
+}
+
+//===----------------------------------------------------------------------===//
+// Parallel code generation
+//===----------------------------------------------------------------------===//
+
+/// Owner of globals that do not belong to any one partition: declarations, and
+/// the llvm.used lists, which are split between the partitions.
+static const unsigned NoPartition = ~0U;
+
+static bool isUsedList(const GlobalValue *GV) {
+  return GV->getName() == "llvm.used" || GV->getName() == "llvm.compiler.used";
+}
+
+/// Collect the global values of M in a fixed order: variables, functions, then
+/// aliases. The bitcode writer and reader preserve this order, so an index
+/// into it names the same global before and after a round trip.
+static void collectGlobalValues(Module &M, std::vector<GlobalValue *> &GVs) {
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    GVs.push_back(I);
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    GVs.push_back(I);
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end(); I != E;
+       ++I)
+    GVs.push_back(I);
+}
+
+namespace {
+/// Assigns every definition in a module to one of a fixed number of code
+/// generation partitions.
+///
+/// Definitions that have to be emitted into the same object (members of a
+/// comdat, aliases and their targets, and functions whose block addresses are
+/// taken together with the users of those addresses) are first merged into
+/// groups. The groups are laid out in depth-first order over the reference
+/// graph, so that callees tend to follow their callers, and that sequence is
+/// cut into runs of roughly equal size. Nothing depends on pointer values, so
+/// the result is a function of the module and the partition count alone.
+class ModulePartitioner {
+  Module &M;
+  std::vector<GlobalValue *> GVs;
+  DenseMap<const GlobalValue *, unsigned> Index;
+
+  /// Definitions referenced by each definition, in order of first use.
+  std::vector<SmallVector<unsigned, 8> > Refs;
+
+  /// Union-find forest over the definitions.
+  std::vector<unsigned> Leader;
+
+  unsigned findLeader(unsigned I) {
+    while (Leader[I] != I)
+      I = Leader[I] = Leader[Leader[I]];
+    return I;
+  }
+
+  void unite(unsigned A, unsigned B) {
+    A = findLeader(A);
+    B = findLeader(B);
+    // Keep the earliest definition as the leader.
+    if (A < B)
+      Leader[B] = A;
+    else
+      Leader[A] = B;
+  }
+
+  bool isDefinition(const GlobalValue *GV) const {
+    return !GV->isDeclaration() && !isUsedList(GV);
+  }
+
+  /// Whether GV is assigned by the depth-first layout. Appending globals such
+  /// as llvm.global_ctors all go to the first partition.
+  bool isPartitioned(const GlobalValue *GV) const {
+    return isDefinition(GV) && !GV->hasAppendingLinkage();
+  }
+
+  void addRefs(unsigned User, const Value *V,
+               SmallPtrSet<const Value *, 16> &Visited);
+
+public:
+  ModulePartitioner(Module &M);
+
+  /// Compute the partition of each global in the order produced by
+  /// collectGlobalValues(), or NoPartition for globals that are not
+  /// definitions. Local definitions referenced from another partition are
+  /// given hidden external linkage and a unique name.
+  void partition(unsigned NumPartitions, std::vector<unsigned> &Owner);
+};
+}
+
+ModulePartitioner::ModulePartitioner(Module &M) : M(M) {
+  collectGlobalValues(M, GVs);
+  for (unsigned I = 0, E = GVs.size(); I != E; ++I)
+    Index[GVs[I]] = I;
+  Refs.resize(GVs.size());
+  Leader.resize(GVs.size());
+  for (unsigned I = 0, E = GVs.size(); I != E; ++I)
+    Leader[I] = I;
+}
+
+void ModulePartitioner::addRefs(unsigned User, const Value *V,
+                                SmallPtrSet<const Value *, 16> &Visited) {
+  if (!isa<Constant>(V) || !Visited.insert(V))
+    return;
+
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
+    unsigned Def = Index.lookup(GV);
+    if (!isDefinition(GV))
+      return;
+    Refs[User].push_back(Def);
+    // An alias has to be emitted next to the object it points into.
+    if (isa<GlobalAlias>(GVs[User]) && isPartitioned(GV))
+      unite(User, Def);
+    return;
+  }
+
+  // A block address can only be resolved in the module that defines the
+  // function.
+  if (const BlockAddress *BA = dyn_cast<BlockAddress>(V)) {
+    unsigned Def = Index.lookup(BA->getFunction());
+    Refs[User].push_back(Def);
+    if (isPartitioned(GVs[User]))
+      unite(User, Def);
+    return;
+  }
+
+  const Constant *C = cast<Constant>(V);
+  for (unsigned I = 0, E = C->getNumOperands(); I != E; ++I)
+    addRefs(User, C->getOperand(I), Visited);
+}
+
+void ModulePartitioner::partition(unsigned NumPartitions,
+                                  std::vector<unsigned> &Owner) {
+  std::vector<uint64_t> Weight(GVs.size());
+  DenseMap<const Comdat *, unsigned> ComdatLeader;
+
+  // Gather references and the constraints between definitions.
+  for (unsigned I = 0, E = GVs.size(); I != E; ++I) {
+    GlobalValue *GV = GVs[I];
+    if (!isDefinition(GV))
+      continue;
+
+    SmallPtrSet<const Value *, 16> Visited;
+    Weight[I] = 1;
+    if (Function *F = dyn_cast<Function>(GV)) {
+      for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+        for (BasicBlock::iterator II = BB->begin(), IE = BB->end(); II != IE;
+             ++II) {
+          ++Weight[I];
+          for (unsigned Op = 0, OE = II->getNumOperands(); Op != OE; ++Op)
+            addRefs(I, II->getOperand(Op), Visited);
+        }
+    } else if (GlobalVariable *GVar = dyn_cast<GlobalVariable>(GV)) {
+      addRefs(I, GVar->getInitializer(), Visited);
+    } else {
+      addRefs(I, cast<GlobalAlias>(GV)->getAliasee(), Visited);
+    }
+
+    if (const Comdat *C = GV->getComdat()) {
+      std::pair<DenseMap<const Comdat *, unsigned>::iterator, bool> Entry =
+          ComdatLeader.insert(std::make_pair(C, I));
+      if (!Entry.second)
+        unite(I, Entry.first->second);
+    }
+  }
+
+  std::vector<std::vector<unsigned> > Members(GVs.size());
+  std::vector<uint64_t> GroupWeight(GVs.size());
+  uint64_t TotalWeight = 0;
+  for (unsigned I = 0, E = GVs.size(); I != E; ++I) {
+    if (!isPartitioned(GVs[I]))
+      continue;
+    unsigned L = findLeader(I);
+    Members[L].push_back(I);
+    GroupWeight[L] += Weight[I];
+    TotalWeight += Weight[I];
+  }
+
+  // Lay the groups out depth-first along references, starting from the
+  // functions in module order.
+  std::vector<unsigned> Roots;
+  for (unsigned I = 0, E = GVs.size(); I != E; ++I)
+    if (isa<Function>(GVs[I]) && isPartitioned(GVs[I]))
+      Roots.push_back(I);
+  for (unsigned I = 0, E = GVs.size(); I != E; ++I)
+    if (!isa<Function>(GVs[I]) && isPartitioned(GVs[I]))
+      Roots.push_back(I);
+
+  std::vector<bool> Placed(GVs.size());
+  std::vector<unsigned> Layout;
+  std::vector<unsigned> Worklist;
+  for (unsigned R = 0, RE = Roots.size(); R != RE; ++R) {
+    Worklist.push_back(findLeader(Roots[R]));
+    while (!Worklist.empty()) {
+      unsigned L = Worklist.back();
+      Worklist.pop_back();
+      if (Placed[L])
+        continue;
+      Placed[L] = true;
+      Layout.push_back(L);
+
+      // Push in reverse so that the first reference is visited first.
+      const std::vector<unsigned> &Group = Members[L];
+      for (unsigned MI = Group.size(); MI != 0; --MI) {
+        const SmallVectorImpl<unsigned> &R = Refs[Group[MI - 1]];
+        for (unsigned RI = R.size(); RI != 0; --RI)
+          if (isPartitioned(GVs[R[RI - 1]]))
+            Worklist.push_back(findLeader(R[RI - 1]));
+      }
+    }
+  }
+
+  // Cut the layout into runs of roughly TotalWeight / NumPartitions.
+  std::vector<unsigned> GroupPartition(GVs.size());
+  uint64_t Accumulated = 0;
+  unsigned P = 0;
+  for (unsigned I = 0, E = Layout.size(); I != E; ++I) {
+    if (P + 1 < NumPartitions &&
+        Accumulated >= TotalWeight * (P + 1) / NumPartitions)
+      ++P;
+    GroupPartition[Layout[I]] = P;
+    Accumulated += GroupWeight[Layout[I]];
+  }
+
+  Owner.assign(GVs.size(), NoPartition);
+  for (unsigned I = 0, E = GVs.size(); I != E; ++I) {
+    if (isPartitioned(GVs[I]))
+      Owner[I] = GroupPartition[findLeader(I)];
+    else if (isDefinition(GVs[I]))
+      Owner[I] = 0;
+  }
+
+  // Local definitions used from another partition must become visible to it.
+  std::vector<bool> Promote(GVs.size());
+  for (unsigned I = 0, E = GVs.size(); I != E; ++I)
+    for (unsigned RI = 0, RE = Refs[I].size(); RI != RE; ++RI) {
+      unsigned Def = Refs[I][RI];
+      if (Owner[Def] != Owner[I] && GVs[Def]->hasLocalLinkage())
+        Promote[Def] = true;
+    }
+
+  for (unsigned I = 0, E = GVs.size(); I != E; ++I) {
+    if (!Promote[I])
+      continue;
+    GlobalValue *GV = GVs[I];
+    StringRef Name = GV->hasName() ? GV->getName() : "__unnamed";
+    GV->setName(Name + ".llvm.lto." + Twine(I));
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+  }
+}
+
+/// Rebuild the llvm.used style list Name to hold only the globals that Owner
+/// assigns to Partition.
+static void splitUsedList(Module &M, StringRef Name, unsigned Partition,
+                          const DenseMap<const GlobalValue *, unsigned> &Owner) {
+  GlobalVariable *Used = M.getGlobalVariable(Name, true);
+  if (!Used || !Used->hasInitializer())
+    return;
+
+  std::vector<Constant *> Kept;
+  const ConstantArray *Init = dyn_cast<ConstantArray>(Used->getInitializer());
+  for (unsigned I = 0, E = Init ? Init->getNumOperands() : 0; I != E; ++I) {
+    Constant *Op = Init->getOperand(I);
+    const GlobalValue *GV = dyn_cast<GlobalValue>(Op->stripPointerCasts());
+    if (GV && Owner.lookup(GV) == Partition)
+      Kept.push_back(Op);
+  }
+
+  if (!Kept.empty()) {
+    ArrayType *ATy = ArrayType::get(Kept[0]->getType(), Kept.size());
+    GlobalVariable *NewUsed =
+        new GlobalVariable(M, ATy, false, GlobalValue::AppendingLinkage,
+                           ConstantArray::get(ATy, Kept), "");
+    NewUsed->takeName(Used);
+    NewUsed->setSection("llvm.metadata");
+  }
+  Used->eraseFromParent();
+}
+
+/// Strip M down to the definitions that Owner assigns to Partition, leaving
+/// declarations for the rest.
+static bool extractPartition(Module &M, ArrayRef<unsigned> Owner,
+                             unsigned Partition, std::string &errMsg) {
+  std::vector<GlobalValue *> GVs;
+  collectGlobalValues(M, GVs);
+  if (GVs.size() != Owner.size()) {
+    errMsg = "partitioned module does not match its bitcode";
+    return false;
+  }
+
+  DenseMap<const GlobalValue *, unsigned> OwnerMap;
+  for (unsigned I = 0, E = GVs.size(); I != E; ++I) {
+    OwnerMap[GVs[I]] = Owner[I];
+    if (Owner[I] == Partition && GVs[I]->isMaterializable() &&
+        GVs[I]->Materialize(&errMsg))
+      return false;
+  }
+
+  // The lists are rebuilt at the end of the module; the entries for the old
+  // ones in GVs are never partitioned and are not looked at again.
+  splitUsedList(M, "llvm.used", Partition, OwnerMap);
+  splitUsedList(M, "llvm.compiler.used", Partition, OwnerMap);
+
+  if (Partition != 0)
+    M.setModuleInlineAsm("");
+
+  std::vector<GlobalValue *> Dead;
+  for (unsigned I = 0, E = GVs.size(); I != E; ++I) {
+    if (Owner[I] == NoPartition || Owner[I] == Partition)
+      continue;
+    GlobalValue *GV = GVs[I];
+    if (GV->hasLocalLinkage() || GV->hasAppendingLinkage())
+      Dead.push_back(GV);
+
+    if (Function *F = dyn_cast<Function>(GV)) {
+      F->deleteBody();
+      F->setComdat(nullptr);
+    } else if (GlobalVariable *GVar = dyn_cast<GlobalVariable>(GV)) {
+      GVar->setInitializer(nullptr);
+      GVar->setLinkage(GlobalValue::ExternalLinkage);
+      GVar->setComdat(nullptr);
+    } else if (!GV->hasLocalLinkage()) {
+      // An alias cannot be a declaration; replace it with one of the kind of
+      // object it points to.
+      GlobalAlias *GA = cast<GlobalAlias>(GV);
+      PointerType *PTy = GA->getType();
+      GlobalValue *Decl;
+      if (FunctionType *FTy = dyn_cast<FunctionType>(PTy->getElementType()))
+        Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", &M);
+      else
+        Decl = new GlobalVariable(M, PTy->getElementType(), false,
+                                  GlobalValue::ExternalLinkage, nullptr, "",
+                                  nullptr, GA->getThreadLocalMode(),
+                                  PTy->getAddressSpace());
+      Decl->takeName(GA);
+      Decl->setVisibility(GA->getVisibility());
+      GA->replaceAllUsesWith(Decl);
+      GA->eraseFromParent();
+    }
+  }
+
+  // Local definitions that stayed local are only used by other definitions
+  // in their own partition, so with those gone they can be dropped. Aliases
+  // go first since they may be the last users of a function or variable.
+  for (unsigned I = 0, E = Dead.size(); I != E; ++I)
+    if (isa<GlobalAlias>(Dead[I]))
+      Dead[I]->eraseFromParent();
+  for (unsigned I = 0, E = Dead.size(); I != E; ++I) {
+    GlobalValue *GV = Dead[I];
+    if (isa<GlobalAlias>(GV))
+      continue;
+    GV->removeDeadConstantUsers();
+    if (GV->use_empty())
+      GV->eraseFromParent();
+    else
+      GV->setLinkage(GlobalValue::ExternalLinkage);
+  }
+  return true;
+}
+
+/// Load partition number Partition of the module serialized in Bitcode into a
+/// fresh context and generate code for it with a copy of TM. If CacheDir is
+/// not empty, the object is looked up in and stored to the cache, and its key
+/// is returned in Key.
+static bool generatePartition(StringRef Bitcode, ArrayRef<unsigned> Owner,
+                              unsigned Partition, const TargetMachine &TM,
+                              StringRef CacheDir, StringRef CacheConfig,
+                              raw_ostream &Out, std::string &Key,
+                              std::string &errMsg) {
+  LLVMContext Context;
+  MemoryBuffer *Buffer =
+      MemoryBuffer::getMemBuffer(Bitcode, "ld-temp.o", false);
+  ErrorOr<Module *> ModuleOrErr = getLazyBitcodeModule(Buffer, Context);
+  if (std::error_code EC = ModuleOrErr.getError()) {
+    delete Buffer;
+    errMsg = EC.message();
+    return false;
+  }
+  std::unique_ptr<Module> M(ModuleOrErr.get());
+
+  if (!extractPartition(*M, Owner, Partition, errMsg))
+    return false;
+
+  std::unique_ptr<TargetMachine> PartitionTM(
+      TM.getTarget().createTargetMachine(
+          TM.getTargetTriple(), TM.getTargetCPU(), TM.getTargetFeatureString(),
+          TM.Options, TM.getRelocationModel(), TM.getCodeModel(),
+          TM.getOptLevel()));
+  if (CacheDir.empty())
+    return emitObjectFile(*M, *PartitionTM, Out, errMsg);
+
+  // A partition whose code did not change since an earlier link is reused
+  // even if the rest of the program did.
+  SmallVector<char, 0> PartitionBitcode;
+  writeModuleToBuffer(*M, PartitionBitcode);
+  Key = computeCacheKey(CacheConfig, StringRef(PartitionBitcode.data(),
+                                               PartitionBitcode.size()));
+  PartitionBitcode.clear();
+  return getCachedObject(CacheDir, Key, Out, errMsg,
+                         [&](raw_ostream &OS, std::string &Err) {
+    return emitObjectFile(*M, *PartitionTM, OS, Err);
+  });
+}
+
+bool LTOCodeGenerator::compile_to_files(const char ***names,
+                                        unsigned *count,
+                                        bool disableOpt,
+                                        bool disableInline,
+                                        bool disableGVNLoadPRE,
+                                        std::string &errMsg) {
+  NativeObjectPaths.clear();
+  NativeObjectNames.clear();
+
+  if (CodeGenPartitions == 1) {
+    const char *name;
+    if (!compile_to_file(&name, disableOpt, disableInline, disableGVNLoadPRE,
+                         errMsg))
+      return false;
+    NativeObjectPaths.push_back(name);
+  } else {
+    // With a cache, first look for the partition list of an identical link,
+    // keyed on the merged module before optimization.
+    std::string CacheConfig, LinkKey;
+    std::vector<std::unique_ptr<MemoryBuffer> > CachedObjects;
+    bool FromCache = false;
+    if (!CacheDir.empty()) {
+      if (!determineTarget(errMsg))
+        return false;
+      applyScopeRestrictions();
+      CacheConfig = getCacheConfig(disableOpt, disableInline,
+                                   disableGVNLoadPRE);
+      SmallVector<char, 0> Bitcode;
+      writeModuleToBuffer(*IRLinker.getModule(), Bitcode);
+      LinkKey = computeCacheKey(CacheConfig,
+                                StringRef(Bitcode.data(), Bitcode.size()));
+      FromCache = readCachedPartitions(CacheDir, LinkKey, CodeGenPartitions,
+                                       CachedObjects);
+    }
+
+    std::vector<std::unique_ptr<tool_output_file> > Files;
+    for (unsigned I = 0; I != CodeGenPartitions; ++I) {
+      SmallString<128> Filename;
+      int FD;
+      std::error_code EC =
+          sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+      if (EC) {
+        errMsg = EC.message();
+        for (unsigned J = 0; J != I; ++J)
+          sys::fs::remove(NativeObjectPaths[J]);
+        NativeObjectPaths.clear();
+        return false;
+      }
+      NativeObjectPaths.push_back(Filename.str());
+      Files.push_back(std::unique_ptr<tool_output_file>(
+          new tool_output_file(Filename.c_str(), FD)));
+    }
+
+    std::vector<std::string> Errors(CodeGenPartitions);
+    std::vector<char> Succeeded(CodeGenPartitions);
+    std::vector<std::string> PartitionKeys(CodeGenPartitions);
+    if (FromCache) {
+      for (unsigned I = 0; I != CodeGenPartitions; ++I) {
+        Files[I]->os() << CachedObjects[I]->getBuffer();
+        Succeeded[I] = true;
+      }
+      CachedObjects.clear();
+    } else {
+      if (!optimize(disableOpt, disableInline, disableGVNLoadPRE, errMsg)) {
+        for (unsigned I = 0; I != CodeGenPartitions; ++I)
+          sys::fs::remove(NativeObjectPaths[I]);
+        NativeObjectPaths.clear();
+        return false;
+      }
+
+      // Decide the partitions on the optimized module and hand it to the
+      // workers as bitcode, so each can read it into a context of its own.
+      // The function index lets every worker load only the bodies it
+      // compiles.
+      Module *mergedModule = IRLinker.getModule();
+      std::vector<unsigned> Owner;
+      ModulePartitioner(*mergedModule).partition(CodeGenPartitions, Owner);
+
+      SmallVector<char, 0> Bitcode;
+      writeModuleToBuffer(*mergedModule, Bitcode);
+
+      StringRef BitcodeRef(Bitcode.data(), Bitcode.size());
+      const TargetMachine &TM = *TargetMach;
+      ThreadPool Pool(CodeGenPartitions);
+      for (unsigned I = 0; I != CodeGenPartitions; ++I)
+        Pool.async([&, I] {
+          Succeeded[I] = generatePartition(BitcodeRef, Owner, I, TM, CacheDir,
+                                           CacheConfig, Files[I]->os(),
+                                           PartitionKeys[I], Errors[I]);
+        });
+      Pool.wait();
+    }
+
+    bool Failed = false;
+    for (unsigned I = 0; I != CodeGenPartitions; ++I) {
+      Files[I]->os().close();
+      if (Files[I]->os().has_error()) {
+        Files[I]->os().clear_error();
+        if (!Failed)
+          errMsg = "could not write object file: " + NativeObjectPaths[I];
+        Failed = true;
+      } else if (!Succeeded[I]) {
+        if (!Failed)
+          errMsg = Errors[I];
+        Failed = true;
+      }
+    }
+
+    if (Failed) {
+      for (unsigned I = 0; I != CodeGenPartitions; ++I)
+        sys::fs::remove(NativeObjectPaths[I]);
+      NativeObjectPaths.clear();
+      return false;
+    }
+    for (unsigned I = 0; I != CodeGenPartitions; ++I)
+      Files[I]->keep();
+
+    if (!CacheDir.empty()) {
+      if (!FromCache) {
+        std::string List;
+        for (unsigned I = 0; I != CodeGenPartitions; ++I)
+          List += PartitionKeys[I] + "\n";
+        writeCacheEntry(getCacheEntryPath(CacheDir, LinkKey, "lst"), List);
+      }
+      pruneCache(CacheDir, CacheSizeLimit);
+    }
+  }
 
+  for (unsigned I = 0, E = NativeObjectPaths.size(); I != E; ++I)
+    NativeObjectNames.push_back(NativeObjectPaths[I].c_str());
+  *names = NativeObjectNames.data();
+  *count = NativeObjectNames.size();
   return true;
 }
 
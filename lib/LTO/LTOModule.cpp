@@ -45,7 +45,7 @@ using namespace llvm;
 
 LTOModule::LTOModule(std::unique_ptr<object::IRObjectFile> Obj,
                      llvm::TargetMachine *TM)
-    : IRFile(std::move(Obj)), _target(TM) {}
+    : IRFile(std::move(Obj)), _target(TM), _bodiesMaterialized(false) {}
 
 /// isBitcodeFile - Returns 'true' if the file (or memory contents) is LLVM
 /// bitcode.
@@ -69,8 +69,10 @@ bool LTOModule::isBitcodeForTarget(MemoryBuffer *buffer,
 
 LTOModule *LTOModule::createFromFile(const char *path, TargetOptions options,
                                      std::string &errMsg) {
+  // Bitcode needs no null terminator; mapping without one avoids a heap copy
+  // of inputs whose size is a multiple of the page size.
   ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
-      MemoryBuffer::getFile(path);
+      MemoryBuffer::getFile(path, -1, /*RequiresNullTerminator=*/false);
   if (std::error_code EC = BufferOrErr.getError()) {
     errMsg = EC.message();
     return nullptr;
@@ -100,7 +102,10 @@ LTOModule *LTOModule::createFromOpenFileSlice(int fd, const char *path,
 LTOModule *LTOModule::createFromBuffer(const void *mem, size_t length,
                                        TargetOptions options,
                                        std::string &errMsg, StringRef path) {
-  std::unique_ptr<MemoryBuffer> buffer(makeBuffer(mem, length, path));
+  // Function bodies are read from the buffer after this returns, but callers
+  // may free mem as soon as the module is created, so keep a copy.
+  std::unique_ptr<MemoryBuffer> buffer(MemoryBuffer::getMemBufferCopy(
+      StringRef((const char *)mem, length), path));
   if (!buffer)
     return nullptr;
   return makeLTOModule(std::move(buffer), options, errMsg);
@@ -145,7 +150,9 @@ LTOModule *LTOModule::makeLTOModule(std::unique_ptr<MemoryBuffer> Buffer,
 
   TargetMachine *target = march->createTargetMachine(TripleStr, CPU, FeatureStr,
                                                      options);
-  M->materializeAllPermanently(true);
+  // Function bodies are left in the bitcode: answering the linker's symbol
+  // queries only needs the module-level records.  The bodies are read when
+  // the module is linked into an LTOCodeGenerator.
   M->setDataLayout(target->getDataLayout());
 
   std::unique_ptr<object::IRObjectFile> IRObj(
@@ -348,7 +355,7 @@ void LTOModule::addDefinedFunctionSymbol(const char *Name, const Function *F) {
   addDefinedSymbol(Name, F, true);
 }
 
-static bool canBeHidden(const GlobalValue *GV) {
+bool LTOModule::canBeHidden(const GlobalValue *GV) {
   // FIXME: this is duplicated with another static function in AsmPrinter.cpp
   GlobalValue::LinkageTypes L = GV->getLinkage();
 
@@ -365,6 +372,11 @@ static bool canBeHidden(const GlobalValue *GV) {
       return false;
   }
 
+  // Whether the address is compared can only be seen by walking its uses, so
+  // the function bodies have to be read in.  If that fails, be conservative.
+  if (!materializeFunctionBodies())
+    return false;
+
   GlobalStatus GS;
   if (GlobalStatus::analyzeGlobal(GV, GS))
     return false;
@@ -372,6 +384,20 @@ static bool canBeHidden(const GlobalValue *GV) {
   return !GS.IsCompared;
 }
 
+/// materializeFunctionBodies - Read in every function body that is still
+/// left in the bitcode.  Returns false if one of them could not be read.
+bool LTOModule::materializeFunctionBodies() {
+  if (_bodiesMaterialized)
+    return true;
+
+  for (Function &F : getModule()) {
+    if (F.isMaterializable() && F.Materialize())
+      return false;
+  }
+  _bodiesMaterialized = true;
+  return true;
+}
+
 void LTOModule::addDefinedSymbol(const char *Name, const GlobalValue *def,
                                  bool isFunction) {
   // set alignment part log2() can have rounding errors
@@ -13,6 +13,7 @@
 
 #include "llvm/Linker/Linker.h"
 #include "llvm-c/Linker.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallString.h"
@@ -34,6 +35,7 @@ using namespace llvm;
 
 namespace {
   typedef SmallPtrSet<StructType*, 32> TypeSet;
+  typedef DenseMap<Type*, unsigned> TypeHashMap;
 
 class TypeMapTy : public ValueMapTypeRemapper {
   /// MappedTypes - This is a mapping from a source type to a destination type
@@ -54,8 +56,13 @@ class TypeMapTy : public ValueMapTypeRemapper {
   /// destination modules who are getting a body from the source module.
   SmallPtrSet<StructType*, 16> DstResolvedOpaqueTypes;
 
+  /// StructuralHashes - Cache for getStructuralHash() and getBodyHash(),
+  /// shared by all modules linked into the same destination.
+  TypeHashMap &StructuralHashes;
+
 public:
-  TypeMapTy(TypeSet &Set) : DstStructTypesSet(Set) {}
+  TypeMapTy(TypeSet &Set, TypeHashMap &Hashes)
+      : StructuralHashes(Hashes), DstStructTypesSet(Set) {}
 
   TypeSet &DstStructTypesSet;
   /// addTypeMapping - Indicate that the specified type in the destination
@@ -93,6 +100,10 @@ private:
   }
 
   bool areTypesIsomorphic(Type *DstTy, Type *SrcTy);
+
+  unsigned getStructuralHash(Type *Ty);
+  unsigned getBodyHash(StructType *STy);
+  bool mayBeIsomorphic(Type *DstTy, Type *SrcTy);
 };
 }
 
@@ -105,6 +116,12 @@ void TypeMapTy::addTypeMapping(Type *DstTy, Type *SrcTy) {
     return;
   }
 
+  // Types whose shapes differ can't be isomorphic; don't bother walking them.
+  if (!mayBeIsomorphic(DstTy, SrcTy)) {
+    MappedTypes.erase(SrcTy);
+    return;
+  }
+
   // Check to see if these types are recursively isomorphic and establish a
   // mapping between them if so.
   if (!areTypesIsomorphic(DstTy, SrcTy)) {
@@ -116,6 +133,66 @@ void TypeMapTy::addTypeMapping(Type *DstTy, Type *SrcTy) {
   SpeculativeTypes.clear();
 }
 
+/// getStructuralHash - Return a hash of the shape of Ty, such that any two
+/// types areTypesIsomorphic could match hash alike.  Structs are not looked
+/// through: an opaque struct can match any other struct, so they all hash the
+/// same.  This also means a hash never changes once computed, even when an
+/// opaque struct later gets a body.
+unsigned TypeMapTy::getStructuralHash(Type *Ty) {
+  if (isa<StructType>(Ty))
+    return Type::StructTyID;
+
+  TypeHashMap::iterator I = StructuralHashes.find(Ty);
+  if (I != StructuralHashes.end())
+    return I->second;
+
+  hash_code Hash = hash_combine(Ty->getTypeID(), Ty->getNumContainedTypes());
+  if (IntegerType *ITy = dyn_cast<IntegerType>(Ty))
+    Hash = hash_combine(Hash, ITy->getBitWidth());
+  else if (PointerType *PTy = dyn_cast<PointerType>(Ty))
+    Hash = hash_combine(Hash, PTy->getAddressSpace());
+  else if (FunctionType *FTy = dyn_cast<FunctionType>(Ty))
+    Hash = hash_combine(Hash, FTy->isVarArg());
+  else if (ArrayType *ATy = dyn_cast<ArrayType>(Ty))
+    Hash = hash_combine(Hash, ATy->getNumElements());
+  else if (VectorType *VTy = dyn_cast<VectorType>(Ty))
+    Hash = hash_combine(Hash, VTy->getNumElements());
+
+  for (unsigned i = 0, e = Ty->getNumContainedTypes(); i != e; ++i)
+    Hash = hash_combine(Hash, getStructuralHash(Ty->getContainedType(i)));
+
+  return StructuralHashes[Ty] = Hash;
+}
+
+/// getBodyHash - Return a hash of the body of the non-opaque struct STy,
+/// built from the structural hashes of its elements.
+unsigned TypeMapTy::getBodyHash(StructType *STy) {
+  assert(!STy->isOpaque() && "Not a struct with a body");
+  TypeHashMap::iterator I = StructuralHashes.find(STy);
+  if (I != StructuralHashes.end())
+    return I->second;
+
+  hash_code Hash = hash_combine(STy->isLiteral(), STy->isPacked(),
+                                STy->getNumElements());
+  for (unsigned i = 0, e = STy->getNumElements(); i != e; ++i)
+    Hash = hash_combine(Hash, getStructuralHash(STy->getElementType(i)));
+
+  return StructuralHashes[STy] = Hash;
+}
+
+/// mayBeIsomorphic - Return false if DstTy and SrcTy are known not to be
+/// isomorphic, without walking the type graphs.
+bool TypeMapTy::mayBeIsomorphic(Type *DstTy, Type *SrcTy) {
+  StructType *DSTy = dyn_cast<StructType>(DstTy);
+  StructType *SSTy = dyn_cast<StructType>(SrcTy);
+  if (DSTy && SSTy) {
+    if (DSTy->isOpaque() || SSTy->isOpaque())
+      return true;
+    return getBodyHash(DSTy) == getBodyHash(SSTy);
+  }
+  return getStructuralHash(DstTy) == getStructuralHash(SrcTy);
+}
+
 /// areTypesIsomorphic - Recursively walk this pair of types, returning true
 /// if they are isomorphic, false if they are not.
 bool TypeMapTy::areTypesIsomorphic(Type *DstTy, Type *SrcTy) {
@@ -361,16 +438,19 @@ namespace {
 
   /// ValueMaterializerTy - Creates prototypes for functions that are lazily
   /// linked on the fly. This speeds up linking for modules with many
-  /// lazily linked functions of which few get used.
+  /// lazily linked functions of which few get used. When only needed globals
+  /// are linked, variables and aliases are created on the fly as well.
   class ValueMaterializerTy : public ValueMaterializer {
     TypeMapTy &TypeMap;
     Module *DstM;
-    std::vector<Function*> &LazilyLinkFunctions;
+    std::vector<GlobalValue*> &LazilyLinkGlobals;
+    bool LinkOnlyNeeded;
   public:
     ValueMaterializerTy(TypeMapTy &TypeMap, Module *DstM,
-                        std::vector<Function*> &LazilyLinkFunctions) :
+                        std::vector<GlobalValue*> &LazilyLinkGlobals,
+                        bool LinkOnlyNeeded) :
       ValueMaterializer(), TypeMap(TypeMap), DstM(DstM),
-      LazilyLinkFunctions(LazilyLinkFunctions) {
+      LazilyLinkGlobals(LazilyLinkGlobals), LinkOnlyNeeded(LinkOnlyNeeded) {
     }
 
     Value *materializeValueFor(Value *V) override;
@@ -403,19 +483,25 @@ namespace {
     // Set of items not to link in from source.
     SmallPtrSet<const Value*, 16> DoNotLinkFromSource;
 
-    // Vector of functions to lazily link in.
-    std::vector<Function*> LazilyLinkFunctions;
+    // Vector of globals to lazily link in, in the order they were first
+    // referenced.
+    std::vector<GlobalValue*> LazilyLinkGlobals;
+
+    // Globals that are linked even if nothing refers to them.
+    const StringSet<> &RootSymbols;
 
     bool SuppressWarnings;
 
   public:
     std::string ErrorMsg;
 
-    ModuleLinker(Module *dstM, TypeSet &Set, Module *srcM, unsigned mode,
+    ModuleLinker(Module *dstM, TypeSet &Set, TypeHashMap &Hashes,
+                 const StringSet<> &Roots, Module *srcM, unsigned mode,
                  bool SuppressWarnings=false)
-        : DstM(dstM), SrcM(srcM), TypeMap(Set),
-          ValMaterializer(TypeMap, DstM, LazilyLinkFunctions), Mode(mode),
-          SuppressWarnings(SuppressWarnings) {}
+        : DstM(dstM), SrcM(srcM), TypeMap(Set, Hashes),
+          ValMaterializer(TypeMap, DstM, LazilyLinkGlobals,
+                          mode & Linker::LinkOnlyNeeded),
+          Mode(mode), RootSymbols(Roots), SuppressWarnings(SuppressWarnings) {}
 
     bool run();
 
@@ -467,6 +553,14 @@ namespace {
       return DGV;
     }
 
+    /// isLazilyLinked - Return true if SGV, which has no counterpart in the
+    /// destination, should only be copied over once something refers to it.
+    bool isLazilyLinked(const GlobalValue *SGV) const {
+      return (Mode & Linker::LinkOnlyNeeded) && !SGV->hasComdat() &&
+             !SGV->hasAppendingLinkage() &&
+             !RootSymbols.count(SGV->getName());
+    }
+
     void computeTypeMapping();
 
     bool linkAppendingVarProto(GlobalVariable *DstGV, GlobalVariable *SrcGV);
@@ -478,6 +572,8 @@ namespace {
     void linkAppendingVarInit(const AppendingVarInfo &AVI);
     void linkGlobalInits();
     void linkFunctionBody(Function *Dst, Function *Src);
+    bool linkLazilyLinkedGlobal(GlobalValue *SGV);
+    bool linkLazilyLinkedGlobals();
     void linkAliasBodies();
     void linkNamedMDNodes();
   };
@@ -534,17 +630,60 @@ static bool isLessConstraining(GlobalValue::VisibilityTypes a,
   return false;
 }
 
+/// copyGlobalVariableProto - Create a global variable in DstM like SGV,
+/// without an initializer.
+static GlobalVariable *copyGlobalVariableProto(TypeMapTy &TypeMap,
+                                               Module *DstM,
+                                               const GlobalVariable *SGV) {
+  GlobalVariable *NewDGV =
+    new GlobalVariable(*DstM, TypeMap.get(SGV->getType()->getElementType()),
+                       SGV->isConstant(), SGV->getLinkage(), /*init*/nullptr,
+                       SGV->getName(), /*insertbefore*/nullptr,
+                       SGV->getThreadLocalMode(),
+                       SGV->getType()->getAddressSpace());
+  // Propagate alignment, visibility and section info.
+  copyGVAttributes(NewDGV, SGV);
+  return NewDGV;
+}
+
+/// copyFunctionProto - Create a function in DstM like SF, without a body.
+static Function *copyFunctionProto(TypeMapTy &TypeMap, Module *DstM,
+                                   const Function *SF) {
+  Function *NewDF = Function::Create(TypeMap.get(SF->getFunctionType()),
+                                     SF->getLinkage(), SF->getName(), DstM);
+  copyGVAttributes(NewDF, SF);
+  return NewDF;
+}
+
+/// copyGlobalAliasProto - Create an alias in DstM like SGA, without an
+/// aliasee.
+static GlobalAlias *copyGlobalAliasProto(TypeMapTy &TypeMap, Module *DstM,
+                                         const GlobalAlias *SGA) {
+  auto *PTy = cast<PointerType>(TypeMap.get(SGA->getType()));
+  auto *NewDA =
+      GlobalAlias::create(PTy->getElementType(), PTy->getAddressSpace(),
+                          SGA->getLinkage(), SGA->getName(), DstM);
+  copyGVAttributes(NewDA, SGA);
+  return NewDA;
+}
+
 Value *ValueMaterializerTy::materializeValueFor(Value *V) {
-  Function *SF = dyn_cast<Function>(V);
-  if (!SF)
+  GlobalValue *SGV = dyn_cast<GlobalValue>(V);
+  if (!SGV)
     return nullptr;
 
-  Function *DF = Function::Create(TypeMap.get(SF->getFunctionType()),
-                                  SF->getLinkage(), SF->getName(), DstM);
-  copyGVAttributes(DF, SF);
+  GlobalValue *DGV;
+  if (Function *SF = dyn_cast<Function>(SGV))
+    DGV = copyFunctionProto(TypeMap, DstM, SF);
+  else if (!LinkOnlyNeeded || SGV->hasComdat() || SGV->hasAppendingLinkage())
+    return nullptr;
+  else if (GlobalVariable *SGVar = dyn_cast<GlobalVariable>(SGV))
+    DGV = copyGlobalVariableProto(TypeMap, DstM, SGVar);
+  else
+    DGV = copyGlobalAliasProto(TypeMap, DstM, cast<GlobalAlias>(SGV));
 
-  LazilyLinkFunctions.push_back(SF);
-  return DF;
+  LazilyLinkGlobals.push_back(SGV);
+  return DGV;
 }
 
 bool ModuleLinker::getComdatLeader(Module *M, StringRef ComdatName,
@@ -944,17 +1083,17 @@ bool ModuleLinker::linkGlobalProto(GlobalVariable *SGV) {
     return false;
   }
 
+  // If the variable is only needed once referenced, the ValueMaterializerTy
+  // will create it then.
+  if (!DGV && isLazilyLinked(SGV)) {
+    DoNotLinkFromSource.insert(SGV);
+    return false;
+  }
+
   // No linking to be performed or linking from the source: simply create an
   // identical version of the symbol over in the dest module... the
   // initializer will be filled in later by LinkGlobalInits.
-  GlobalVariable *NewDGV =
-    new GlobalVariable(*DstM, TypeMap.get(SGV->getType()->getElementType()),
-                       SGV->isConstant(), SGV->getLinkage(), /*init*/nullptr,
-                       SGV->getName(), /*insertbefore*/nullptr,
-                       SGV->getThreadLocalMode(),
-                       SGV->getType()->getAddressSpace());
-  // Propagate alignment, visibility and section info.
-  copyGVAttributes(NewDGV, SGV);
+  GlobalVariable *NewDGV = copyGlobalVariableProto(TypeMap, DstM, SGV);
   if (NewVisibility)
     NewDGV->setVisibility(*NewVisibility);
   NewDGV->setUnnamedAddr(HasUnnamedAddr);
@@ -1020,7 +1159,7 @@ bool ModuleLinker::linkFunctionProto(Function *SF) {
   // If the function is to be lazily linked, don't create it just yet.
   // The ValueMaterializerTy will deal with creating it if it's used.
   if (!DGV && (SF->hasLocalLinkage() || SF->hasLinkOnceLinkage() ||
-               SF->hasAvailableExternallyLinkage())) {
+               SF->hasAvailableExternallyLinkage() || isLazilyLinked(SF))) {
     DoNotLinkFromSource.insert(SF);
     return false;
   }
@@ -1033,9 +1172,7 @@ bool ModuleLinker::linkFunctionProto(Function *SF) {
 
   // If there is no linkage to be performed or we are linking from the source,
   // bring SF over.
-  Function *NewDF = Function::Create(TypeMap.get(SF->getFunctionType()),
-                                     SF->getLinkage(), SF->getName(), DstM);
-  copyGVAttributes(NewDF, SF);
+  Function *NewDF = copyFunctionProto(TypeMap, DstM, SF);
   if (NewVisibility)
     NewDF->setVisibility(*NewVisibility);
   NewDF->setUnnamedAddr(HasUnnamedAddr);
@@ -1103,13 +1240,16 @@ bool ModuleLinker::linkAliasProto(GlobalAlias *SGA) {
     return false;
   }
 
+  // If the alias is only needed once referenced, the ValueMaterializerTy will
+  // create it then.
+  if (!DGV && isLazilyLinked(SGA)) {
+    DoNotLinkFromSource.insert(SGA);
+    return false;
+  }
+
   // If there is no linkage to be performed or we're linking from the source,
   // bring over SGA.
-  auto *PTy = cast<PointerType>(TypeMap.get(SGA->getType()));
-  auto *NewDA =
-      GlobalAlias::create(PTy->getElementType(), PTy->getAddressSpace(),
-                          SGA->getLinkage(), SGA->getName(), DstM);
-  copyGVAttributes(NewDA, SGA);
+  GlobalAlias *NewDA = copyGlobalAliasProto(TypeMap, DstM, SGA);
   if (NewVisibility)
     NewDA->setVisibility(*NewVisibility);
   NewDA->setUnnamedAddr(HasUnnamedAddr);
@@ -1177,7 +1317,7 @@ void ModuleLinker::linkFunctionBody(Function *Dst, Function *Src) {
     ValueMap[I] = DI;
   }
 
-  if (Mode == Linker::DestroySource) {
+  if (!(Mode & Linker::PreserveSource)) {
     // Splice the body of the source function into the dest function.
     Dst->getBasicBlockList().splice(Dst->end(), Src->getBasicBlockList());
 
@@ -1204,6 +1344,100 @@ void ModuleLinker::linkFunctionBody(Function *Dst, Function *Src) {
 
 }
 
+/// linkLazilyLinkedGlobal - Link in the body, initializer or aliasee of SGV,
+/// a global the ValueMaterializerTy created on demand.
+bool ModuleLinker::linkLazilyLinkedGlobal(GlobalValue *SGV) {
+  GlobalValue *DGV = cast<GlobalValue>(ValueMap[SGV]);
+
+  if (GlobalVariable *SGVar = dyn_cast<GlobalVariable>(SGV)) {
+    if (SGVar->hasInitializer())
+      cast<GlobalVariable>(DGV)->setInitializer(
+          MapValue(SGVar->getInitializer(), ValueMap, RF_None, &TypeMap,
+                   &ValMaterializer));
+    return false;
+  }
+
+  if (GlobalAlias *SGA = dyn_cast<GlobalAlias>(SGV)) {
+    if (Constant *Aliasee = SGA->getAliasee())
+      cast<GlobalAlias>(DGV)->setAliasee(
+          MapValue(Aliasee, ValueMap, RF_None, &TypeMap, &ValMaterializer));
+    return false;
+  }
+
+  Function *SF = cast<Function>(SGV);
+  Function *DF = cast<Function>(DGV);
+  if (SF->hasPrefixData()) {
+    // Link in the prefix data.
+    DF->setPrefixData(MapValue(SF->getPrefixData(), ValueMap, RF_None,
+                               &TypeMap, &ValMaterializer));
+  }
+
+  // Materialize if necessary.
+  if (SF->isDeclaration()) {
+    if (!SF->isMaterializable())
+      return false;
+    if (SF->Materialize(&ErrorMsg))
+      return true;
+  }
+
+  // Link in function body.
+  linkFunctionBody(DF, SF);
+  SF->Dematerialize();
+  return false;
+}
+
+/// isOnlyReferencedByMetadata - Return true if nothing but metadata refers
+/// to the lazily created global DGV.  Metadata operands are not uses.
+static bool isOnlyReferencedByMetadata(GlobalValue *DGV) {
+  DGV->removeDeadConstantUsers();
+  return DGV->use_empty();
+}
+
+/// linkLazilyLinkedGlobals - Link in the bodies, initializers and aliasees of
+/// the globals the ValueMaterializerTy created on demand.  Doing so can
+/// reference further globals, which are appended to the list as we go.
+///
+/// When only needed globals are linked, a global that only metadata refers
+/// to, such as the function of a subprogram in the debug info, is not
+/// needed.  It is set aside until something else refers to it, and dropped
+/// if nothing ever does; the metadata operand then becomes null.
+bool ModuleLinker::linkLazilyLinkedGlobals() {
+  bool OnlyNeeded = Mode & Linker::LinkOnlyNeeded;
+  std::vector<GlobalValue*> Unreferenced;
+
+  while (!LazilyLinkGlobals.empty()) {
+    for (unsigned i = 0; i != LazilyLinkGlobals.size(); ++i) {
+      GlobalValue *SGV = LazilyLinkGlobals[i];
+      if (OnlyNeeded &&
+          isOnlyReferencedByMetadata(cast<GlobalValue>(ValueMap[SGV]))) {
+        Unreferenced.push_back(SGV);
+        continue;
+      }
+      if (linkLazilyLinkedGlobal(SGV))
+        return true;
+    }
+    LazilyLinkGlobals.clear();
+
+    // The globals just linked may refer to some that were set aside.
+    std::vector<GlobalValue*> StillUnreferenced;
+    for (unsigned i = 0, e = Unreferenced.size(); i != e; ++i) {
+      GlobalValue *SGV = Unreferenced[i];
+      if (isOnlyReferencedByMetadata(cast<GlobalValue>(ValueMap[SGV])))
+        StillUnreferenced.push_back(SGV);
+      else
+        LazilyLinkGlobals.push_back(SGV);
+    }
+    Unreferenced.swap(StillUnreferenced);
+  }
+
+  for (unsigned i = 0, e = Unreferenced.size(); i != e; ++i) {
+    GlobalValue *DGV = cast<GlobalValue>(ValueMap[Unreferenced[i]]);
+    ValueMap.erase(Unreferenced[i]);
+    DGV->eraseFromParent();
+  }
+  return false;
+}
+
 /// linkAliasBodies - Insert all of the aliases in Src into the Dest module.
 void ModuleLinker::linkAliasBodies() {
   for (Module::alias_iterator I = SrcM->alias_begin(), E = SrcM->alias_end();
@@ -1515,49 +1749,9 @@ bool ModuleLinker::run() {
   // be referenced are in DstM.
   linkGlobalInits();
 
-  // Process vector of lazily linked in functions.
-  bool LinkedInAnyFunctions;
-  do {
-    LinkedInAnyFunctions = false;
-
-    for(std::vector<Function*>::iterator I = LazilyLinkFunctions.begin(),
-        E = LazilyLinkFunctions.end(); I != E; ++I) {
-      Function *SF = *I;
-      if (!SF)
-        continue;
-
-      Function *DF = cast<Function>(ValueMap[SF]);
-      if (SF->hasPrefixData()) {
-        // Link in the prefix data.
-        DF->setPrefixData(MapValue(SF->getPrefixData(),
-                                   ValueMap,
-                                   RF_None,
-                                   &TypeMap,
-                                   &ValMaterializer));
-      }
-
-      // Materialize if necessary.
-      if (SF->isDeclaration()) {
-        if (!SF->isMaterializable())
-          continue;
-        if (SF->Materialize(&ErrorMsg))
-          return true;
-      }
-
-      // Erase from vector *before* the function body is linked - linkFunctionBody could
-      // invalidate I.
-      LazilyLinkFunctions.erase(I);
-
-      // Link in function body.
-      linkFunctionBody(DF, SF);
-      SF->Dematerialize();
-
-      // Set flag to indicate we may have more functions to lazily link in
-      // since we linked in a function.
-      LinkedInAnyFunctions = true;
-      break;
-    }
-  } while (LinkedInAnyFunctions);
+  // Process vector of lazily linked in globals.
+  if (linkLazilyLinkedGlobals())
+    return true;
 
   // Now that all of the types from the source are used, resolve any structs
   // copied over to the dest that didn't exist there.
@@ -1582,7 +1776,8 @@ void Linker::deleteModule() {
 }
 
 bool Linker::linkInModule(Module *Src, unsigned Mode, std::string *ErrorMsg) {
-  ModuleLinker TheLinker(Composite, IdentifiedStructTypes, Src, Mode,
+  ModuleLinker TheLinker(Composite, IdentifiedStructTypes,
+                         StructuralTypeHashes, RootSymbols, Src, Mode,
                          SuppressWarnings);
   if (TheLinker.run()) {
     if (ErrorMsg)
@@ -112,11 +112,11 @@ class ELFObjectWriter : public MCObjectWriter {
                            bool Used, bool Renamed);
     static bool isLocal(const MCSymbolData &Data, bool isUsedInReloc);
     static bool IsELFMetaDataSection(const MCSectionData &SD);
-    static uint64_t DataSectionSize(const MCSectionData &SD);
-    static uint64_t GetSectionFileSize(const MCAsmLayout &Layout,
-                                       const MCSectionData &SD);
-    static uint64_t GetSectionAddressSize(const MCAsmLayout &Layout,
-                                          const MCSectionData &SD);
+    uint64_t DataSectionSize(const MCSectionData &SD);
+    uint64_t GetSectionFileSize(const MCAsmLayout &Layout,
+                                const MCSectionData &SD);
+    uint64_t GetSectionAddressSize(const MCAsmLayout &Layout,
+                                   const MCSectionData &SD);
 
     void WriteDataSectionData(MCAssembler &Asm,
                               const MCAsmLayout &Layout,
@@ -152,6 +152,18 @@ class ELFObjectWriter : public MCObjectWriter {
     Relocations;
     StringTableBuilder ShStrTabBuilder;
 
+    /// @}
+    /// @name Streamed Sections
+    /// @{
+    /// The contents of these sections are written straight from the tables
+    /// above when the object is written, instead of being copied into
+    /// fragments first.
+
+    /// Map from a relocation section to the section it relocates.
+    DenseMap<const MCSectionData *, const MCSectionData *> RelocatedSections;
+    MCSectionData *StrtabSD;
+    MCSectionData *ShstrtabSD;
+
     /// @}
     /// @name Symbol Table Data
     /// @{
@@ -190,7 +202,8 @@ class ELFObjectWriter : public MCObjectWriter {
     ELFObjectWriter(MCELFObjectTargetWriter *MOTW, raw_ostream &_OS,
                     bool IsLittleEndian)
         : MCObjectWriter(_OS, IsLittleEndian), FWriter(IsLittleEndian),
-          TargetObjectWriter(MOTW), NeedsGOT(false) {}
+          TargetObjectWriter(MOTW), StrtabSD(nullptr), ShstrtabSD(nullptr),
+          NeedsGOT(false) {}
 
     virtual ~ELFObjectWriter();
 
@@ -258,9 +271,6 @@ class ELFObjectWriter : public MCObjectWriter {
 
     void CompressDebugSections(MCAssembler &Asm, MCAsmLayout &Layout);
 
-    void WriteRelocations(MCAssembler &Asm, MCAsmLayout &Layout,
-                          const RelMapTy &RelMap);
-
     void CreateMetadataSections(MCAssembler &Asm, MCAsmLayout &Layout,
                                 SectionIndexMapTy &SectionIndexMap,
                                 const RelMapTy &RelMap);
@@ -289,9 +299,7 @@ class ELFObjectWriter : public MCObjectWriter {
                           uint64_t Size, uint32_t Link, uint32_t Info,
                           uint64_t Alignment, uint64_t EntrySize);
 
-    void WriteRelocationsFragment(const MCAssembler &Asm,
-                                  MCDataFragment *F,
-                                  const MCSectionData *SD);
+    void WriteRelocations(const MCAssembler &Asm, const MCSectionData &SD);
 
     bool
     IsSymbolRefDifferenceFullyResolvedImpl(const MCAssembler &Asm,
@@ -1140,7 +1148,9 @@ void ELFObjectWriter::CreateRelocationSections(MCAssembler &Asm,
                         SectionKind::getReadOnly(),
                         EntrySize, Group);
     RelMap[&Section] = RelaSection;
-    Asm.getOrCreateSectionData(*RelaSection);
+    MCSectionData &RelaSD = Asm.getOrCreateSectionData(*RelaSection);
+    RelaSD.setAlignment(is64Bit() ? 8 : 4);
+    RelocatedSections[&RelaSD] = &SD;
   }
 }
 
@@ -1289,25 +1299,6 @@ void ELFObjectWriter::CompressDebugSections(MCAssembler &Asm,
   }
 }
 
-void ELFObjectWriter::WriteRelocations(MCAssembler &Asm, MCAsmLayout &Layout,
-                                       const RelMapTy &RelMap) {
-  for (MCAssembler::const_iterator it = Asm.begin(),
-         ie = Asm.end(); it != ie; ++it) {
-    const MCSectionData &SD = *it;
-    const MCSectionELF &Section =
-      static_cast<const MCSectionELF&>(SD.getSection());
-
-    const MCSectionELF *RelaSection = RelMap.lookup(&Section);
-    if (!RelaSection)
-      continue;
-    MCSectionData &RelaSD = Asm.getOrCreateSectionData(*RelaSection);
-    RelaSD.setAlignment(is64Bit() ? 8 : 4);
-
-    MCDataFragment *F = new MCDataFragment(&RelaSD);
-    WriteRelocationsFragment(Asm, F, &*it);
-  }
-}
-
 void ELFObjectWriter::WriteSecHdrEntry(uint32_t Name, uint32_t Type,
                                        uint64_t Flags, uint64_t Address,
                                        uint64_t Offset, uint64_t Size,
@@ -1344,10 +1335,9 @@ static void sortRelocs(const MCAssembler &Asm,
   array_pod_sort(Relocs.begin(), Relocs.end(), cmpRel);
 }
 
-void ELFObjectWriter::WriteRelocationsFragment(const MCAssembler &Asm,
-                                               MCDataFragment *F,
-                                               const MCSectionData *SD) {
-  std::vector<ELFRelocationEntry> &Relocs = Relocations[SD];
+void ELFObjectWriter::WriteRelocations(const MCAssembler &Asm,
+                                       const MCSectionData &SD) {
+  std::vector<ELFRelocationEntry> &Relocs = Relocations[&SD];
 
   sortRelocs(Asm, Relocs);
 
@@ -1367,32 +1357,36 @@ void ELFObjectWriter::WriteRelocationsFragment(const MCAssembler &Asm,
     }
 
     if (is64Bit()) {
-      write(*F, Entry.Offset);
+      Write64(Entry.Offset);
       if (TargetObjectWriter->isN64()) {
-        write(*F, uint32_t(Index));
+        Write32(Index);
 
-        write(*F, TargetObjectWriter->getRSsym(Entry.Type));
-        write(*F, TargetObjectWriter->getRType3(Entry.Type));
-        write(*F, TargetObjectWriter->getRType2(Entry.Type));
-        write(*F, TargetObjectWriter->getRType(Entry.Type));
+        Write8(TargetObjectWriter->getRSsym(Entry.Type));
+        Write8(TargetObjectWriter->getRType3(Entry.Type));
+        Write8(TargetObjectWriter->getRType2(Entry.Type));
+        Write8(TargetObjectWriter->getRType(Entry.Type));
       } else {
         struct ELF::Elf64_Rela ERE64;
         ERE64.setSymbolAndType(Index, Entry.Type);
-        write(*F, ERE64.r_info);
+        Write64(ERE64.r_info);
       }
       if (hasRelocationAddend())
-        write(*F, Entry.Addend);
+        Write64(Entry.Addend);
     } else {
-      write(*F, uint32_t(Entry.Offset));
+      Write32(Entry.Offset);
 
       struct ELF::Elf32_Rela ERE32;
       ERE32.setSymbolAndType(Index, Entry.Type);
-      write(*F, ERE32.r_info);
+      Write32(ERE32.r_info);
 
       if (hasRelocationAddend())
-        write(*F, uint32_t(Entry.Addend));
+        Write32(Entry.Addend);
     }
   }
+
+  // The section header table has already been written, so nothing needs the
+  // entries any more.
+  std::vector<ELFRelocationEntry>().swap(Relocs);
 }
 
 void ELFObjectWriter::CreateMetadataSections(MCAssembler &Asm,
@@ -1408,8 +1402,8 @@ void ELFObjectWriter::CreateMetadataSections(MCAssembler &Asm,
   const MCSectionELF *ShstrtabSection =
     Ctx.getELFSection(".shstrtab", ELF::SHT_STRTAB, 0,
                       SectionKind::getReadOnly());
-  MCSectionData &ShstrtabSD = Asm.getOrCreateSectionData(*ShstrtabSection);
-  ShstrtabSD.setAlignment(1);
+  ShstrtabSD = &Asm.getOrCreateSectionData(*ShstrtabSection);
+  ShstrtabSD->setAlignment(1);
 
   const MCSectionELF *SymtabSection =
     Ctx.getELFSection(".symtab", ELF::SHT_SYMTAB, 0,
@@ -1421,8 +1415,8 @@ void ELFObjectWriter::CreateMetadataSections(MCAssembler &Asm,
   const MCSectionELF *StrtabSection;
   StrtabSection = Ctx.getELFSection(".strtab", ELF::SHT_STRTAB, 0,
                                     SectionKind::getReadOnly());
-  MCSectionData &StrtabSD = Asm.getOrCreateSectionData(*StrtabSection);
-  StrtabSD.setAlignment(1);
+  StrtabSD = &Asm.getOrCreateSectionData(*StrtabSection);
+  StrtabSD->setAlignment(1);
 
   ComputeIndexMap(Asm, SectionIndexMap, RelMap);
 
@@ -1434,12 +1428,6 @@ void ELFObjectWriter::CreateMetadataSections(MCAssembler &Asm,
   F = new MCDataFragment(&SymtabSD);
   WriteSymbolTable(F, Asm, Layout, SectionIndexMap);
 
-  F = new MCDataFragment(&StrtabSD);
-  F->getContents().append(StrTabBuilder.data().begin(),
-                          StrTabBuilder.data().end());
-
-  F = new MCDataFragment(&ShstrtabSD);
-
   // Section header string table.
   for (auto it = Asm.begin(), ie = Asm.end(); it != ie; ++it) {
     const MCSectionELF &Section =
@@ -1447,8 +1435,6 @@ void ELFObjectWriter::CreateMetadataSections(MCAssembler &Asm,
     ShStrTabBuilder.add(Section.getSectionName());
   }
   ShStrTabBuilder.finalize();
-  F->getContents().append(ShStrTabBuilder.data().begin(),
-                          ShStrTabBuilder.data().end());
 }
 
 void ELFObjectWriter::CreateIndexedSections(MCAssembler &Asm,
@@ -1609,6 +1595,14 @@ bool ELFObjectWriter::IsELFMetaDataSection(const MCSectionData &SD) {
 }
 
 uint64_t ELFObjectWriter::DataSectionSize(const MCSectionData &SD) {
+  if (const MCSectionData *RelocatedSD = RelocatedSections.lookup(&SD))
+    return Relocations[RelocatedSD].size() *
+           static_cast<const MCSectionELF &>(SD.getSection()).getEntrySize();
+  if (&SD == StrtabSD)
+    return StrTabBuilder.data().size();
+  if (&SD == ShstrtabSD)
+    return ShStrTabBuilder.data().size();
+
   uint64_t Ret = 0;
   for (MCSectionData::const_iterator i = SD.begin(), e = SD.end(); i != e;
        ++i) {
@@ -1641,7 +1635,13 @@ void ELFObjectWriter::WriteDataSectionData(MCAssembler &Asm,
   uint64_t Padding = OffsetToAlignment(OS.tell(), SD.getAlignment());
   WriteZeros(Padding);
 
-  if (IsELFMetaDataSection(SD)) {
+  if (const MCSectionData *RelocatedSD = RelocatedSections.lookup(&SD)) {
+    WriteRelocations(Asm, *RelocatedSD);
+  } else if (&SD == StrtabSD) {
+    WriteBytes(StrTabBuilder.data());
+  } else if (&SD == ShstrtabSD) {
+    WriteBytes(ShStrTabBuilder.data());
+  } else if (IsELFMetaDataSection(SD)) {
     for (MCSectionData::const_iterator i = SD.begin(), e = SD.end(); i != e;
          ++i) {
       const MCFragment &F = *i;
@@ -1749,8 +1749,6 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
   computeSymbolTable(Asm, Layout, SectionIndexMap, RevGroupMap,
                      NumRegularSections);
 
-  WriteRelocations(Asm, const_cast<MCAsmLayout&>(Layout), RelMap);
-
   CreateMetadataSections(const_cast<MCAssembler&>(Asm),
                          const_cast<MCAsmLayout&>(Layout),
                          SectionIndexMap,
@@ -25,7 +25,9 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/LEB128.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/MC/MCSectionELF.h"
 #include <tuple>
@@ -53,6 +55,9 @@ STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
+STATISTIC(RelaxationChecks, "Number of fragment relaxation checks");
+STATISTIC(SkippedRelaxationChecks,
+          "Number of relaxation checks skipped because no input moved");
 }
 }
 
@@ -349,7 +354,8 @@ MCAssembler::MCAssembler(MCContext &Context_, MCAsmBackend &Backend_,
                          MCCodeEmitter &Emitter_, MCObjectWriter &Writer_,
                          raw_ostream &OS_)
   : Context(Context_), Backend(Backend_), Emitter(Emitter_), Writer(Writer_),
-    OS(OS_), BundleAlignSize(0), RelaxAll(false), NoExecStack(false),
+    OS(OS_), BundleAlignSize(0), NumThreads(1), EncoderLock(nullptr),
+    RelaxAll(false), NoExecStack(false),
     SubsectionsViaSymbols(false), ELFHeaderEFlags(0) {
   VersionMinInfo.Major = 0; // Major version == 0 for "none specified"
 }
@@ -365,6 +371,7 @@ void MCAssembler::reset() {
   IndirectSymbols.clear();
   DataRegions.clear();
   ThumbFuncs.clear();
+  NumThreads = 1;
   RelaxAll = false;
   NoExecStack = false;
   SubsectionsViaSymbols = false;
@@ -885,7 +892,13 @@ void MCAssembler::Finish() {
   }
 
   // Layout until everything fits.
-  while (layoutOnce(Layout))
+  std::vector<RelaxationWorklist> Worklists(size());
+  for (MCAssembler::iterator it = begin(), ie = end(); it != ie; ++it)
+    buildRelaxationWorklist(*it, Worklists[it->getOrdinal()]);
+  std::unique_ptr<ThreadPool> Pool;
+  if (NumThreads != 1 && size() > 1)
+    Pool.reset(new ThreadPool(NumThreads));
+  while (layoutOnce(Layout, Worklists, Pool.get()))
     continue;
 
   DEBUG_WITH_TYPE("mc-dump", {
@@ -981,7 +994,11 @@ bool MCAssembler::relaxInstruction(MCAsmLayout &Layout,
   SmallVector<MCFixup, 4> Fixups;
   SmallString<256> Code;
   raw_svector_ostream VecOS(Code);
+  if (EncoderLock)
+    EncoderLock->acquire();
   getEmitter().EncodeInstruction(Relaxed, VecOS, Fixups, F.getSubtargetInfo());
+  if (EncoderLock)
+    EncoderLock->release();
   VecOS.flush();
 
   // Update the fragment.
@@ -1043,41 +1060,168 @@ bool MCAssembler::relaxDwarfCallFrameFragment(MCAsmLayout &Layout,
   return OldSize != Data.size();
 }
 
-bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
-  // Holds the first fragment which needed relaxing during this layout. It will
-  // remain NULL if none were relaxed.
-  // When a fragment is relaxed, all the fragments following it should get
-  // invalidated because their offset is going to change.
-  MCFragment *FirstRelaxedFragment = nullptr;
+void MCAssembler::collectRelaxationDeps(const MCExpr *Expr,
+                                        RelaxationCandidate &C) const {
+  switch (Expr->getKind()) {
+  case MCExpr::Constant:
+    return;
+  case MCExpr::Binary: {
+    const MCBinaryExpr *BE = cast<MCBinaryExpr>(Expr);
+    collectRelaxationDeps(BE->getLHS(), C);
+    collectRelaxationDeps(BE->getRHS(), C);
+    return;
+  }
+  case MCExpr::Unary:
+    collectRelaxationDeps(cast<MCUnaryExpr>(Expr)->getSubExpr(), C);
+    return;
+  case MCExpr::SymbolRef: {
+    const MCSymbol &Sym = cast<MCSymbolRefExpr>(Expr)->getSymbol();
+    if (Sym.isVariable()) {
+      collectRelaxationDeps(Sym.getVariableValue(), C);
+      return;
+    }
+    // Undefined and absolute symbols don't move.
+    const MCSymbolData *SD = SymbolMap.lookup(&Sym);
+    if (SD && SD->getFragment() &&
+        std::find(C.Deps.begin(), C.Deps.end(), SD->getFragment()) ==
+            C.Deps.end())
+      C.Deps.push_back(SD->getFragment());
+    return;
+  }
+  case MCExpr::Target:
+    C.DepsKnown = false;
+    return;
+  }
+  llvm_unreachable("Invalid expression kind!");
+}
 
-  // Attempt to relax all the fragments in the section.
+void MCAssembler::buildRelaxationWorklist(MCSectionData &SD,
+                                          RelaxationWorklist &Worklist) const {
   for (MCSectionData::iterator I = SD.begin(), IE = SD.end(); I != IE; ++I) {
-    // Check if this is a fragment that needs relaxation.
-    bool RelaxedFrag = false;
-    switch(I->getKind()) {
+    RelaxationCandidate C;
+    C.F = I;
+    C.DepsKnown = true;
+    C.UpToDate = false;
+    switch (I->getKind()) {
     default:
+      continue;
+    case MCFragment::FT_Relaxable: {
+      MCRelaxableFragment &RF = *cast<MCRelaxableFragment>(I);
+      if (!getBackend().mayNeedRelaxation(RF.getInst()))
+        continue;
+      for (MCRelaxableFragment::const_fixup_iterator it = RF.fixup_begin(),
+           ie = RF.fixup_end(); it != ie; ++it)
+        collectRelaxationDeps(it->getValue(), C);
       break;
-    case MCFragment::FT_Relaxable:
-      assert(!getRelaxAll() &&
-             "Did not expect a MCRelaxableFragment in RelaxAll mode");
-      RelaxedFrag = relaxInstruction(Layout, *cast<MCRelaxableFragment>(I));
-      break;
+    }
     case MCFragment::FT_Dwarf:
-      RelaxedFrag = relaxDwarfLineAddr(Layout,
-                                       *cast<MCDwarfLineAddrFragment>(I));
+      collectRelaxationDeps(&cast<MCDwarfLineAddrFragment>(I)->getAddrDelta(),
+                            C);
       break;
     case MCFragment::FT_DwarfFrame:
-      RelaxedFrag =
-        relaxDwarfCallFrameFragment(Layout,
-                                    *cast<MCDwarfCallFrameFragment>(I));
+      collectRelaxationDeps(
+          &cast<MCDwarfCallFrameFragment>(I)->getAddrDelta(), C);
       break;
     case MCFragment::FT_LEB:
-      RelaxedFrag = relaxLEB(Layout, *cast<MCLEBFragment>(I));
+      collectRelaxationDeps(&cast<MCLEBFragment>(I)->getValue(), C);
       break;
     }
+    Worklist.push_back(C);
+  }
+}
+
+bool MCAssembler::isSelfContained(const MCSectionData &SD,
+                                  const RelaxationWorklist &Worklist) const {
+  for (RelaxationWorklist::const_iterator I = Worklist.begin(),
+                                          IE = Worklist.end();
+       I != IE; ++I) {
+    if (!I->DepsKnown)
+      return false;
+    for (unsigned i = 0, e = I->Deps.size(); i != e; ++i)
+      if (I->Deps[i]->getParent() != &SD)
+        return false;
+  }
+  return true;
+}
+
+bool MCAssembler::needsRelaxationCheck(const MCAsmLayout &Layout,
+                                       const RelaxationCandidate &C) const {
+  if (!C.UpToDate || !C.DepsKnown)
+    return true;
+
+  // Whether a fragment needs relaxing depends only on the distances between
+  // it and the labels it refers to, so it is enough to recheck a fragment
+  // when one of them has moved relative to it.
+  int64_t Offset = Layout.getFragmentOffset(C.F);
+  for (unsigned i = 0, e = C.Deps.size(); i != e; ++i)
+    if (int64_t(Layout.getFragmentOffset(C.Deps[i])) - Offset !=
+        C.Distances[i])
+      return true;
+  return false;
+}
+
+bool MCAssembler::relaxFragment(MCAsmLayout &Layout, MCFragment &F) {
+  switch(F.getKind()) {
+  default:
+    return false;
+  case MCFragment::FT_Relaxable:
+    assert(!getRelaxAll() &&
+           "Did not expect a MCRelaxableFragment in RelaxAll mode");
+    return relaxInstruction(Layout, cast<MCRelaxableFragment>(F));
+  case MCFragment::FT_Dwarf:
+    return relaxDwarfLineAddr(Layout, cast<MCDwarfLineAddrFragment>(F));
+  case MCFragment::FT_DwarfFrame:
+    return relaxDwarfCallFrameFragment(Layout,
+                                       cast<MCDwarfCallFrameFragment>(F));
+  case MCFragment::FT_LEB:
+    return relaxLEB(Layout, cast<MCLEBFragment>(F));
+  }
+}
+
+bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout,
+                                    RelaxationWorklist &Worklist) {
+  // Holds the first fragment which needed relaxing during this layout. It will
+  // remain NULL if none were relaxed.
+  // When a fragment is relaxed, all the fragments following it should get
+  // invalidated because their offset is going to change.
+  MCFragment *FirstRelaxedFragment = nullptr;
+
+  // Attempt to relax the fragments in the section whose inputs changed.
+  bool HasDoneFragments = false;
+  for (RelaxationWorklist::iterator I = Worklist.begin(), IE = Worklist.end();
+       I != IE; ++I) {
+    RelaxationCandidate &C = *I;
+    if (!needsRelaxationCheck(Layout, C)) {
+      ++stats::SkippedRelaxationChecks;
+      continue;
+    }
+    ++stats::RelaxationChecks;
+
+    // Record the inputs of this check before the fragment changes.
+    int64_t Offset = Layout.getFragmentOffset(C.F);
+    C.Distances.resize(C.Deps.size());
+    for (unsigned i = 0, e = C.Deps.size(); i != e; ++i)
+      C.Distances[i] = int64_t(Layout.getFragmentOffset(C.Deps[i])) - Offset;
+
+    bool RelaxedFrag = relaxFragment(Layout, *C.F);
+    C.UpToDate = !RelaxedFrag;
     if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = I;
+      FirstRelaxedFragment = C.F;
+
+    // Instructions relaxed to a form that can't grow further are done.
+    if (RelaxedFrag && isa<MCRelaxableFragment>(C.F) &&
+        !getBackend().mayNeedRelaxation(
+            cast<MCRelaxableFragment>(C.F)->getInst()))
+      HasDoneFragments = true;
   }
+
+  if (HasDoneFragments)
+    Worklist.erase(std::remove_if(Worklist.begin(), Worklist.end(),
+                                  [this](const RelaxationCandidate &C) {
+      const MCRelaxableFragment *RF = dyn_cast<MCRelaxableFragment>(C.F);
+      return RF && !getBackend().mayNeedRelaxation(RF->getInst());
+    }), Worklist.end());
+
   if (FirstRelaxedFragment) {
     Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
     return true;
@@ -1085,13 +1229,51 @@ bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
   return false;
 }
 
-bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
+bool MCAssembler::layoutOnce(MCAsmLayout &Layout,
+                             std::vector<RelaxationWorklist> &Worklists,
+                             ThreadPool *Pool) {
   ++stats::RelaxationSteps;
 
+  // Sections that only refer to their own labels (e.g. one section per
+  // function) don't affect each other's layout, so they can be relaxed
+  // concurrently. Each of them only touches its own fragments and layout
+  // entry, so the result does not depend on the scheduling.
+  std::vector<char> IsParallel(Worklists.size());
+  SmallVector<RelaxationWorklist *, 16> Parallel;
+  if (Pool) {
+    for (iterator it = begin(), ie = end(); it != ie; ++it) {
+      RelaxationWorklist &Worklist = Worklists[it->getOrdinal()];
+      if (Worklist.empty() || !isSelfContained(*it, Worklist))
+        continue;
+      // Lay out the whole section up front so that the layout has an entry
+      // for it before the workers start updating those entries.
+      Layout.getFragmentOffset(&it->getFragmentList().back());
+      IsParallel[it->getOrdinal()] = true;
+      Parallel.push_back(&Worklist);
+    }
+  }
+
   bool WasRelaxed = false;
+  if (Parallel.size() > 1) {
+    std::vector<char> Relaxed(Parallel.size());
+    sys::Mutex Lock;
+    EncoderLock = &Lock;
+    for (unsigned i = 0, e = Parallel.size(); i != e; ++i)
+      Pool->async([this, &Layout, &Parallel, &Relaxed, i] {
+        while (layoutSectionOnce(Layout, *Parallel[i]))
+          Relaxed[i] = true;
+      });
+    Pool->wait();
+    EncoderLock = nullptr;
+    WasRelaxed = std::count(Relaxed.begin(), Relaxed.end(), true) != 0;
+  } else {
+    std::fill(IsParallel.begin(), IsParallel.end(), false);
+  }
+
   for (iterator it = begin(), ie = end(); it != ie; ++it) {
-    MCSectionData &SD = *it;
-    while (layoutSectionOnce(Layout, SD))
+    if (IsParallel[it->getOrdinal()])
+      continue;
+    while (layoutSectionOnce(Layout, Worklists[it->getOrdinal()]))
       WasRelaxed = true;
   }
 
@@ -17,11 +17,13 @@
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 
 using namespace llvm;
 using namespace object;
 
 static const char *const Magic = "!<arch>\n";
+static const char *const ThinMagic = "!<thin>\n";
 
 void Archive::anchor() { }
 
@@ -86,7 +88,13 @@ Archive::Child::Child(const Archive *Parent, const char *Start)
 
   const ArchiveMemberHeader *Header =
       reinterpret_cast<const ArchiveMemberHeader *>(Start);
-  Data = StringRef(Start, sizeof(ArchiveMemberHeader) + Header->getSize());
+  // The members of a thin archive are not stored in it; only the symbol and
+  // string tables are.
+  uint64_t Size = sizeof(ArchiveMemberHeader);
+  if (!Parent->IsThin || Header->getName() == "/" ||
+      Header->getName() == "//")
+    Size += Header->getSize();
+  Data = StringRef(Start, Size);
 
   // Setup StartOfFile and PaddingBytes.
   StartOfFile = sizeof(ArchiveMemberHeader);
@@ -100,6 +108,16 @@ Archive::Child::Child(const Archive *Parent, const char *Start)
   }
 }
 
+uint64_t Archive::Child::getSize() const {
+  if (Parent->IsThin)
+    return getHeader()->getSize();
+  return Data.size() - StartOfFile;
+}
+
+bool Archive::Child::isThinMember() const {
+  return Parent->IsThin && Data.size() == sizeof(ArchiveMemberHeader);
+}
+
 Archive::Child Archive::Child::getNext() const {
   size_t SpaceToSkip = Data.size();
   // If it's odd, add 1 to make it even.
@@ -140,9 +158,11 @@ ErrorOr<StringRef> Archive::Child::getName() const {
                    + Parent->StringTable->getSize()))
       return object_error::parse_failed;
 
-    // GNU long file names end with a /.
+    // GNU long file names end with a /.  Thin archives store paths, so
+    // look for the "/\n" terminator instead.
     if (Parent->kind() == K_GNU) {
-      StringRef::size_type End = StringRef(addr).find('/');
+      StringRef::size_type End = Parent->IsThin ? StringRef(addr).find("/\n")
+                                                : StringRef(addr).find('/');
       return StringRef(addr, End);
     }
     return StringRef(addr);
@@ -159,8 +179,29 @@ ErrorOr<StringRef> Archive::Child::getName() const {
   return name;
 }
 
+ErrorOr<std::string> Archive::Child::getThinMemberPath() const {
+  assert(isThinMember());
+  ErrorOr<StringRef> NameOrErr = getName();
+  if (std::error_code EC = NameOrErr.getError())
+    return EC;
+  StringRef Name = NameOrErr.get();
+  // Relative paths are relative to the directory containing the archive.
+  if (sys::path::is_absolute(Name))
+    return Name.str();
+  SmallString<128> Path = sys::path::parent_path(Parent->getFileName());
+  sys::path::append(Path, Name);
+  return Path.str().str();
+}
+
 ErrorOr<std::unique_ptr<MemoryBuffer>>
 Archive::Child::getMemoryBuffer(bool FullPath) const {
+  if (isThinMember()) {
+    ErrorOr<std::string> PathOrErr = getThinMemberPath();
+    if (std::error_code EC = PathOrErr.getError())
+      return EC;
+    return MemoryBuffer::getFile(PathOrErr.get(), -1, false);
+  }
+
   ErrorOr<StringRef> NameOrErr = getName();
   if (std::error_code EC = NameOrErr.getError())
     return EC;
@@ -195,10 +236,17 @@ ErrorOr<Archive *> Archive::create(std::unique_ptr<MemoryBuffer> Source) {
 }
 
 Archive::Archive(std::unique_ptr<MemoryBuffer> Source, std::error_code &ec)
-    : Binary(Binary::ID_Archive, std::move(Source)), SymbolTable(child_end()) {
+    : Binary(Binary::ID_Archive, std::move(Source)), SymbolTable(child_end()),
+      IsThin(false) {
   // Check for sufficient magic.
-  if (Data->getBufferSize() < 8 ||
-      StringRef(Data->getBufferStart(), 8) != Magic) {
+  if (Data->getBufferSize() < 8) {
+    ec = object_error::invalid_file_type;
+    return;
+  }
+  StringRef Buffer = StringRef(Data->getBufferStart(), 8);
+  if (Buffer == ThinMagic)
+    IsThin = true;
+  else if (Buffer != Magic) {
     ec = object_error::invalid_file_type;
     return;
   }
@@ -46,8 +46,24 @@ static inline uint64_t ComputeHash(HashT Type, StringRef K) {
 }
 
 const uint64_t Magic = 0x8169666f72706cff; // "\xfflprofi\x81"
-const uint64_t Version = 1;
 const HashT HashType = HashT::MD5;
+
+/// The version of the format written. Version 1 stores each record as the
+/// function hash followed by the counters, all as 64-bit little endian words.
+/// Version 2 stores the function hash as a 64-bit word, then the number of
+/// counters as a ULEB128, then one byte of CounterEncoding describing how the
+/// counters follow.
+const uint64_t Version = 2;
+
+enum class CounterEncoding : uint8_t {
+  /// Each counter as a ULEB128.
+  ULEB128,
+  /// The ULEB128 encoding, compressed with zlib and preceded by its size as a
+  /// ULEB128.
+  ZlibULEB128,
+
+  Last = ZlibULEB128
+};
 }
 
 } // end namespace llvm
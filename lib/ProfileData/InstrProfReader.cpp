@@ -14,17 +14,22 @@
 
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/ProfileData/InstrProf.h"
+#include "llvm/Support/Compression.h"
 
 #include "InstrProfIndexed.h"
 
 #include <cassert>
+#include <limits>
 
 using namespace llvm;
 
 static std::error_code
 setupMemoryBuffer(std::string Path, std::unique_ptr<MemoryBuffer> &Buffer) {
+  // The binary formats are read in place, so don't ask for a null terminator:
+  // without one, a file of any size can be mapped rather than copied.
   ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
-      MemoryBuffer::getFileOrSTDIN(Path);
+      Path == "-" ? MemoryBuffer::getSTDIN()
+                  : MemoryBuffer::getFile(Path, -1, false);
   if (std::error_code EC = BufferOrErr.getError())
     return EC;
   Buffer = std::move(BufferOrErr.get());
@@ -54,8 +59,12 @@ InstrProfReader::create(std::string Path,
     Result.reset(new RawInstrProfReader64(std::move(Buffer)));
   else if (RawInstrProfReader32::hasFormat(*Buffer))
     Result.reset(new RawInstrProfReader32(std::move(Buffer)));
-  else
-    Result.reset(new TextInstrProfReader(std::move(Buffer)));
+  else {
+    // The text reader needs a null terminated buffer.
+    std::unique_ptr<MemoryBuffer> TextBuffer(MemoryBuffer::getMemBufferCopy(
+        Buffer->getBuffer(), Buffer->getBufferIdentifier()));
+    Result.reset(new TextInstrProfReader(std::move(TextBuffer)));
+  }
 
   // Initialize the reader and return the result.
   return initializeReader(*Result);
@@ -283,6 +292,98 @@ InstrProfLookupTrait::ComputeHash(StringRef K) {
   return IndexedInstrProf::ComputeHash(HashType, K);
 }
 
+InstrProfRecord InstrProfLookupTrait::ReadData(StringRef K,
+                                               const unsigned char *D,
+                                               offset_type N) {
+  bool Valid = FormatVersion == 1 ? readCounters(D, N)
+                                  : readEncodedCounters(D, N);
+  if (!Valid) {
+    // The data is corrupt, don't try to read it.
+    CountBuffer.clear();
+    return InstrProfRecord("", 0, CountBuffer);
+  }
+
+  // The first stored value is always the hash.
+  using namespace support;
+  uint64_t Hash = endian::read<uint64_t, little, unaligned>(D);
+  return InstrProfRecord(K, Hash, CountBuffer);
+}
+
+/// Read the version 1 counters of a record: 64-bit words following the hash.
+bool InstrProfLookupTrait::readCounters(const unsigned char *D, offset_type N) {
+  if (N < 2 * sizeof(uint64_t) || N % sizeof(uint64_t))
+    return false;
+
+  using namespace support;
+  D += sizeof(uint64_t);
+  unsigned NumCounters = N / sizeof(uint64_t) - 1;
+  CountBuffer.clear();
+  CountBuffer.reserve(NumCounters);
+  for (unsigned I = 0; I < NumCounters; ++I)
+    CountBuffer.push_back(endian::readNext<uint64_t, little, unaligned>(D));
+  return true;
+}
+
+/// Read a ULEB128 from [D, End), advancing D. Returns false if it does not fit
+/// in 64 bits or runs past End.
+static bool readULEB128(const unsigned char *&D, const unsigned char *End,
+                        uint64_t &Value) {
+  Value = 0;
+  for (unsigned Shift = 0; D != End; Shift += 7) {
+    uint64_t Slice = *D & 0x7f;
+    if (Shift >= 64 || (Slice << Shift) >> Shift != Slice)
+      return false;
+    Value |= Slice << Shift;
+    if (!(*D++ & 0x80))
+      return true;
+  }
+  return false;
+}
+
+/// Read the counters of a record in the compact encoding of version 2.
+bool InstrProfLookupTrait::readEncodedCounters(const unsigned char *D,
+                                               offset_type N) {
+  using IndexedInstrProf::CounterEncoding;
+
+  const unsigned char *End = D + N;
+  uint64_t NumCounters;
+  if (N < sizeof(uint64_t) + 2)
+    return false;
+  D += sizeof(uint64_t);
+  if (!readULEB128(D, End, NumCounters) || NumCounters == 0 || D == End)
+    return false;
+  CounterEncoding Encoding = static_cast<CounterEncoding>(*D++);
+
+  if (Encoding == CounterEncoding::ZlibULEB128) {
+    uint64_t Size;
+    if (!readULEB128(D, End, Size) || Size < NumCounters ||
+        Size > std::numeric_limits<unsigned>::max())
+      return false;
+    UncompressBuffer.clear();
+    if (zlib::uncompress(StringRef((const char *)D, End - D), UncompressBuffer,
+                         Size) != zlib::StatusOK)
+      return false;
+    D = (const unsigned char *)UncompressBuffer.data();
+    End = D + UncompressBuffer.size();
+  } else if (Encoding != CounterEncoding::ULEB128) {
+    return false;
+  }
+
+  // Each counter takes at least one byte, which bounds the count before any
+  // memory is reserved for it.
+  if (uint64_t(End - D) < NumCounters)
+    return false;
+  CountBuffer.clear();
+  CountBuffer.reserve(NumCounters);
+  for (uint64_t I = 0; I < NumCounters; ++I) {
+    uint64_t Count;
+    if (!readULEB128(D, End, Count))
+      return false;
+    CountBuffer.push_back(Count);
+  }
+  return D == End;
+}
+
 bool IndexedInstrProfReader::hasFormat(const MemoryBuffer &DataBuffer) {
   if (DataBuffer.getBufferSize() < 8)
     return false;
@@ -308,7 +409,7 @@ std::error_code IndexedInstrProfReader::readHeader() {
 
   // Read the version.
   uint64_t Version = endian::readNext<uint64_t, little, unaligned>(Cur);
-  if (Version != IndexedInstrProf::Version)
+  if (Version < 1 || Version > IndexedInstrProf::Version)
     return error(instrprof_error::unsupported_version);
 
   // Read the maximal function count.
@@ -323,7 +424,8 @@ std::error_code IndexedInstrProfReader::readHeader() {
 
   // The rest of the file is an on disk hash table.
   Index.reset(InstrProfReaderIndex::Create(Start + HashOffset, Cur, Start,
-                                           InstrProfLookupTrait(HashType)));
+                                           InstrProfLookupTrait(HashType,
+                                                                Version)));
   // Set up our iterator for readNextRecord.
   RecordIterator = Index->data_begin();
 
@@ -13,16 +13,27 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ProfileData/InstrProfWriter.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/EndianStream.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/OnDiskHashTable.h"
 
 #include "InstrProfIndexed.h"
 
+#include <algorithm>
+
 using namespace llvm;
 
 namespace {
 class InstrProfRecordTrait {
+  /// Whether large counter arrays should be compressed.
+  bool CompressCounters;
+  /// The encoded data of the record being emitted. It is built when its
+  /// length is needed, and written out by EmitData.
+  SmallString<256> Payload;
+
 public:
   typedef StringRef key_type;
   typedef StringRef key_type_ref;
@@ -33,11 +44,14 @@ public:
   typedef uint64_t hash_value_type;
   typedef uint64_t offset_type;
 
+  InstrProfRecordTrait(bool CompressCounters = false)
+      : CompressCounters(CompressCounters) {}
+
   static hash_value_type ComputeHash(key_type_ref K) {
     return IndexedInstrProf::ComputeHash(IndexedInstrProf::HashType, K);
   }
 
-  static std::pair<offset_type, offset_type>
+  std::pair<offset_type, offset_type>
   EmitKeyDataLength(raw_ostream &Out, key_type_ref K, data_type_ref V) {
     using namespace llvm::support;
     endian::Writer<little> LE(Out);
@@ -45,7 +59,8 @@ public:
     offset_type N = K.size();
     LE.write<offset_type>(N);
 
-    offset_type M = (1 + V->Counts.size()) * sizeof(uint64_t);
+    encodeRecord(*V);
+    offset_type M = Payload.size();
     LE.write<offset_type>(M);
 
     return std::make_pair(N, M);
@@ -55,17 +70,51 @@ public:
     Out.write(K.data(), N);
   }
 
-  static void EmitData(raw_ostream &Out, key_type_ref, data_type_ref V,
-                       offset_type) {
-    using namespace llvm::support;
-    endian::Writer<little> LE(Out);
-    LE.write<uint64_t>(V->Hash);
-    for (uint64_t I : V->Counts)
-      LE.write<uint64_t>(I);
+  void EmitData(raw_ostream &Out, key_type_ref, data_type_ref,
+                offset_type M) {
+    assert(M == Payload.size() && "Record data changed size");
+    Out.write(Payload.data(), M);
   }
+
+private:
+  void encodeRecord(const InstrProfWriter::CounterData &V);
 };
 }
 
+/// Records whose encoded counters are smaller than this are never compressed;
+/// zlib's overhead would outweigh the gain.
+static const size_t MinCompressedCountersSize = 64;
+
+void InstrProfRecordTrait::encodeRecord(const InstrProfWriter::CounterData &V) {
+  using namespace llvm::support;
+  using IndexedInstrProf::CounterEncoding;
+
+  SmallString<256> Counters;
+  {
+    raw_svector_ostream OS(Counters);
+    for (uint64_t C : V.Counts)
+      encodeULEB128(C, OS);
+  }
+
+  Payload.clear();
+  raw_svector_ostream OS(Payload);
+  endian::Writer<little>(OS).write<uint64_t>(V.Hash);
+  encodeULEB128(V.Counts.size(), OS);
+
+  SmallVector<char, 256> Compressed;
+  if (CompressCounters && Counters.size() >= MinCompressedCountersSize &&
+      zlib::compress(Counters, Compressed) == zlib::StatusOK &&
+      Compressed.size() < Counters.size()) {
+    OS << char(CounterEncoding::ZlibULEB128);
+    encodeULEB128(Counters.size(), OS);
+    OS.write(Compressed.data(), Compressed.size());
+  } else {
+    OS << char(CounterEncoding::ULEB128);
+    OS << Counters;
+  }
+  OS.flush();
+}
+
 std::error_code
 InstrProfWriter::addFunctionCounts(StringRef FunctionName,
                                    uint64_t FunctionHash,
@@ -97,13 +146,25 @@ InstrProfWriter::addFunctionCounts(StringRef FunctionName,
 
 void InstrProfWriter::write(raw_fd_ostream &OS) {
   OnDiskChainedHashTableGenerator<InstrProfRecordTrait> Generator;
+  InstrProfRecordTrait Trait(CompressCounters);
   uint64_t MaxFunctionCount = 0;
 
-  // Populate the hash table generator.
-  for (const auto &I : FunctionData) {
-    Generator.insert(I.getKey(), &I.getValue());
-    if (I.getValue().Counts[0] > MaxFunctionCount)
-      MaxFunctionCount = I.getValue().Counts[0];
+  // Populate the hash table generator in name order. Records that share a
+  // bucket are emitted in insertion order, so this makes the output
+  // independent of how the counts were merged.
+  std::vector<const StringMapEntry<CounterData> *> Entries;
+  Entries.reserve(FunctionData.size());
+  for (const auto &I : FunctionData)
+    Entries.push_back(&I);
+  std::sort(Entries.begin(), Entries.end(),
+            [](const StringMapEntry<CounterData> *L,
+               const StringMapEntry<CounterData> *R) {
+    return L->getKey() < R->getKey();
+  });
+  for (const auto *I : Entries) {
+    Generator.insert(I->getKey(), &I->getValue(), Trait);
+    if (I->getValue().Counts[0] > MaxFunctionCount)
+      MaxFunctionCount = I->getValue().Counts[0];
   }
 
   using namespace llvm::support;
@@ -119,7 +180,7 @@ void InstrProfWriter::write(raw_fd_ostream &OS) {
   uint64_t HashTableStartLoc = OS.tell();
   LE.write<uint64_t>(0);
   // Write the hash table.
-  uint64_t HashTableStart = Generator.Emit(OS);
+  uint64_t HashTableStart = Generator.Emit(OS, Trait);
 
   // Go back and fill in the hash table start.
   OS.seek(HashTableStartLoc);
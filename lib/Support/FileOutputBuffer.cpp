@@ -55,10 +55,9 @@ FileOutputBuffer::create(StringRef FilePath, size_t Size,
         return make_error_code(errc::operation_not_permitted);
   }
 
-  // Delete target file.
-  EC = sys::fs::remove(FilePath);
-  if (EC)
-    return EC;
+  // Leave any existing target file alone: commit() renames the temporary
+  // over it, so readers never see a missing or partially written file and
+  // the caller may still be reading the old contents.
 
   unsigned Mode = sys::fs::all_read | sys::fs::all_write;
   // If requested, make the output file executable.
@@ -0,0 +1,109 @@
+//===-- llvm/Support/ThreadPool.cpp - A simple thread pool ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a simple pool of worker threads.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+
+using namespace llvm;
+
+ThreadPool::ThreadPool() { init(getHardwareConcurrency()); }
+
+ThreadPool::ThreadPool(unsigned ThreadCount) {
+  init(ThreadCount ? ThreadCount : getHardwareConcurrency());
+}
+
+#if LLVM_ENABLE_THREADS
+
+unsigned ThreadPool::getHardwareConcurrency() {
+  unsigned N = std::thread::hardware_concurrency();
+  return N ? N : 1;
+}
+
+void ThreadPool::init(unsigned Count) {
+  ThreadCount = Count;
+  ActiveThreads = 0;
+  EnableFlag = true;
+  Threads.reserve(ThreadCount);
+  for (unsigned i = 0; i != ThreadCount; ++i)
+    Threads.push_back(std::thread(&ThreadPool::runWorker, this));
+}
+
+void ThreadPool::runWorker() {
+  while (true) {
+    TaskTy Task;
+    {
+      std::unique_lock<std::mutex> Lock(QueueLock);
+      QueueCondition.wait(Lock, [this] { return !EnableFlag || !Tasks.empty(); });
+      // Exit only once the queue has been drained.
+      if (!EnableFlag && Tasks.empty())
+        return;
+
+      ++ActiveThreads;
+      Task = std::move(Tasks.front());
+      Tasks.pop();
+    }
+
+    Task();
+
+    {
+      std::unique_lock<std::mutex> Lock(QueueLock);
+      --ActiveThreads;
+    }
+    CompletionCondition.notify_all();
+  }
+}
+
+void ThreadPool::async(TaskTy Task) {
+  {
+    std::unique_lock<std::mutex> Lock(QueueLock);
+    Tasks.push(std::move(Task));
+  }
+  QueueCondition.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> Lock(QueueLock);
+  CompletionCondition.wait(Lock,
+                           [this] { return Tasks.empty() && !ActiveThreads; });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> Lock(QueueLock);
+    EnableFlag = false;
+  }
+  QueueCondition.notify_all();
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    Threads[i].join();
+}
+
+#else // LLVM_ENABLE_THREADS
+
+unsigned ThreadPool::getHardwareConcurrency() { return 1; }
+
+void ThreadPool::init(unsigned Count) { ThreadCount = Count; }
+
+void ThreadPool::async(TaskTy Task) { Tasks.push(std::move(Task)); }
+
+void ThreadPool::wait() {
+  // Run the tasks sequentially.  A task may queue more work, so pop each
+  // one before running it.
+  while (!Tasks.empty()) {
+    TaskTy Task = std::move(Tasks.front());
+    Tasks.pop();
+    Task();
+  }
+}
+
+ThreadPool::~ThreadPool() { wait(); }
+
+#endif
@@ -58,17 +58,23 @@ unsigned OR1KELFObjectWriter::GetRelocType(const MCValue &Target,
     Type = ELF::R_OR1K_8_PCREL;
     break;
   case OR1K::fixup_OR1K_32:
-  case FK_Data_4:
     Type = ELF::R_OR1K_32;
     break;
+  case FK_Data_4:
+    Type = IsPCRel ? ELF::R_OR1K_32_PCREL : ELF::R_OR1K_32;
+    break;
   case OR1K::fixup_OR1K_16:
-  case FK_Data_2:
     Type = ELF::R_OR1K_16;
     break;
+  case FK_Data_2:
+    Type = IsPCRel ? ELF::R_OR1K_16_PCREL : ELF::R_OR1K_16;
+    break;
   case OR1K::fixup_OR1K_8:
-  case FK_Data_1:
     Type = ELF::R_OR1K_8;
     break;
+  case FK_Data_1:
+    Type = IsPCRel ? ELF::R_OR1K_8_PCREL : ELF::R_OR1K_8;
+    break;
   case OR1K::fixup_OR1K_NONE:
     Type = ELF::R_OR1K_NONE;
     break;
@@ -0,0 +1,47 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as < %s | opt -S | FileCheck %s
+; RUN: llvm-as < %s | llvm-extract -func=b -S | FileCheck %s -check-prefix=EXTRACT
+
+; The writer records where each function block starts in a FUNCTION_INDEX
+; block at the end of the module; readers with the whole buffer use it to
+; locate bodies without walking the function blocks.
+
+; BC: <FNINDEXOFFSET {{.*}}op0=
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_INDEX_BLOCK
+; BC-NEXT: <ENTRY
+; BC-NEXT: <ENTRY
+; BC-NEXT: <ENTRY
+; BC-NEXT: </FUNCTION_INDEX_BLOCK>
+; BC-NEXT: </MODULE_BLOCK>
+
+declare void @external()
+
+; CHECK: define i32 @0(i32 %x)
+; CHECK-NEXT: add i32 %x, 1
+define i32 @0(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+; CHECK: define i32 @a(i32 %x)
+; CHECK-NEXT: call i32 @0(i32 %x)
+define i32 @a(i32 %x) {
+  %y = call i32 @0(i32 %x)
+  ret i32 %y
+}
+
+; CHECK: define i32 @b(i32 %x)
+; CHECK-NEXT: call void @external()
+; CHECK-NEXT: call i32 @a(i32 %x)
+; EXTRACT: declare i32 @a(i32)
+; EXTRACT: define i32 @b(i32 %x)
+; EXTRACT-NEXT: call void @external()
+; EXTRACT-NEXT: call i32 @a(i32 %x)
+define i32 @b(i32 %x) {
+  call void @external()
+  %y = call i32 @a(i32 %x)
+  ret i32 %y
+}
@@ -0,0 +1,63 @@
+; RUN: llvm-as < %s | llc -mtriple=x86_64-linux -stream-functions | FileCheck %s
+; RUN: llvm-as < %s | llc -mtriple=x86_64-linux -stream-functions -disable-verify \
+; RUN:   | FileCheck %s
+; RUN: llvm-as < %s | llc -mtriple=x86_64-linux | FileCheck %s
+
+; Functions streamed out of a lazily loaded module must keep their linkage
+; and visibility, and functions whose blocks have their address taken must
+; still be emitted correctly.
+
+@table = constant i8* blockaddress(@indirect, %target)
+
+; CHECK-NOT: .globl helper
+; CHECK-LABEL: helper:
+define internal i32 @helper(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+; CHECK: .hidden hidden_fn
+; CHECK: .globl hidden_fn
+; CHECK-LABEL: hidden_fn:
+; CHECK: callq helper
+define hidden i32 @hidden_fn(i32 %x) {
+  %r = call i32 @helper(i32 %x)
+  ret i32 %r
+}
+
+; CHECK: .weak linkonce_fn
+; CHECK-LABEL: linkonce_fn:
+define linkonce_odr i32 @linkonce_fn(i32 %x) {
+  %r = call i32 @hidden_fn(i32 %x)
+  ret i32 %r
+}
+
+; CHECK-LABEL: indirect:
+; CHECK: .Ltmp{{[0-9]+}}:
+; CHECK: movl $1, %eax
+define i32 @indirect(i8* %p) {
+entry:
+  indirectbr i8* %p, [label %target]
+target:
+  ret i32 1
+}
+
+; DwarfEHPrepare rewrites the resume before instruction selection, in an
+; earlier function pass manager than the one that emits the function.
+declare void @may_throw()
+declare i32 @__gxx_personality_v0(...)
+
+; CHECK-LABEL: with_eh:
+; CHECK: callq may_throw
+; CHECK: callq _Unwind_Resume
+define void @with_eh() {
+entry:
+  invoke void @may_throw()
+          to label %cont unwind label %lpad
+cont:
+  ret void
+lpad:
+  %lp = landingpad { i8*, i32 } personality i32 (...)* @__gxx_personality_v0
+          cleanup
+  resume { i8*, i32 } %lp
+}
@@ -0,0 +1,53 @@
+; RUN: rm -rf %t.cache
+; RUN: %lli_mcjit -jit-cache-dir=%t.cache %s
+; RUN: ls %t.cache | FileCheck %s
+; RUN: %lli_mcjit -jit-cache-dir=%t.cache %s
+; RUN: ls %t.cache | count 1
+; RUN: %lli_mcjit -O0 -jit-cache-dir=%t.cache %s
+; RUN: ls %t.cache | count 2
+
+; The second run reuses the cached object.  Changing the optimization level
+; changes the key, so the third run adds a second entry.
+
+; CHECK: llvmcache-{{[0-9a-f]+}}.o
+
+; An existing entry is loaded instead of compiling the module.  Seed the
+; entry for this file with the object of a copy that returns 3.
+; RUN: rm -rf %t.cache %t.seed
+; RUN: %lli_mcjit -jit-cache-dir=%t.cache %s
+; RUN: sed -e 's/ret i32 0/ret i32 3/' %s > %t.ll
+; RUN: not %lli_mcjit -jit-cache-dir=%t.seed %t.ll
+; RUN: %python -c "import glob, shutil, sys; \
+; RUN:     shutil.copy(glob.glob(sys.argv[1] + '/*.o')[0], \
+; RUN:                 glob.glob(sys.argv[2] + '/*.o')[0])" %t.seed %t.cache
+; RUN: not %lli_mcjit -jit-cache-dir=%t.cache %s
+
+; An entry that is not an object file is replaced rather than loaded.
+; RUN: %python -c "import glob, sys; \
+; RUN:     open(glob.glob(sys.argv[1] + '/*.o')[0], 'w').write('garbage')" \
+; RUN:     %t.cache
+; RUN: %lli_mcjit -jit-cache-dir=%t.cache %s
+; RUN: ls %t.cache | count 1
+; RUN: not grep -r garbage %t.cache
+
+; Writing an entry removes temporaries left behind long ago, but not one that
+; may still be being written.
+; RUN: touch -t 200001010000 %t.cache/llvmcache-0.o-stale0.tmp
+; RUN: touch %t.cache/llvmcache-0.o-fresh0.tmp
+; RUN: %lli_mcjit -O0 -jit-cache-dir=%t.cache %s
+; RUN: ls %t.cache | FileCheck -check-prefix=TMP %s
+
+; TMP-NOT: stale0
+; TMP: llvmcache-0.o-fresh0.tmp
+; TMP-NOT: stale0
+
+; With a 2 KB limit only one of these objects (about 1 KB each) is kept.
+; RUN: rm -rf %t.cache
+; RUN: %lli_mcjit -jit-cache-dir=%t.cache -jit-cache-size=2 %s
+; RUN: ls %t.cache | count 1
+; RUN: %lli_mcjit -O0 -jit-cache-dir=%t.cache -jit-cache-size=2 %s
+; RUN: ls %t.cache | count 1
+
+define i32 @main() {
+  ret i32 0
+}
@@ -0,0 +1,68 @@
+; RUN: %lli_mcjit -lazy-mcjit %s > /dev/null
+; RUN: not %lli_mcjit %s > /dev/null 2>&1
+
+; With -lazy-mcjit only the functions that are actually called get compiled,
+; so the unresolvable reference in @never_called is harmless.  Without it the
+; whole module is compiled and linked up front and lli fails.
+
+@counter = internal global i32 0
+
+declare void @does_not_exist()
+
+define void @never_called() {
+  call void @does_not_exist()
+  ret void
+}
+
+define i32 @bump(i32 %x) {
+  %old = load i32* @counter
+  %new = add i32 %old, %x
+  store i32 %new, i32* @counter
+  ret i32 %new
+}
+
+define internal i32 @fib(i32 %n) {
+entry:
+  %small = icmp slt i32 %n, 2
+  br i1 %small, label %done, label %recurse
+
+recurse:
+  %n1 = sub i32 %n, 1
+  %f1 = call i32 @fib(i32 %n1)
+  %n2 = sub i32 %n, 2
+  %f2 = call i32 @fib(i32 %n2)
+  %sum = add i32 %f1, %f2
+  ret i32 %sum
+
+done:
+  ret i32 %n
+}
+
+; The address seen from inside the compiled body is the stub's address.
+define i1 @is_self(i8* %p) {
+  %self = bitcast i1 (i8*)* @is_self to i8*
+  %eq = icmp eq i8* %p, %self
+  ret i1 %eq
+}
+
+define i32 @main() {
+entry:
+  %r1 = call i32 @bump(i32 1)
+  %r2 = call i32 @bump(i32 2)
+  %c = load i32* @counter
+  %ok1 = icmp eq i32 %r2, 3
+  %ok2 = icmp eq i32 %c, 3
+  %f = call i32 @fib(i32 10)
+  %ok3 = icmp eq i32 %f, 55
+  %ok4 = call i1 @is_self(i8* bitcast (i1 (i8*)* @is_self to i8*))
+  %a = and i1 %ok1, %ok2
+  %b = and i1 %ok3, %ok4
+  %ok = and i1 %a, %b
+  br i1 %ok, label %pass, label %fail
+
+pass:
+  ret i32 0
+
+fail:
+  ret i32 1
+}
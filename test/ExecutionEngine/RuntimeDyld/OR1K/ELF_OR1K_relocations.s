@@ -0,0 +1,82 @@
+# RUN: llvm-mc -triple=or1k-unknown-elf -filetype=obj -o %t.o %s
+# RUN: llvm-rtdyld -triple=or1k-unknown-elf -verify -check=%s %t.o
+# RUN: rm %t.o
+
+	.text
+	.globl	foo
+	.align	4
+foo:
+# Check the upper and lower halves of an absolute address.
+# rtdyld-check: decode_operand(insn_hi, 1) = bar[31:16]
+insn_hi:
+	l.movhi	r3, hi(bar)
+# rtdyld-check: decode_operand(insn_lo, 2) = bar[15:0]
+insn_lo:
+	l.ori	r3, r3, lo(bar)
+# Check a branch within the section.
+# rtdyld-check: decode_operand(insn_jal, 0) = (baz - insn_jal)[27:2]
+insn_jal:
+	l.jal	baz
+	l.nop
+# Branches to another section, direct or through the PLT, go through a single
+# stub at the end of this section.
+# rtdyld-check: decode_operand(insn_far, 0) = (stubs - insn_far)[27:2]
+insn_far:
+	l.jal	far
+	l.nop
+# rtdyld-check: decode_operand(insn_plt, 0) = (stubs - insn_plt)[27:2]
+insn_plt:
+	l.jal	plt(far)
+	l.nop
+# The GOT address is computed relative to the first instruction of the pair.
+gotpc_hi:
+	l.movhi	r16, gotpchi(_GLOBAL_OFFSET_TABLE_-4)
+gotpc_lo:
+	l.ori	r16, r16, gotpclo(_GLOBAL_OFFSET_TABLE_+0)
+# Each GOT16 reference gets the next slot.
+# rtdyld-check: decode_operand(got_bar, 2) = 0
+got_bar:
+	l.lwz	r3, got(bar)(r16)
+# rtdyld-check: decode_operand(got_baz, 2) = 4
+got_baz:
+	l.lwz	r4, got(baz)(r16)
+# The GOT is not a symbol, but the PC-relative GOT address plus the
+# GOT-relative offset of bar must give bar's address.
+# rtdyld-check: ((decode_operand(gotpc_hi, 1) << 16) + decode_operand(gotpc_lo, 2) + (decode_operand(gotoff_hi, 1) << 16) + decode_operand(gotoff_lo, 2))[31:0] = (bar - gotpc_hi - 4)[31:0]
+gotoff_hi:
+	l.movhi	r5, gotoffhi(bar)
+gotoff_lo:
+	l.ori	r5, r5, gotofflo(bar)
+	l.jr	r9
+	l.nop
+
+	.globl	baz
+	.align	4
+baz:
+	l.jr	r9
+	l.nop
+# The stub loads the target into r13 and jumps to it:
+# l.movhi r13, hi(far); l.ori r13, r13, lo(far); l.jr r13.
+# rtdyld-check: *{4}stubs[31:16] = 0x19a0
+# rtdyld-check: *{4}stubs[15:0] = far[31:16]
+# rtdyld-check: *{4}(stubs + 4)[31:16] = 0xa9ad
+# rtdyld-check: *{4}(stubs + 4)[15:0] = far[15:0]
+# rtdyld-check: *{4}(stubs + 8) = 0x44006800
+stubs:
+
+	.section	.text.far,"ax",@progbits
+	.globl	far
+	.align	4
+far:
+	l.jr	r9
+	l.nop
+
+	.data
+	.globl	bar
+	.align	4
+bar:
+# rtdyld-check: *{4}bar = foo[31:0]
+	.long	foo
+# rtdyld-check: *{4}pcrel = (baz - pcrel)[31:0]
+pcrel:
+	.long	baz - pcrel
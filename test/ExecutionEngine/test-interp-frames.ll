@@ -0,0 +1,33 @@
+; RUN: %lli -force-interpreter=true %s
+; Recursive calls keep separate values per frame, and instructions created
+; by lowering an intrinsic during execution still get values.
+
+declare i32 @llvm.ctpop.i32(i32)
+
+define i32 @fib(i32 %n) {
+entry:
+  %small = icmp ult i32 %n, 2
+  br i1 %small, label %done, label %recurse
+
+recurse:
+  %n1 = sub i32 %n, 1
+  %f1 = call i32 @fib(i32 %n1)
+  %n2 = sub i32 %n, 2
+  %f2 = call i32 @fib(i32 %n2)
+  %sum = add i32 %f1, %f2
+  br label %done
+
+done:
+  %r = phi i32 [ %n, %entry ], [ %sum, %recurse ]
+  ret i32 %r
+}
+
+define i32 @main() {
+  %f = call i32 @fib(i32 10)
+  %f.ok = icmp eq i32 %f, 55
+  %c = call i32 @llvm.ctpop.i32(i32 240)
+  %c.ok = icmp eq i32 %c, 4
+  %ok = and i1 %f.ok, %c.ok
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
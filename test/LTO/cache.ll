@@ -0,0 +1,81 @@
+; RUN: llvm-as < %s >%t.bc
+; RUN: rm -rf %t.cache && mkdir %t.cache
+
+; Cache hits are detected by replacing entries with this object.
+; RUN: echo ".globl cached; cached:" | \
+; RUN:     llvm-mc -filetype=obj -triple=x86_64-unknown-linux-gnu -o %t.marker.o
+
+; A single object is cached under the hash of the merged module.
+; RUN: llvm-lto -disable-opt -exported-symbol=foo -exported-symbol=bar \
+; RUN:     -cache-dir=%t.cache -o %t1.o %t.bc
+; RUN: ls %t.cache/*.o | count 1
+
+; A second link of the same module takes the object from the cache.
+; RUN: for f in %t.cache/*.o; do cp %t.marker.o $f; done
+; RUN: llvm-lto -disable-opt -exported-symbol=foo -exported-symbol=bar \
+; RUN:     -cache-dir=%t.cache -o %t2.o %t.bc
+; RUN: FileCheck %s -check-prefix=HIT <%t2.o
+
+; An entry that is not an object file is generated again and replaced.
+; RUN: for f in %t.cache/*.o; do echo garbage >$f; done
+; RUN: llvm-lto -disable-opt -exported-symbol=foo -exported-symbol=bar \
+; RUN:     -cache-dir=%t.cache -o %t8.o %t.bc
+; RUN: cmp %t1.o %t8.o
+; RUN: cat %t.cache/*.o | not grep garbage
+
+; A partitioned link caches one object per partition and the list of them.
+; RUN: rm -rf %t.cache && mkdir %t.cache
+; RUN: llvm-lto -disable-opt -codegen-partitions=2 -exported-symbol=foo \
+; RUN:     -exported-symbol=bar -cache-dir=%t.cache -o %t3 %t.bc
+; RUN: ls %t.cache/*.o | count 2
+; RUN: ls %t.cache/*.lst | count 1
+; RUN: for f in %t.cache/*.o; do cp %t.marker.o $f; done
+; RUN: llvm-lto -disable-opt -codegen-partitions=2 -exported-symbol=foo \
+; RUN:     -exported-symbol=bar -cache-dir=%t.cache -o %t4 %t.bc
+; RUN: FileCheck %s -check-prefix=HIT <%t4.0
+; RUN: FileCheck %s -check-prefix=HIT <%t4.1
+
+; HIT: cached
+
+; Changing one function regenerates only the partition holding it; the other
+; partition is still taken from the cache.
+; RUN: sed -e 's/ret void ; bar/unreachable/' %s | llvm-as >%t.changed.bc
+; RUN: llvm-lto -disable-opt -codegen-partitions=2 -exported-symbol=foo \
+; RUN:     -exported-symbol=bar -cache-dir=%t.cache -o %t6 %t.changed.bc
+; RUN: ls %t.cache/*.o | count 3
+; RUN: ls %t.cache/*.lst | count 2
+; RUN: cat %t6.0 %t6.1 | grep -c cached | FileCheck %s -check-prefix=ONE
+
+; ONE: {{^1$}}
+
+; Temporaries and locks left behind by a crashed link are pruned once they
+; are stale, even without a size limit; fresh ones belong to a running link
+; and are kept. The quotes keep lit from substituting the tool path into the
+; file names.
+; RUN: touch -t 200001010000 %t.cache/llvm''-lto-stale.o.tmp-abcdef \
+; RUN:     %t.cache/llvm''-lto-stale.o.lock %t.cache/llvm''-lto-stale.o.lock-01234567
+; RUN: touch %t.cache/llvm''-lto-fresh.o.tmp-abcdef
+; RUN: llvm-lto -disable-opt -codegen-partitions=2 -exported-symbol=foo \
+; RUN:     -exported-symbol=bar -cache-dir=%t.cache -o %t7 %t.bc
+; RUN: ls %t.cache | FileCheck %s -check-prefix=SCRATCH
+
+; SCRATCH-NOT: stale
+; SCRATCH: llvm-lto-fresh.o.tmp-abcdef
+; SCRATCH-NOT: stale
+
+; Pruning to a size smaller than any entry removes every entry, leaving only
+; the fresh temporary.
+; RUN: llvm-lto -disable-opt -codegen-partitions=2 -exported-symbol=foo \
+; RUN:     -cache-dir=%t.cache -cache-size-limit=1 -o %t5 %t.bc
+; RUN: ls %t.cache | count 1
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @foo() {
+  ret void
+}
+
+define void @bar() {
+  ret void ; bar
+}
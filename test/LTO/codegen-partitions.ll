@@ -0,0 +1,39 @@
+; RUN: llvm-as < %s >%t1
+; RUN: llvm-lto -disable-opt -codegen-partitions=2 -exported-symbol=foo \
+; RUN:     -exported-symbol=bar -o %t2 %t1
+; RUN: llvm-nm %t2.0 | FileCheck %s -check-prefix=PART0
+; RUN: llvm-nm %t2.1 | FileCheck %s -check-prefix=PART1
+
+; The output only depends on the number of partitions.
+; RUN: llvm-lto -disable-opt -codegen-partitions=2 -exported-symbol=foo \
+; RUN:     -exported-symbol=bar -o %t3 %t1
+; RUN: cmp %t2.0 %t3.0
+; RUN: cmp %t2.1 %t3.1
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; @shared is laid out after its first caller, @foo. It is also called from
+; @bar in the other partition, so it is renamed and made visible to it.
+
+; PART0-NOT: bar
+; PART0: T foo
+; PART0: T shared.llvm.lto.1
+
+; PART1: T bar
+; PART1-NOT: foo
+; PART1: U shared.llvm.lto.1
+
+define void @foo() {
+  call void @shared()
+  ret void
+}
+
+define void @shared() {
+  ret void
+}
+
+define void @bar() {
+  call void @shared()
+  ret void
+}
@@ -0,0 +1,31 @@
+define void @used_fn() {
+  ret void, !dbg !12
+}
+
+define void @unused_fn() {
+  ret void, !dbg !13
+}
+
+@unused_var = global i32 0
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!11}
+
+!0 = metadata !{i32 786449, metadata !1, i32 12, metadata !"clang", i1 false, metadata !"", i32 0, metadata !2, metadata !2, metadata !3, metadata !9, metadata !2, metadata !""} ; [ DW_TAG_compile_unit ]
+!1 = metadata !{metadata !"a.c", metadata !"/tmp"}
+!2 = metadata !{}
+!3 = metadata !{metadata !4, metadata !8}
+!4 = metadata !{i32 786478, metadata !1, metadata !5, metadata !"used_fn", metadata !"used_fn", metadata !"", i32 1, metadata !6, i1 false, i1 true, i32 0, i32 0, null, i32 0, i1 false, void ()* @used_fn, null, null, metadata !2, i32 1} ; [ DW_TAG_subprogram ] [line 1] [def] [used_fn]
+!5 = metadata !{i32 786473, metadata !1} ; [ DW_TAG_file_type ]
+!6 = metadata !{i32 786453, i32 0, null, metadata !"", i32 0, i64 0, i64 0, i64 0, i32 0, null, metadata !7, i32 0, null, null, null} ; [ DW_TAG_subroutine_type ]
+!7 = metadata !{null}
+!8 = metadata !{i32 786478, metadata !1, metadata !5, metadata !"unused_fn", metadata !"unused_fn", metadata !"", i32 2, metadata !6, i1 false, i1 true, i32 0, i32 0, null, i32 0, i1 false, void ()* @unused_fn, null, null, metadata !2, i32 2} ; [ DW_TAG_subprogram ] [line 2] [def] [unused_fn]
+!9 = metadata !{metadata !10}
+!10 = metadata !{i32 786484, i32 0, null, metadata !"unused_var", metadata !"unused_var", metadata !"", metadata !5, i32 3, metadata !14, i32 0, i32 1, i32* @unused_var, null} ; [ DW_TAG_variable ] [unused_var] [line 3] [def]
+!11 = metadata !{i32 2, metadata !"Debug Info Version", i32 1}
+; The location of the inlined copy of unused_fn in used_fn refers to
+; unused_fn's subprogram, and so to @unused_fn.
+!12 = metadata !{i32 2, i32 0, metadata !8, metadata !15}
+!13 = metadata !{i32 2, i32 0, metadata !8, null}
+!14 = metadata !{i32 786468, null, null, metadata !"int", i32 0, i64 32, i64 32, i64 0, i32 0, i32 5} ; [ DW_TAG_base_type ] [int]
+!15 = metadata !{i32 1, i32 0, metadata !4, null}
@@ -0,0 +1,37 @@
+@used_var = global i32 1
+@unused_var = global i32 2
+@var_ref = global i32* @transitive_var
+@transitive_var = global i32 3
+
+@used_alias = alias void ()* @aliased_fn
+
+define void @used_fn() {
+  call void @transitive_fn()
+  %p = load i32** @var_ref
+  ret void
+}
+
+define void @transitive_fn() {
+  ret void
+}
+
+define void @unused_fn() {
+  call void @unused_callee()
+  ret void
+}
+
+define void @unused_callee() {
+  ret void
+}
+
+define void @aliased_fn() {
+  ret void
+}
+
+define void @root_fn() {
+  ret void
+}
+
+define internal void @unused_internal() {
+  ret void
+}
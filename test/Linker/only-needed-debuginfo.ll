@@ -0,0 +1,24 @@
+; RUN: llvm-link -S -only-needed %s %S/Inputs/only-needed-debuginfo.ll \
+; RUN:   | FileCheck %s
+; RUN: llvm-link -S %s %S/Inputs/only-needed-debuginfo.ll \
+; RUN:   | FileCheck %s -check-prefix=ALL
+
+; Globals that only the debug info refers to are not needed. Their
+; subprogram and variable descriptors stay, with the reference nulled out.
+
+; CHECK-NOT: @unused_var = global
+; CHECK: define void @used_fn()
+; CHECK-NOT: define void @unused_fn()
+; CHECK-DAG: metadata !"used_fn", {{.*}}, void ()* @used_fn,
+; CHECK-DAG: metadata !"unused_fn", {{.*}}, i1 false, null,
+; CHECK-DAG: metadata !"unused_var", {{.*}}, i32 1, null, null}
+
+; ALL-DAG: @unused_var = global i32 0
+; ALL-DAG: define void @unused_fn()
+
+declare void @used_fn()
+
+define void @main() {
+  call void @used_fn()
+  ret void
+}
@@ -0,0 +1,36 @@
+; RUN: llvm-link -S -only-needed %s %S/Inputs/only-needed.ll \
+; RUN:   | FileCheck %s -check-prefix=CHECK -check-prefix=NEEDED
+; RUN: llvm-link -S -only-needed -root=root_fn %s %S/Inputs/only-needed.ll \
+; RUN:   | FileCheck %s -check-prefix=ROOT
+; RUN: llvm-link -S %s %S/Inputs/only-needed.ll \
+; RUN:   | FileCheck %s -check-prefix=ALL
+
+; NEEDED-NOT: unused
+; NEEDED-NOT: root_fn
+; CHECK-DAG: @used_var = global i32 1
+; CHECK-DAG: @var_ref = global i32* @transitive_var
+; CHECK-DAG: @transitive_var = global i32 3
+; CHECK-DAG: @used_alias = alias void ()* @aliased_fn
+; CHECK-DAG: define void @used_fn()
+; CHECK-DAG: define void @transitive_fn()
+; CHECK-DAG: define void @aliased_fn()
+; NEEDED-NOT: unused
+; NEEDED-NOT: root_fn
+
+; ROOT: define void @root_fn()
+
+; ALL-DAG: @unused_var = global i32 2
+; ALL-DAG: define void @unused_fn()
+; ALL-DAG: define void @unused_callee()
+; ALL-DAG: define void @root_fn()
+
+declare void @used_fn()
+declare void @used_alias()
+@used_var = external global i32
+@x = global i32* @used_var
+
+define void @main() {
+  call void @used_fn()
+  call void @used_alias()
+  ret void
+}
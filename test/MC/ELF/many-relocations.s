@@ -0,0 +1,287 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o - \
+// RUN:   | llvm-readobj -s -r | FileCheck %s -check-prefix=X64
+// RUN: llvm-mc -filetype=obj -triple i386-pc-linux-gnu %s -o - \
+// RUN:   | llvm-readobj -s -r | FileCheck %s -check-prefix=I386
+
+// The relocation sections, .strtab and .shstrtab are written straight from
+// the writer's tables rather than from fragments. Check the section layout
+// and relocations of an object with many sections and relocations, for both
+// RELA and REL targets and for a relocation section inside a group.
+
+        .text
+        .globl  f
+f:
+        call    g
+        call    h
+        movl    local, %eax
+        jmp     g
+        .long   .data
+        .long   g - .
+
+        .section .text.hot,"ax",@progbits
+h:
+        call    f
+        call    g
+        .long   local
+        .long   .text
+
+        .section .text.comdat,"axG",@progbits,grp,comdat
+        .globl  inl
+inl:
+        call    f
+        .long   g
+        .long   inl
+
+        .data
+local:
+        .long   f
+        .long   h
+        .long   g + 4
+        .long   .text.hot
+
+        .section .data.many,"aw",@progbits
+        .rept   1000
+        .long   g
+        .long   local
+        .endr
+
+        .section .rodata.str,"aMS",@progbits,1
+        .asciz  "a string"
+
+// X64: Name:  (0)
+// X64: Offset: 0x0
+// X64-NEXT: Size: 0
+// X64-NEXT: Link: 0
+// X64-NEXT: Info: 0
+// X64: Name: .group (78)
+// X64: Offset: 0x40
+// X64-NEXT: Size: 12
+// X64-NEXT: Link: 15
+// X64-NEXT: Info: 1
+// X64: Name: .text (22)
+// X64: Offset: 0x4C
+// X64-NEXT: Size: 30
+// X64-NEXT: Link: 0
+// X64-NEXT: Info: 0
+// X64: Name: .rela.text (17)
+// X64: Offset: 0x2680
+// X64-NEXT: Size: 144
+// X64-NEXT: Link: 15
+// X64-NEXT: Info: 2
+// X64: Name: .data (116)
+// X64: Offset: 0x6C
+// X64-NEXT: Size: 16
+// X64-NEXT: Link: 0
+// X64-NEXT: Info: 0
+// X64: Name: .rela.data (111)
+// X64: Offset: 0x2710
+// X64-NEXT: Size: 96
+// X64-NEXT: Link: 15
+// X64-NEXT: Info: 4
+// X64: Name: .bss (61)
+// X64: Offset: 0x7C
+// X64-NEXT: Size: 0
+// X64-NEXT: Link: 0
+// X64-NEXT: Info: 0
+// X64: Name: .text.hot (33)
+// X64: Offset: 0x7C
+// X64-NEXT: Size: 18
+// X64-NEXT: Link: 0
+// X64-NEXT: Info: 0
+// X64: Name: .rela.text.hot (28)
+// X64: Offset: 0x2770
+// X64-NEXT: Size: 96
+// X64-NEXT: Link: 15
+// X64-NEXT: Info: 7
+// X64: Name: .text.comdat (48)
+// X64: Offset: 0x8E
+// X64-NEXT: Size: 13
+// X64-NEXT: Link: 0
+// X64-NEXT: Info: 0
+// X64: Name: .rela.text.comdat (43)
+// X64: Offset: 0x27D0
+// X64-NEXT: Size: 72
+// X64-NEXT: Link: 15
+// X64-NEXT: Info: 9
+// X64: Name: .data.many (6)
+// X64: Offset: 0x9B
+// X64-NEXT: Size: 8000
+// X64-NEXT: Link: 0
+// X64-NEXT: Info: 0
+// X64: Name: .rela.data.many (1)
+// X64: Offset: 0x2818
+// X64-NEXT: Size: 48000
+// X64-NEXT: Link: 15
+// X64-NEXT: Info: 11
+// X64: Name: .rodata.str (66)
+// X64: Offset: 0x1FDB
+// X64-NEXT: Size: 9
+// X64-NEXT: Link: 0
+// X64-NEXT: Info: 0
+// X64: Name: .shstrtab (85)
+// X64: Offset: 0x1FE4
+// X64-NEXT: Size: 122
+// X64-NEXT: Link: 0
+// X64-NEXT: Info: 0
+// X64: Name: .symtab (103)
+// X64: Offset: 0x24A0
+// X64-NEXT: Size: 432
+// X64-NEXT: Link: 16
+// X64-NEXT: Info: 12
+// X64: Name: .strtab (95)
+// X64: Offset: 0x2650
+// X64-NEXT: Size: 43
+// X64-NEXT: Link: 0
+// X64-NEXT: Info: 0
+// X64: Relocations [
+// X64: Section (3) .rela.text {
+// X64-NEXT: 0x1 R_X86_64_PC32 g 0xFFFFFFFFFFFFFFFC
+// X64-NEXT: 0x6 R_X86_64_PC32 .text.hot 0xFFFFFFFFFFFFFFFC
+// X64-NEXT: 0xD R_X86_64_32S .data 0x0
+// X64-NEXT: 0x12 R_X86_64_PC32 g 0xFFFFFFFFFFFFFFFC
+// X64-NEXT: 0x16 R_X86_64_32 .data 0x0
+// X64-NEXT: 0x1A R_X86_64_PC32 g 0x0
+// X64-NEXT: }
+// X64: Section (5) .rela.data {
+// X64-NEXT: 0x0 R_X86_64_32 f 0x0
+// X64-NEXT: 0x4 R_X86_64_32 .text.hot 0x0
+// X64-NEXT: 0x8 R_X86_64_32 g 0x4
+// X64-NEXT: 0xC R_X86_64_32 .text.hot 0x0
+// X64-NEXT: }
+// X64: Section (8) .rela.text.hot {
+// X64-NEXT: 0x1 R_X86_64_PC32 f 0xFFFFFFFFFFFFFFFC
+// X64-NEXT: 0x6 R_X86_64_PC32 g 0xFFFFFFFFFFFFFFFC
+// X64-NEXT: 0xA R_X86_64_32 .data 0x0
+// X64-NEXT: 0xE R_X86_64_32 .text 0x0
+// X64-NEXT: }
+// X64: Section (10) .rela.text.comdat {
+// X64-NEXT: 0x1 R_X86_64_PC32 f 0xFFFFFFFFFFFFFFFC
+// X64-NEXT: 0x5 R_X86_64_32 g 0x0
+// X64-NEXT: 0x9 R_X86_64_32 inl 0x0
+// X64-NEXT: }
+// X64: Section (12) .rela.data.many {
+// X64-NEXT: 0x0 R_X86_64_32 g 0x0
+// X64-NEXT: 0x4 R_X86_64_32 .data 0x0
+// X64: 0x1F38 R_X86_64_32 g 0x0
+// X64-NEXT: 0x1F3C R_X86_64_32 .data 0x0
+// X64-NEXT: }
+// X64-NEXT: ]
+
+// I386: Name:  (0)
+// I386: Offset: 0x0
+// I386-NEXT: Size: 0
+// I386-NEXT: Link: 0
+// I386-NEXT: Info: 0
+// I386: Name: .group (74)
+// I386: Offset: 0x34
+// I386-NEXT: Size: 12
+// I386-NEXT: Link: 15
+// I386-NEXT: Info: 1
+// I386: Name: .text (20)
+// I386: Offset: 0x40
+// I386-NEXT: Size: 28
+// I386-NEXT: Link: 0
+// I386-NEXT: Info: 0
+// I386: Name: .rel.text (16)
+// I386: Offset: 0x2440
+// I386-NEXT: Size: 48
+// I386-NEXT: Link: 15
+// I386-NEXT: Info: 2
+// I386: Name: .data (111)
+// I386: Offset: 0x5C
+// I386-NEXT: Size: 16
+// I386-NEXT: Link: 0
+// I386-NEXT: Info: 0
+// I386: Name: .rel.data (107)
+// I386: Offset: 0x2470
+// I386-NEXT: Size: 32
+// I386-NEXT: Link: 15
+// I386-NEXT: Info: 4
+// I386: Name: .bss (57)
+// I386: Offset: 0x6C
+// I386-NEXT: Size: 0
+// I386-NEXT: Link: 0
+// I386-NEXT: Info: 0
+// I386: Name: .text.hot (30)
+// I386: Offset: 0x6C
+// I386-NEXT: Size: 18
+// I386-NEXT: Link: 0
+// I386-NEXT: Info: 0
+// I386: Name: .rel.text.hot (26)
+// I386: Offset: 0x2490
+// I386-NEXT: Size: 32
+// I386-NEXT: Link: 15
+// I386-NEXT: Info: 7
+// I386: Name: .text.comdat (44)
+// I386: Offset: 0x7E
+// I386-NEXT: Size: 13
+// I386-NEXT: Link: 0
+// I386-NEXT: Info: 0
+// I386: Name: .rel.text.comdat (40)
+// I386: Offset: 0x24B0
+// I386-NEXT: Size: 24
+// I386-NEXT: Link: 15
+// I386-NEXT: Info: 9
+// I386: Name: .data.many (5)
+// I386: Offset: 0x8B
+// I386-NEXT: Size: 8000
+// I386-NEXT: Link: 0
+// I386-NEXT: Info: 0
+// I386: Name: .rel.data.many (1)
+// I386: Offset: 0x24C8
+// I386-NEXT: Size: 16000
+// I386-NEXT: Link: 15
+// I386-NEXT: Info: 11
+// I386: Name: .rodata.str (62)
+// I386: Offset: 0x1FCB
+// I386-NEXT: Size: 9
+// I386-NEXT: Link: 0
+// I386-NEXT: Info: 0
+// I386: Name: .shstrtab (81)
+// I386: Offset: 0x1FD4
+// I386-NEXT: Size: 117
+// I386-NEXT: Link: 0
+// I386-NEXT: Info: 0
+// I386: Name: .symtab (99)
+// I386: Offset: 0x22F4
+// I386-NEXT: Size: 288
+// I386-NEXT: Link: 16
+// I386-NEXT: Info: 12
+// I386: Name: .strtab (91)
+// I386: Offset: 0x2414
+// I386-NEXT: Size: 43
+// I386-NEXT: Link: 0
+// I386-NEXT: Info: 0
+// I386: Relocations [
+// I386: Section (3) .rel.text {
+// I386-NEXT: 0x1 R_386_PC32 g 0x0
+// I386-NEXT: 0x6 R_386_PC32 .text.hot 0x0
+// I386-NEXT: 0xB R_386_32 .data 0x0
+// I386-NEXT: 0x10 R_386_PC32 g 0x0
+// I386-NEXT: 0x14 R_386_32 .data 0x0
+// I386-NEXT: 0x18 R_386_PC32 g 0x0
+// I386-NEXT: }
+// I386: Section (5) .rel.data {
+// I386-NEXT: 0x0 R_386_32 f 0x0
+// I386-NEXT: 0x4 R_386_32 .text.hot 0x0
+// I386-NEXT: 0x8 R_386_32 g 0x0
+// I386-NEXT: 0xC R_386_32 .text.hot 0x0
+// I386-NEXT: }
+// I386: Section (8) .rel.text.hot {
+// I386-NEXT: 0x1 R_386_PC32 f 0x0
+// I386-NEXT: 0x6 R_386_PC32 g 0x0
+// I386-NEXT: 0xA R_386_32 .data 0x0
+// I386-NEXT: 0xE R_386_32 .text 0x0
+// I386-NEXT: }
+// I386: Section (10) .rel.text.comdat {
+// I386-NEXT: 0x1 R_386_PC32 f 0x0
+// I386-NEXT: 0x5 R_386_32 g 0x0
+// I386-NEXT: 0x9 R_386_32 inl 0x0
+// I386-NEXT: }
+// I386: Section (12) .rel.data.many {
+// I386-NEXT: 0x0 R_386_32 g 0x0
+// I386-NEXT: 0x4 R_386_32 .data 0x0
+// I386: 0x1F38 R_386_32 g 0x0
+// I386-NEXT: 0x1F3C R_386_32 .data 0x0
+// I386-NEXT: }
+// I386-NEXT: ]
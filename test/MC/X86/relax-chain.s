@@ -0,0 +1,22 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t
+// RUN: llvm-objdump -d %t | FileCheck %s
+
+// The second jump lies between the first one and its target. Relaxing it
+// pushes that target out of range, so the first jump, which fit when it was
+// checked, has to be checked again and relaxed as well.
+
+// CHECK:        0: e9 80 00 00 00
+// CHECK-NEXT:   5: e9 fd 00 00 00
+        jmp .L1
+        jmp .L2
+        .fill 123, 1, 0x90
+.L1:
+        .fill 130, 1, 0x90
+.L2:
+// CHECK:      107: e9 79 ff ff ff
+        jmp .L1
+// CHECK-NEXT: 10c: 90
+// CHECK-NEXT: 10d: eb fd
+.L3:
+        nop
+        jmp .L3
@@ -0,0 +1,35 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t1
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu -j 4 %s -o %t4
+// RUN: cmp %t1 %t4
+// RUN: llvm-objdump -d %t4 | FileCheck %s
+
+// Sections that only refer to their own labels are relaxed in parallel. The
+// object must not depend on the number of threads.
+
+// CHECK:      Disassembly of section .text.a:
+// CHECK-NEXT: a:
+// CHECK-NEXT:   0: e9 c8 00 00 00
+// CHECK-NEXT:   5: eb fe
+        .section .text.a,"ax",@progbits
+a:
+        jmp 1f
+        jmp .
+        .fill 198, 1, 0x90
+1:
+
+// CHECK:      Disassembly of section .text.b:
+// CHECK-NEXT: b:
+// CHECK-NEXT:   0: eb 7e
+        .section .text.b,"ax",@progbits
+b:
+        jmp 1f
+        .fill 126, 1, 0x90
+1:
+
+// A jump to another section keeps this one on the calling thread.
+// CHECK:      Disassembly of section .text.c:
+// CHECK-NEXT: c:
+// CHECK-NEXT:   0: e9 {{.*}}
+        .section .text.c,"ax",@progbits
+c:
+        jmp b
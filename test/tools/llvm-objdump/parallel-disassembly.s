@@ -0,0 +1,35 @@
+// RUN: llvm-mc -triple x86_64-unknown-linux -filetype=obj %s -o %t.o
+// RUN: llvm-objdump -d -r -j 1 %t.o > %t.serial
+// RUN: llvm-objdump -d -r -j 4 %t.o > %t.parallel
+// RUN: cmp %t.serial %t.parallel
+// RUN: FileCheck %s < %t.parallel
+
+// Symbols are disassembled independently and printed in address order, and
+// direct branches name the symbol they land in.
+
+// CHECK: Disassembly of section .text:
+// CHECK-NEXT: foo:
+// CHECK-NEXT: 0: {{.*}} jmp -2 <foo>
+// CHECK: bar:
+// CHECK-NEXT: 2: {{.*}} callq -7 <foo>
+// CHECK-NEXT: 7: {{.*}} callq 0 <bar+0xa>
+// CHECK-NEXT: R_X86_64_PC32 ext-4-P
+// CHECK-NEXT: c: {{.*}} jne -12 <bar>
+// CHECK: Disassembly of section .text.baz:
+// CHECK-NEXT: baz:
+// CHECK-NEXT: 0: {{.*}} jmp 0 <baz+0x5>
+// CHECK-NEXT: R_X86_64_PC32 .text-2-P
+
+        .text
+foo:
+        jmp foo
+bar:
+        call foo
+        call ext
+        jne bar
+        retq
+
+        .section .text.baz,"ax",@progbits
+baz:
+        jmp bar
+        retq
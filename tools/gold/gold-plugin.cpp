@@ -84,6 +84,12 @@ namespace options {
   static std::string extra_library_path;
   static std::string triple;
   static std::string mcpu;
+  // Number of partitions to generate code for in parallel.
+  static unsigned jobs = 1;
+  // Directory in which to cache generated objects between links, and the
+  // size in bytes it is pruned to (0 for no limit).
+  static std::string cache_dir;
+  static uint64_t cache_size_limit = 0;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed
   // as plugin exclusive to pass to the code generator.
@@ -101,6 +107,15 @@ namespace options {
       generate_api_file = true;
     } else if (opt.startswith("mcpu=")) {
       mcpu = opt.substr(strlen("mcpu="));
+    } else if (opt.startswith("jobs=")) {
+      if (opt.substr(strlen("jobs=")).getAsInteger(10, jobs) || !jobs)
+        (*message)(LDPL_FATAL, "Invalid jobs option: %s", opt_);
+    } else if (opt.startswith("cache-dir=")) {
+      cache_dir = opt.substr(strlen("cache-dir="));
+    } else if (opt.startswith("cache-size-limit=")) {
+      if (opt.substr(strlen("cache-size-limit="))
+              .getAsInteger(10, cache_size_limit))
+        (*message)(LDPL_FATAL, "Invalid cache-size-limit option: %s", opt_);
     } else if (opt.startswith("extra-library-path=")) {
       extra_library_path = opt.substr(strlen("extra_library_path="));
     } else if (opt.startswith("mtriple=")) {
@@ -459,14 +474,19 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  std::string ObjPath;
+  std::vector<std::string> ObjPaths;
   {
-    const char *Temp;
+    const char **Temps = nullptr;
+    unsigned NumTemps = 0;
     std::string Error;
-    if (!CodeGen->compile_to_file(&Temp, /*DisableOpt*/ false, /*DisableInline*/
-                                  false, /*DisableGVNLoadPRE*/ false, Error))
+    CodeGen->setCodeGenPartitions(options::jobs);
+    CodeGen->setCacheDir(options::cache_dir);
+    CodeGen->setCacheSizeLimit(options::cache_size_limit);
+    if (!CodeGen->compile_to_files(&Temps, &NumTemps, /*DisableOpt*/ false,
+                                   /*DisableInline*/ false,
+                                   /*DisableGVNLoadPRE*/ false, Error))
       (*message)(LDPL_ERROR, "Could not produce a combined object file\n");
-    ObjPath = Temp;
+    ObjPaths.assign(Temps, Temps + NumTemps);
   }
 
   delete CodeGen;
@@ -478,10 +498,14 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  if ((*add_input_file)(ObjPath.c_str()) != LDPS_OK) {
-    (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
-    (*message)(LDPL_ERROR, "File left behind in: %s", ObjPath.c_str());
-    return LDPS_ERR;
+  for (unsigned i = 0, e = ObjPaths.size(); i != e; ++i) {
+    if ((*add_input_file)(ObjPaths[i].c_str()) != LDPS_OK) {
+      (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
+      (*message)(LDPL_ERROR, "File left behind in: %s", ObjPaths[i].c_str());
+      return LDPS_ERR;
+    }
+    if (options::obj_path.empty())
+      Cleanup.push_back(ObjPaths[i]);
   }
 
   if (!options::extra_library_path.empty() &&
@@ -490,9 +514,6 @@ static ld_plugin_status all_symbols_read_hook(void) {
     return LDPS_ERR;
   }
 
-  if (options::obj_path.empty())
-    Cleanup.push_back(ObjPath);
-
   return LDPS_OK;
 }
 
@@ -92,6 +92,11 @@ static cl::opt<bool> AsmVerbose("asm-verbose",
                                 cl::desc("Add comments to directives."),
                                 cl::init(true));
 
+static cl::opt<bool>
+StreamFunctions("stream-functions",
+                cl::desc("Load function bodies lazily and release each one "
+                         "once it has been emitted"));
+
 static int compileModule(char **, LLVMContext &);
 
 // GetFileNameRoot - Helper function to get the basename of a filename.
@@ -231,7 +236,10 @@ static int compileModule(char **argv, LLVMContext &Context) {
 
   // If user just wants to list available options, skip module loading
   if (!SkipModule) {
-    M.reset(ParseIRFile(InputFilename, Err, Context));
+    if (StreamFunctions)
+      M.reset(getLazyIRFileModule(InputFilename, Err, Context));
+    else
+      M.reset(ParseIRFile(InputFilename, Err, Context));
     mod = M.get();
     if (mod == nullptr) {
       Err.print(argv[0], errs());
@@ -309,6 +317,7 @@ static int compileModule(char **argv, LLVMContext &Context) {
 
   // Build up all of the passes that we want to do to the module.
   PassManager PM;
+  PM.setStreamFunctions(StreamFunctions);
 
   // Add an appropriate TargetLibraryInfo pass for the module's triple.
   TargetLibraryInfo *TLI = new TargetLibraryInfo(TheTriple);
@@ -20,6 +20,7 @@
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/ExecutionEngine/FileSystemObjectCache.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
 #include "llvm/ExecutionEngine/JIT.h"
@@ -163,6 +164,18 @@ namespace {
                            "(must be user writable)"),
                   cl::init(""));
 
+  cl::opt<std::string>
+  JITCacheDir("jit-cache-dir",
+              cl::desc("Reuse compiled objects kept in this directory across "
+                       "runs (MCJIT only)"),
+              cl::value_desc("directory"), cl::init(""));
+
+  cl::opt<unsigned>
+  JITCacheSize("jit-cache-size",
+               cl::desc("Limit -jit-cache-dir to this many kilobytes "
+                        "(0 for no limit)"),
+               cl::init(0));
+
   cl::opt<std::string>
   FakeArgv0("fake-argv0",
             cl::desc("Override the 'argv[0]' value passed into the executing"
@@ -177,6 +190,11 @@ namespace {
                   cl::desc("Disable JIT lazy compilation"),
                   cl::init(false));
 
+  cl::opt<bool>
+  LazyMCJIT("lazy-mcjit",
+            cl::desc("With MCJIT, compile each function on its first call"),
+            cl::init(false));
+
   cl::opt<Reloc::Model>
   RelocModel("relocation-model",
              cl::desc("Choose relocation model"),
@@ -321,7 +339,7 @@ private:
 };
 
 static ExecutionEngine *EE = nullptr;
-static LLIObjectCache *CacheManager = nullptr;
+static ObjectCache *CacheManager = nullptr;
 
 static void do_shutdown() {
   // Cygwin-1.5 invokes DLL's dtors before atexit handler.
@@ -507,6 +525,13 @@ int main(int argc, char **argv, char * const *envp) {
   if (EnableCacheManager) {
     CacheManager = new LLIObjectCache(ObjectCacheDir);
     EE->setObjectCache(CacheManager);
+  } else if (!JITCacheDir.empty()) {
+    if (UseMCJIT && !ForceInterpreter) {
+      CacheManager = new FileSystemObjectCache(
+          JITCacheDir, *EE->getTargetMachine(), (uint64_t)JITCacheSize << 10);
+      EE->setObjectCache(CacheManager);
+    } else
+      errs() << "warning: -jit-cache-dir can only be used with MCJIT.\n";
   }
 
   // Load any additional modules specified on the command line.
@@ -570,7 +595,8 @@ int main(int argc, char **argv, char * const *envp) {
     errs() << "warning: remote mcjit does not support lazy compilation\n";
     NoLazyCompilation = true;
   }
-  EE->DisableLazyCompilation(NoLazyCompilation);
+  // MCJIT compiles whole modules unless per-function laziness is requested.
+  EE->DisableLazyCompilation(NoLazyCompilation || (UseMCJIT && !LazyMCJIT));
 
   // If the user specifically requested an argv[0] to pass into the program,
   // do it now.
@@ -18,14 +18,16 @@
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Errc.h"
+#include "llvm/Support/FileOutputBuffer.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
-#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstdlib>
@@ -42,16 +44,9 @@ using namespace llvm;
 // The name this program was invoked as.
 static StringRef ToolName;
 
-static const char *TemporaryOutput;
-static int TmpArchiveFD = -1;
-
 // fail - Show the error message and exit.
 LLVM_ATTRIBUTE_NORETURN static void fail(Twine Error) {
   outs() << ToolName << ": " << Error << ".\n";
-  if (TmpArchiveFD != -1)
-    close(TmpArchiveFD);
-  if (TemporaryOutput)
-    sys::fs::remove(TemporaryOutput);
   exit(1);
 }
 
@@ -70,6 +65,13 @@ static cl::list<std::string>
 RestOfArgs(cl::Positional, cl::OneOrMore,
     cl::desc("[relpos] [count] <archive-file> [members]..."));
 
+static cl::opt<unsigned> NumThreads(
+    "num-threads", cl::init(0),
+    cl::desc("Number of threads used to read member symbols "
+             "(default: one per hardware thread)"));
+static cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                             cl::aliasopt(NumThreads));
+
 std::string Options;
 
 // MoreHelp - Provide additional help output explaining the operations and
@@ -92,6 +94,7 @@ static cl::extrahelp MoreHelp(
   "  [o] - preserve original dates\n"
   "  [s] - create an archive index (cf. ranlib)\n"
   "  [S] - do not build a symbol table\n"
+  "  [T] - create a thin archive\n"
   "  [u] - update only files newer than archive contents\n"
   "\nMODIFIERS (generic):\n"
   "  [c] - do not warn if the library had to be created\n"
@@ -119,6 +122,7 @@ static bool OriginalDates = false; ///< 'o' modifier
 static bool OnlyUpdate = false;    ///< 'u' modifier
 static bool Verbose = false;       ///< 'v' modifier
 static bool Symtab = true;         ///< 's' modifier
+static bool ThinArchive = false;   ///< 'T' modifier
 
 // Relative Positional Argument (for insert/move). This variable holds
 // the name of the archive member to which the 'a', 'b' or 'i' modifier
@@ -211,6 +215,9 @@ static ArchiveOperation parseCommandLine() {
     case 'S':
       Symtab = false;
       break;
+    case 'T':
+      ThinArchive = true;
+      break;
     case 'u': OnlyUpdate = true; break;
     case 'v': Verbose = true; break;
     case 'a':
@@ -264,6 +271,9 @@ static ArchiveOperation parseCommandLine() {
     show_help("The 'o' modifier is only applicable to the 'x' operation");
   if (OnlyUpdate && Operation != ReplaceOrInsert)
     show_help("The 'u' modifier is only applicable to the 'r' operation");
+  if (ThinArchive && Operation != QuickAppend && Operation != ReplaceOrInsert)
+    show_help("The 'T' modifier is only applicable to the 'q' and 'r' "
+              "operations");
 
   // Return the parsed operation to the caller
   return Operation;
@@ -275,7 +285,9 @@ static void doPrint(StringRef Name, object::Archive::child_iterator I) {
   if (Verbose)
     outs() << "Printing " << Name << "\n";
 
-  StringRef Data = I->getBuffer();
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr = I->getMemoryBuffer();
+  failIfError(BufOrErr.getError(), Name);
+  StringRef Data = BufOrErr.get()->getBuffer();
   outs().write(Data.data(), Data.size());
 }
 
@@ -318,6 +330,10 @@ static void doDisplayTable(StringRef Name, object::Archive::child_iterator I) {
 // Implement the 'x' operation. This function extracts files back to the file
 // system.
 static void doExtract(StringRef Name, object::Archive::child_iterator I) {
+  // The members of a thin archive are the files it refers to.
+  if (I->isThinMember())
+    fail("Cannot extract '" + Name + "' from a thin archive");
+
   // Retain the original mode.
   sys::fs::perms Mode = I->getAccessMode();
   SmallString<128> Storage = Name;
@@ -494,7 +510,9 @@ computeInsertAction(ArchiveOperation Operation,
 
   std::vector<std::string>::iterator MI = std::find_if(
       Members.begin(), Members.end(),
-      [Name](StringRef Path) { return Name == sys::path::filename(Path); });
+      [Name](StringRef Path) {
+        return sys::path::filename(Name) == sys::path::filename(Path);
+      });
 
   if (MI == Members.end())
     return IA_AddOldMember;
@@ -549,7 +567,7 @@ computeNewArchiveMembers(ArchiveOperation Operation,
       ErrorOr<StringRef> NameOrErr = I->getName();
       failIfError(NameOrErr.getError());
       StringRef Name = NameOrErr.get();
-      if (Name == PosName) {
+      if (sys::path::filename(Name) == PosName) {
         assert(AddAfter || AddBefore);
         if (AddBefore)
           InsertPos = Pos;
@@ -605,34 +623,33 @@ computeNewArchiveMembers(ArchiveOperation Operation,
 }
 
 template <typename T>
-static void printWithSpacePadding(raw_fd_ostream &OS, T Data, unsigned Size,
-				  bool MayTruncate = false) {
-  uint64_t OldPos = OS.tell();
-  OS << Data;
-  unsigned SizeSoFar = OS.tell() - OldPos;
-  if (Size > SizeSoFar) {
-    unsigned Remaining = Size - SizeSoFar;
-    for (unsigned I = 0; I < Remaining; ++I)
-      OS << ' ';
-  } else if (Size < SizeSoFar) {
+static void printWithSpacePadding(raw_ostream &OS, T Data, unsigned Size,
+                                  bool MayTruncate = false) {
+  SmallString<32> Buf;
+  raw_svector_ostream S(Buf);
+  S << Data;
+  StringRef Str = S.str();
+  if (Str.size() > Size) {
     assert(MayTruncate && "Data doesn't fit in Size");
     // Some of the data this is used for (like UID) can be larger than the
     // space available in the archive format. Truncate in that case.
-    OS.seek(OldPos + Size);
+    Str = Str.substr(0, Size);
   }
+  OS << Str;
+  OS.indent(Size - Str.size());
 }
 
-static void print32BE(raw_fd_ostream &Out, unsigned Val) {
+static void print32BE(raw_ostream &Out, unsigned Val) {
   for (int I = 3; I >= 0; --I) {
     char V = (Val >> (8 * I)) & 0xff;
     Out << V;
   }
 }
 
-static void printRestOfMemberHeader(raw_fd_ostream &Out,
+static void printRestOfMemberHeader(raw_ostream &Out,
                                     const sys::TimeValue &ModTime, unsigned UID,
                                     unsigned GID, unsigned Perms,
-                                    unsigned Size) {
+                                    uint64_t Size) {
   printWithSpacePadding(Out, ModTime.toEpochTime(), 12);
   printWithSpacePadding(Out, UID, 6, true);
   printWithSpacePadding(Out, GID, 6, true);
@@ -641,214 +658,292 @@ static void printRestOfMemberHeader(raw_fd_ostream &Out,
   Out << "`\n";
 }
 
-static void printMemberHeader(raw_fd_ostream &Out, StringRef Name,
+static void printMemberHeader(raw_ostream &Out, StringRef Name,
                               const sys::TimeValue &ModTime, unsigned UID,
-                              unsigned GID, unsigned Perms, unsigned Size) {
+                              unsigned GID, unsigned Perms, uint64_t Size) {
   printWithSpacePadding(Out, Twine(Name) + "/", 16);
   printRestOfMemberHeader(Out, ModTime, UID, GID, Perms, Size);
 }
 
-static void printMemberHeader(raw_fd_ostream &Out, unsigned NameOffset,
+static void printMemberHeader(raw_ostream &Out, unsigned NameOffset,
                               const sys::TimeValue &ModTime, unsigned UID,
-                              unsigned GID, unsigned Perms, unsigned Size) {
+                              unsigned GID, unsigned Perms, uint64_t Size) {
   Out << '/';
   printWithSpacePadding(Out, NameOffset, 15);
   printRestOfMemberHeader(Out, ModTime, UID, GID, Perms, Size);
 }
 
-static void writeStringTable(raw_fd_ostream &Out,
-                             ArrayRef<NewArchiveIterator> Members,
-                             std::vector<unsigned> &StringMapIndexes) {
-  unsigned StartOffset = 0;
-  for (ArrayRef<NewArchiveIterator>::iterator I = Members.begin(),
-                                              E = Members.end();
-       I != E; ++I) {
-    StringRef Name = I->getName();
-    if (Name.size() < 16)
+namespace {
+// The header fields of a member of the archive being written.
+struct MemberHeader {
+  std::string Name;
+  sys::TimeValue ModTime;
+  unsigned UID;
+  unsigned GID;
+  unsigned Perms;
+  uint64_t Size;
+  // Offset of the name in the string table, or -1 if it fits in the header.
+  int NameOffset;
+};
+
+// The symbol table entries contributed by one member.
+struct MemberSymbols {
+  MemberSymbols() : IsSymbolic(false), NumSyms(0) {}
+
+  // True if the member is an object or bitcode file.
+  bool IsSymbolic;
+  // The names of the global symbols the member defines, each followed by a
+  // NUL.
+  std::string Names;
+  unsigned NumSyms;
+  std::error_code EC;
+};
+}
+
+// Collect the global symbols defined by one member.  This runs on the worker
+// threads, so it reports errors through Syms instead of calling fail.
+static void computeMemberSymbols(const MemoryBuffer &Member,
+                                 MemberSymbols &Syms) {
+  sys::fs::file_magic Type = sys::fs::identify_magic(Member.getBuffer());
+  // Bitcode members each get their own context so that they can be read
+  // concurrently.
+  std::unique_ptr<LLVMContext> Context;
+  if (Type == sys::fs::file_magic::bitcode)
+    Context.reset(new LLVMContext());
+
+  std::unique_ptr<MemoryBuffer> Buffer(MemoryBuffer::getMemBuffer(
+      Member.getBuffer(), Member.getBufferIdentifier(), false));
+  ErrorOr<object::SymbolicFile *> ObjOrErr =
+      object::SymbolicFile::createSymbolicFile(Buffer, Type, Context.get());
+  if (!ObjOrErr)
+    return; // FIXME: check only for "not an object file" errors.
+  std::unique_ptr<object::SymbolicFile> Obj(ObjOrErr.get());
+  Syms.IsSymbolic = true;
+
+  raw_string_ostream NameOS(Syms.Names);
+  for (const object::BasicSymbolRef &S : Obj->symbols()) {
+    uint32_t Symflags = S.getFlags();
+    if (Symflags & object::SymbolRef::SF_FormatSpecific)
       continue;
-    if (StartOffset == 0) {
-      printWithSpacePadding(Out, "//", 58);
-      Out << "`\n";
-      StartOffset = Out.tell();
-    }
-    StringMapIndexes.push_back(Out.tell() - StartOffset);
-    Out << Name << "/\n";
+    if (!(Symflags & object::SymbolRef::SF_Global))
+      continue;
+    if (Symflags & object::SymbolRef::SF_Undefined)
+      continue;
+    if ((Syms.EC = S.printName(NameOS)))
+      return;
+    NameOS << '\0';
+    ++Syms.NumSyms;
   }
-  if (StartOffset == 0)
-    return;
-  if (Out.tell() % 2)
-    Out << '\n';
-  int Pos = Out.tell();
-  Out.seek(StartOffset - 12);
-  printWithSpacePadding(Out, Pos - StartOffset, 10);
-  Out.seek(Pos);
-}
-
-static void
-writeSymbolTable(raw_fd_ostream &Out, ArrayRef<NewArchiveIterator> Members,
-                 MutableArrayRef<std::unique_ptr<MemoryBuffer>> Buffers,
-                 std::vector<std::pair<unsigned, unsigned>> &MemberOffsetRefs) {
-  unsigned StartOffset = 0;
-  unsigned MemberNum = 0;
-  std::string NameBuf;
-  raw_string_ostream NameOS(NameBuf);
-  unsigned NumSyms = 0;
-  LLVMContext &Context = getGlobalContext();
-  for (ArrayRef<NewArchiveIterator>::iterator I = Members.begin(),
-                                              E = Members.end();
-       I != E; ++I, ++MemberNum) {
-    std::unique_ptr<MemoryBuffer> &MemberBuffer = Buffers[MemberNum];
-    ErrorOr<object::SymbolicFile *> ObjOrErr =
-        object::SymbolicFile::createSymbolicFile(
-            MemberBuffer, sys::fs::file_magic::unknown, &Context);
-    if (!ObjOrErr)
-      continue;  // FIXME: check only for "not an object file" errors.
-    std::unique_ptr<object::SymbolicFile> Obj(ObjOrErr.get());
-
-    if (!StartOffset) {
-      printMemberHeader(Out, "", sys::TimeValue::now(), 0, 0, 0, 0);
-      StartOffset = Out.tell();
-      print32BE(Out, 0);
-    }
+}
 
-    for (const object::BasicSymbolRef &S : Obj->symbols()) {
-      uint32_t Symflags = S.getFlags();
-      if (Symflags & object::SymbolRef::SF_FormatSpecific)
-        continue;
-      if (!(Symflags & object::SymbolRef::SF_Global))
-        continue;
-      if (Symflags & object::SymbolRef::SF_Undefined)
-        continue;
-      failIfError(S.printName(NameOS));
-      NameOS << '\0';
-      ++NumSyms;
-      MemberOffsetRefs.push_back(std::make_pair(Out.tell(), MemberNum));
-      print32BE(Out, 0);
-    }
-    MemberBuffer.reset(Obj->releaseBuffer());
+// Return the size of the symbol table writeSymbolTable will produce,
+// including its header, or 0 if no member is an object file.
+static uint64_t getSymbolTableSize(ArrayRef<MemberSymbols> Symbols) {
+  bool HasObjects = false;
+  uint64_t Size = 4;
+  for (const MemberSymbols &Syms : Symbols) {
+    HasObjects |= Syms.IsSymbolic;
+    Size += 4 * Syms.NumSyms + Syms.Names.size();
   }
-  Out << NameOS.str();
+  if (!HasObjects)
+    return 0;
+  return sizeof(object::ArchiveMemberHeader) + Size + (Size % 2);
+}
 
-  if (StartOffset == 0)
+// Write the GNU symbol table: the number of symbols, the offset of the member
+// defining each one and then their names.
+static void writeSymbolTable(raw_ostream &Out,
+                             ArrayRef<MemberSymbols> Symbols,
+                             ArrayRef<uint64_t> MemberOffsets) {
+  uint64_t Size = getSymbolTableSize(Symbols);
+  if (!Size)
     return;
 
-  if (Out.tell() % 2)
+  printMemberHeader(Out, "", sys::TimeValue::now(), 0, 0, 0,
+                    Size - sizeof(object::ArchiveMemberHeader));
+  unsigned NumSyms = 0;
+  uint64_t NamesSize = 0;
+  for (const MemberSymbols &Syms : Symbols) {
+    NumSyms += Syms.NumSyms;
+    NamesSize += Syms.Names.size();
+  }
+  print32BE(Out, NumSyms);
+  for (unsigned I = 0, N = Symbols.size(); I != N; ++I)
+    for (unsigned J = 0; J != Symbols[I].NumSyms; ++J)
+      print32BE(Out, MemberOffsets[I]);
+  for (const MemberSymbols &Syms : Symbols)
+    Out << Syms.Names;
+  if (NamesSize % 2)
     Out << '\0';
+}
 
-  unsigned Pos = Out.tell();
-  Out.seek(StartOffset - 12);
-  printWithSpacePadding(Out, Pos - StartOffset, 10);
-  Out.seek(StartOffset);
-  print32BE(Out, NumSyms);
-  Out.seek(Pos);
+// Build the GNU string table holding the names that don't fit in a member
+// header.  Thin archives store every member path in it.
+static std::string buildStringTable(MutableArrayRef<MemberHeader> Headers,
+                                    bool Thin) {
+  std::string StringTable;
+  for (MemberHeader &H : Headers) {
+    H.NameOffset = -1;
+    if (!Thin && H.Name.size() < 16)
+      continue;
+    H.NameOffset = StringTable.size();
+    StringTable += H.Name;
+    StringTable += "/\n";
+  }
+  if (StringTable.size() % 2)
+    StringTable += '\n';
+  return StringTable;
+}
+
+static void writeMemberHeader(raw_ostream &Out, const MemberHeader &H) {
+  if (H.NameOffset == -1)
+    printMemberHeader(Out, H.Name, H.ModTime, H.UID, H.GID, H.Perms, H.Size);
+  else
+    printMemberHeader(Out, H.NameOffset, H.ModTime, H.UID, H.GID, H.Perms,
+                      H.Size);
+}
+
+// Return the name under which a new member is recorded in a thin archive.
+// The paths are relative to the directory of the archive, so keep the path
+// as given when the archive is in the current directory and use an absolute
+// path otherwise.
+static std::string getThinMemberName(StringRef Path) {
+  if (sys::path::is_absolute(Path) ||
+      sys::path::parent_path(ArchiveName).empty())
+    return Path;
+  SmallString<128> AbsPath = Path;
+  failIfError(sys::fs::make_absolute(AbsPath), Path);
+  return AbsPath.str();
 }
 
 static void performWriteOperation(ArchiveOperation Operation,
                                   object::Archive *OldArchive) {
-  SmallString<128> TmpArchive;
-  failIfError(sys::fs::createUniqueFile(ArchiveName + ".temp-archive-%%%%%%%.a",
-                                        TmpArchiveFD, TmpArchive));
-
-  TemporaryOutput = TmpArchive.c_str();
-  tool_output_file Output(TemporaryOutput, TmpArchiveFD);
-  raw_fd_ostream &Out = Output.os();
-  Out << "!<arch>\n";
+  // Once thin, an archive stays thin. Its members are not available to
+  // convert a regular archive in the other direction.
+  bool Thin = ThinArchive || (OldArchive && OldArchive->isThin());
+  if (ThinArchive && OldArchive && !OldArchive->isThin())
+    fail("Cannot convert existing archive '" + ArchiveName +
+         "' to a thin archive");
 
   std::vector<NewArchiveIterator> NewMembers =
       computeNewArchiveMembers(Operation, OldArchive);
+  unsigned NumMembers = NewMembers.size();
 
-  std::vector<std::pair<unsigned, unsigned> > MemberOffsetRefs;
-
-  std::vector<std::unique_ptr<MemoryBuffer>> MemberBuffers;
-  MemberBuffers.resize(NewMembers.size());
+  // A thin archive only needs the member contents to build the symbol table.
+  bool NeedContents = !Thin || Symtab;
 
-  for (unsigned I = 0, N = NewMembers.size(); I < N; ++I) {
-    std::unique_ptr<MemoryBuffer> MemberBuffer;
+  std::vector<MemberHeader> Headers(NumMembers);
+  std::vector<std::unique_ptr<MemoryBuffer>> MemberBuffers(NumMembers);
+  for (unsigned I = 0; I != NumMembers; ++I) {
     NewArchiveIterator &Member = NewMembers[I];
+    MemberHeader &H = Headers[I];
 
     if (Member.isNewMember()) {
       const char *Filename = Member.getNew();
       int FD = Member.getFD();
       const sys::fs::file_status &Status = Member.getStatus();
-      ErrorOr<std::unique_ptr<MemoryBuffer>> MemberBufferOrErr =
-          MemoryBuffer::getOpenFile(FD, Filename, Status.getSize(), false);
-      failIfError(MemberBufferOrErr.getError(), Filename);
-      MemberBuffer = std::move(MemberBufferOrErr.get());
+      H.Name = Thin ? getThinMemberName(Filename) : Member.getName().str();
+      H.ModTime = Status.getLastModificationTime();
+      H.UID = Status.getUser();
+      H.GID = Status.getGroup();
+      H.Perms = Status.permissions();
+      H.Size = Status.getSize();
+      if (NeedContents) {
+        ErrorOr<std::unique_ptr<MemoryBuffer>> MemberBufferOrErr =
+            MemoryBuffer::getOpenFile(FD, Filename, Status.getSize(), false);
+        failIfError(MemberBufferOrErr.getError(), Filename);
+        MemberBuffers[I] = std::move(MemberBufferOrErr.get());
+      }
+      // The buffer no longer needs the descriptor, and large libraries would
+      // otherwise run out of them.
+      close(FD);
     } else {
       object::Archive::child_iterator OldMember = Member.getOld();
-      ErrorOr<std::unique_ptr<MemoryBuffer>> MemberBufferOrErr =
-          OldMember->getMemoryBuffer();
-      failIfError(MemberBufferOrErr.getError());
-      MemberBuffer = std::move(MemberBufferOrErr.get());
+      H.Name = Member.getName();
+      H.ModTime = OldMember->getLastModified();
+      H.UID = OldMember->getUID();
+      H.GID = OldMember->getGID();
+      H.Perms = OldMember->getAccessMode();
+      H.Size = OldMember->getSize();
+      if (NeedContents) {
+        ErrorOr<std::unique_ptr<MemoryBuffer>> MemberBufferOrErr =
+            OldMember->getMemoryBuffer();
+        failIfError(MemberBufferOrErr.getError(), H.Name);
+        MemberBuffers[I] = std::move(MemberBufferOrErr.get());
+      }
     }
-    MemberBuffers[I].reset(MemberBuffer.release());
   }
 
-  if (Symtab) {
-    writeSymbolTable(Out, NewMembers, MemberBuffers, MemberOffsetRefs);
+  // Reading the member symbols dominates the time to build a large library,
+  // so do it for all members in parallel and assemble the table afterwards.
+  std::vector<MemberSymbols> Symbols(Symtab ? NumMembers : 0);
+  if (Symtab && NumMembers) {
+    unsigned Threads = NumThreads ? NumThreads
+                                  : ThreadPool::getHardwareConcurrency();
+    ThreadPool Pool(std::min(Threads, NumMembers));
+    for (unsigned I = 0; I != NumMembers; ++I)
+      Pool.async([&MemberBuffers, &Symbols, I] {
+        computeMemberSymbols(*MemberBuffers[I], Symbols[I]);
+      });
+    Pool.wait();
+    for (unsigned I = 0; I != NumMembers; ++I)
+      failIfError(Symbols[I].EC, Headers[I].Name);
   }
 
-  std::vector<unsigned> StringMapIndexes;
-  writeStringTable(Out, NewMembers, StringMapIndexes);
-
-  std::vector<std::pair<unsigned, unsigned> >::iterator MemberRefsI =
-      MemberOffsetRefs.begin();
-
-  unsigned MemberNum = 0;
-  unsigned LongNameMemberNum = 0;
-  for (std::vector<NewArchiveIterator>::iterator I = NewMembers.begin(),
-                                                 E = NewMembers.end();
-       I != E; ++I, ++MemberNum) {
-
-    unsigned Pos = Out.tell();
-    while (MemberRefsI != MemberOffsetRefs.end() &&
-           MemberRefsI->second == MemberNum) {
-      Out.seek(MemberRefsI->first);
-      print32BE(Out, Pos);
-      ++MemberRefsI;
-    }
-    Out.seek(Pos);
-
-    const MemoryBuffer *File = MemberBuffers[MemberNum].get();
-    if (I->isNewMember()) {
-      const char *FileName = I->getNew();
-      const sys::fs::file_status &Status = I->getStatus();
-
-      StringRef Name = sys::path::filename(FileName);
-      if (Name.size() < 16)
-        printMemberHeader(Out, Name, Status.getLastModificationTime(),
-                          Status.getUser(), Status.getGroup(),
-                          Status.permissions(), Status.getSize());
-      else
-        printMemberHeader(Out, StringMapIndexes[LongNameMemberNum++],
-                          Status.getLastModificationTime(), Status.getUser(),
-                          Status.getGroup(), Status.permissions(),
-                          Status.getSize());
-    } else {
-      object::Archive::child_iterator OldMember = I->getOld();
-      StringRef Name = I->getName();
-
-      if (Name.size() < 16)
-        printMemberHeader(Out, Name, OldMember->getLastModified(),
-                          OldMember->getUID(), OldMember->getGID(),
-                          OldMember->getAccessMode(), OldMember->getSize());
-      else
-        printMemberHeader(Out, StringMapIndexes[LongNameMemberNum++],
-                          OldMember->getLastModified(), OldMember->getUID(),
-                          OldMember->getGID(), OldMember->getAccessMode(),
-                          OldMember->getSize());
-    }
+  // Lay out the archive so that it can be written straight into the output
+  // file.
+  std::string StringTable = buildStringTable(Headers, Thin);
+  uint64_t Pos = 8 + getSymbolTableSize(Symbols);
+  if (!StringTable.empty())
+    Pos += sizeof(object::ArchiveMemberHeader) + StringTable.size();
+  std::vector<uint64_t> MemberOffsets(NumMembers);
+  for (unsigned I = 0; I != NumMembers; ++I) {
+    MemberOffsets[I] = Pos;
+    Pos += sizeof(object::ArchiveMemberHeader);
+    if (!Thin)
+      Pos += Headers[I].Size + (Headers[I].Size % 2);
+  }
 
-    Out << File->getBuffer();
+  std::string Head;
+  raw_string_ostream HeadOS(Head);
+  HeadOS << (Thin ? "!<thin>\n" : "!<arch>\n");
+  writeSymbolTable(HeadOS, Symbols, MemberOffsets);
+  if (!StringTable.empty()) {
+    printWithSpacePadding(HeadOS, "//", 48);
+    printWithSpacePadding(HeadOS, StringTable.size(), 10);
+    HeadOS << "`\n" << StringTable;
+  }
+  HeadOS.flush();
+  assert(Head.size() == (NumMembers ? MemberOffsets[0] : Pos));
+
+  std::unique_ptr<FileOutputBuffer> Output;
+  failIfError(FileOutputBuffer::create(ArchiveName, Pos, Output), ArchiveName);
+  uint8_t *Buf = Output->getBufferStart();
+  memcpy(Buf, Head.data(), Head.size());
+
+  for (unsigned I = 0; I != NumMembers; ++I) {
+    uint8_t *MemberBuf = Buf + MemberOffsets[I];
+    SmallString<sizeof(object::ArchiveMemberHeader)> HeaderBuf;
+    raw_svector_ostream HeaderOS(HeaderBuf);
+    writeMemberHeader(HeaderOS, Headers[I]);
+    StringRef HeaderStr = HeaderOS.str();
+    assert(HeaderStr.size() == sizeof(object::ArchiveMemberHeader));
+    memcpy(MemberBuf, HeaderStr.data(), HeaderStr.size());
+    if (Thin)
+      continue;
 
-    if (Out.tell() % 2)
-      Out << '\n';
+    StringRef Data = MemberBuffers[I]->getBuffer();
+    assert(Data.size() == Headers[I].Size);
+    MemberBuf += HeaderStr.size();
+    memcpy(MemberBuf, Data.data(), Data.size());
+    if (Data.size() % 2)
+      MemberBuf[Data.size()] = '\n';
   }
 
-  Output.keep();
-  Out.close();
-  sys::fs::rename(TemporaryOutput, ArchiveName);
-  TemporaryOutput = nullptr;
+  std::error_code EC = Output->commit();
+  // Destroying the buffer removes the temporary file if the commit failed.
+  Output.reset();
+  failIfError(EC, ArchiveName);
 }
 
 static void createSymbolTable(object::Archive *OldArchive) {
@@ -65,6 +65,14 @@ DumpType("debug-dump", cl::init(DIDT_All),
         clEnumValN(DIDT_StrOffsetsDwo, "str_offsets.dwo", ".debug_str_offsets.dwo"),
         clEnumValEnd));
 
+static cl::list<unsigned long long>
+Lookup("lookup", cl::desc("Print the debug info entries for an address"),
+       cl::value_desc("address"));
+
+static cl::list<std::string>
+Names("name", cl::desc("Print the debug info entries defining a name"),
+      cl::value_desc("name"));
+
 static void DumpInput(const StringRef &Filename) {
   ErrorOr<std::unique_ptr<MemoryBuffer>> Buff =
       MemoryBuffer::getFileOrSTDIN(Filename);
@@ -85,6 +93,19 @@ static void DumpInput(const StringRef &Filename) {
 
   outs() << Filename
          << ":\tfile format " << Obj->getFileFormatName() << "\n\n";
+
+  // Dump only the entries asked for, if any.
+  if (!Lookup.empty() || !Names.empty()) {
+    for (unsigned long long Address : Lookup)
+      if (!DICtx->dumpEntriesForAddress(outs(), Address))
+        errs() << Filename << ": no debug info for address "
+               << format("0x%llx", Address) << "\n";
+    for (const std::string &Name : Names)
+      if (!DICtx->dumpEntriesForName(outs(), Name))
+        errs() << Filename << ": no debug info for name '" << Name << "'\n";
+    return;
+  }
+
   // Dump the complete DWARF structure.
   DICtx->dump(outs(), DumpType);
 }
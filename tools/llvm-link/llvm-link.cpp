@@ -51,6 +51,15 @@ Verbose("v", cl::desc("Print information about actions taken"));
 static cl::opt<bool>
 DumpAsm("d", cl::desc("Print assembly as linked"), cl::Hidden);
 
+static cl::opt<bool>
+OnlyNeeded("only-needed",
+           cl::desc("Link in only the symbols that the modules linked so far "
+                    "refer to"));
+
+static cl::list<std::string>
+RootSymbols("root", cl::desc("Always link in this symbol with -only-needed"),
+            cl::value_desc("symbol"), cl::ZeroOrMore);
+
 static cl::opt<bool>
 SuppressWarnings("suppress-warnings", cl::desc("Suppress all linking warnings"),
                  cl::init(false));
@@ -59,12 +68,16 @@ SuppressWarnings("suppress-warnings", cl::desc("Suppress all linking warnings"),
 // searches the link path for the specified file to try to find it...
 //
 static inline Module *LoadFile(const char *argv0, const std::string &FN,
-                               LLVMContext& Context) {
+                               LLVMContext& Context, bool Lazy = false) {
   SMDiagnostic Err;
   if (Verbose) errs() << "Loading '" << FN << "'\n";
   Module* Result = nullptr;
 
-  Result = ParseIRFile(FN, Err, Context);
+  // When only needed symbols are linked, function bodies are read on demand.
+  if (Lazy)
+    Result = getLazyIRFileModule(FN, Err, Context);
+  else
+    Result = ParseIRFile(FN, Err, Context);
   if (Result) return Result;   // Load successful!
 
   Err.print(argv0, errs());
@@ -92,8 +105,16 @@ int main(int argc, char **argv) {
   }
 
   Linker L(Composite.get(), SuppressWarnings);
+  unsigned Mode = Linker::DestroySource;
+  if (OnlyNeeded) {
+    Mode |= Linker::LinkOnlyNeeded;
+    for (unsigned i = 0, e = RootSymbols.size(); i != e; ++i)
+      L.addRootSymbol(RootSymbols[i]);
+  }
+
   for (unsigned i = BaseArg+1; i < InputFilenames.size(); ++i) {
-    std::unique_ptr<Module> M(LoadFile(argv[0], InputFilenames[i], Context));
+    std::unique_ptr<Module> M(LoadFile(argv[0], InputFilenames[i], Context,
+                                       OnlyNeeded));
     if (!M.get()) {
       errs() << argv[0] << ": error loading file '" <<InputFilenames[i]<< "'\n";
       return 1;
@@ -101,7 +122,7 @@ int main(int argc, char **argv) {
 
     if (Verbose) errs() << "Linking in '" << InputFilenames[i] << "'\n";
 
-    if (L.linkInModule(M.get(), &ErrorMessage)) {
+    if (L.linkInModule(M.get(), Mode, &ErrorMessage)) {
       errs() << argv[0] << ": link error in '" << InputFilenames[i]
              << "': " << ErrorMessage << "\n";
       return 1;
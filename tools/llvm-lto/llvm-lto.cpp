@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
@@ -19,6 +20,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
@@ -38,6 +40,22 @@ static cl::opt<bool>
 DisableGVNLoadPRE("disable-gvn-loadpre", cl::init(false),
   cl::desc("Do not run the GVN load PRE pass"));
 
+static cl::opt<unsigned>
+CodeGenPartitions("codegen-partitions", cl::init(1),
+  cl::desc("Split code generation into this many parallel partitions; with "
+           "-o, partition i is written to <filename>.i"),
+  cl::value_desc("N"));
+
+static cl::opt<std::string>
+CacheDir("cache-dir", cl::init(""),
+  cl::desc("Cache generated objects in this directory between runs"),
+  cl::value_desc("directory"));
+
+static cl::opt<unsigned long long>
+CacheSizeLimit("cache-size-limit", cl::init(0),
+  cl::desc("Prune the cache directory to this many bytes (0 for no limit)"),
+  cl::value_desc("bytes"));
+
 static cl::list<std::string>
 InputFilenames(cl::Positional, cl::OneOrMore,
   cl::desc("<input bitcode files>"));
@@ -154,7 +172,48 @@ int main(int argc, char **argv) {
   if (!attrs.empty())
     CodeGen.setAttr(attrs.c_str());
 
-  if (!OutputFilename.empty()) {
+  CodeGen.setCacheDir(CacheDir);
+  CodeGen.setCacheSizeLimit(CacheSizeLimit);
+
+  if (CodeGenPartitions > 1) {
+    CodeGen.setCodeGenPartitions(CodeGenPartitions);
+
+    std::string ErrorInfo;
+    const char **OutputNames = nullptr;
+    unsigned NumOutputs = 0;
+    if (!CodeGen.compile_to_files(&OutputNames, &NumOutputs, DisableOpt,
+                                  DisableInline, DisableGVNLoadPRE,
+                                  ErrorInfo)) {
+      errs() << argv[0]
+             << ": error compiling the code: " << ErrorInfo << "\n";
+      return 1;
+    }
+
+    for (unsigned i = 0; i != NumOutputs; ++i) {
+      if (OutputFilename.empty()) {
+        outs() << "Wrote native object file '" << OutputNames[i] << "'\n";
+        continue;
+      }
+
+      std::string PartName = OutputFilename + "." + utostr(i);
+      ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+          MemoryBuffer::getFile(OutputNames[i], -1, false);
+      sys::fs::remove(OutputNames[i]);
+      if (std::error_code EC = BufferOrErr.getError()) {
+        errs() << argv[0] << ": error reading the file '" << OutputNames[i]
+               << "': " << EC.message() << "\n";
+        return 1;
+      }
+
+      raw_fd_ostream FileStream(PartName.c_str(), ErrorInfo, sys::fs::F_None);
+      if (!ErrorInfo.empty()) {
+        errs() << argv[0] << ": error opening the file '" << PartName
+               << "': " << ErrorInfo << "\n";
+        return 1;
+      }
+      FileStream << BufferOrErr.get()->getBuffer();
+    }
+  } else if (!OutputFilename.empty()) {
     size_t len = 0;
     std::string ErrorInfo;
     const void *Code = CodeGen.compile(&len, DisableOpt, DisableInline,
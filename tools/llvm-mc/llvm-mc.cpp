@@ -17,8 +17,10 @@
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/MCInstPrinter.h"
+#include "llvm/MC/MCAssembler.h"
 #include "llvm/MC/MCInstrInfo.h"
 #include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/MC/MCObjectStreamer.h"
 #include "llvm/MC/MCParser/AsmLexer.h"
 #include "llvm/MC/MCRegisterInfo.h"
 #include "llvm/MC/MCSectionMachO.h"
@@ -164,6 +166,13 @@ static cl::opt<bool> SaveTempLabels("save-temp-labels",
 static cl::opt<bool> NoExecStack("no-exec-stack",
                                  cl::desc("File doesn't need an exec stack"));
 
+static cl::opt<unsigned>
+NumThreads("num-threads", cl::init(1),
+           cl::desc("Number of threads used to relax independent sections "
+                    "(0 = one per hardware thread)"));
+static cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                             cl::aliasopt(NumThreads));
+
 enum ActionType {
   AC_AsLex,
   AC_Assemble,
@@ -474,6 +483,8 @@ int main(int argc, char **argv) {
     Str.reset(TheTarget->createMCObjectStreamer(TripleName, Ctx, *MAB,
                                                 FOS, CE, *STI, RelaxAll,
                                                 NoExecStack));
+    static_cast<MCObjectStreamer *>(Str.get())->getAssembler().setNumThreads(
+        NumThreads);
   }
 
   int Res = 1;
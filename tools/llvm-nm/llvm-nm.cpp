@@ -36,6 +36,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
 #include <algorithm>
@@ -146,6 +147,11 @@ cl::list<std::string> SegSect("s", cl::Positional, cl::ZeroOrMore,
                               cl::desc("Dump only symbols from this segment "
                                        "and section name, Mach-O only"));
 
+cl::opt<unsigned> NumThreads("num-threads", cl::init(0),
+                             cl::desc("Number of threads used to read archive "
+                                      "members (default: one per hardware "
+                                      "thread)"));
+
 bool PrintAddress = true;
 
 bool MultipleFiles = false;
@@ -153,11 +159,36 @@ bool MultipleFiles = false;
 bool HadError = false;
 
 std::string ToolName;
+
+/// The output for one archive member.  Members are dumped on worker threads
+/// and their output and errors are printed in archive order afterwards.
+struct MemberOutput {
+  std::string Out;
+  std::string Errs;
+  bool ArchMismatch;
+  MemberOutput() : ArchMismatch(false) {}
+};
+}
+
+/// Report an error on ErrOS.  Archive members report into buffers of their
+/// own, and whoever prints those notes the error; only errors written
+/// straight to stderr are counted here.
+static void error(Twine Message, Twine Path, raw_ostream &ErrOS) {
+  if (&ErrOS == &errs())
+    HadError = true;
+  ErrOS << ToolName << ": " << Path << ": " << Message << ".\n";
 }
 
 static void error(Twine Message, Twine Path = Twine()) {
-  HadError = true;
-  errs() << ToolName << ": " << Path << ": " << Message << ".\n";
+  error(Message, Path, errs());
+}
+
+static bool error(std::error_code EC, raw_ostream &ErrOS) {
+  if (EC) {
+    error(EC.message(), Twine(), ErrOS);
+    return true;
+  }
+  return false;
 }
 
 static bool error(std::error_code EC, Twine Path = Twine()) {
@@ -263,15 +294,14 @@ static char isSymbolList64Bit(SymbolicFile *Obj) {
     return false;
 }
 
-static StringRef CurrentFilename;
 typedef std::vector<NMSymbol> SymbolListT;
-static SymbolListT SymbolList;
 
 // darwinPrintSymbol() is used to print a symbol from a Mach-O file when the
 // the OutputFormat is darwin.  It produces the same output as darwin's nm(1) -m
 // output.
 static void darwinPrintSymbol(MachOObjectFile *MachO, SymbolListT::iterator I,
-                              char *SymbolAddrStr, const char *printBlanks) {
+                              char *SymbolAddrStr, const char *printBlanks,
+                              raw_ostream &OS) {
   MachO::mach_header H;
   MachO::mach_header_64 H_64;
   uint32_t Filetype, Flags;
@@ -301,38 +331,38 @@ static void darwinPrintSymbol(MachOObjectFile *MachO, SymbolListT::iterator I,
   if (PrintAddress) {
     if ((NType & MachO::N_TYPE) == MachO::N_INDR)
       strcpy(SymbolAddrStr, printBlanks);
-    outs() << SymbolAddrStr << ' ';
+    OS << SymbolAddrStr << ' ';
   }
 
   switch (NType & MachO::N_TYPE) {
   case MachO::N_UNDF:
     if (NValue != 0) {
-      outs() << "(common) ";
+      OS << "(common) ";
       if (MachO::GET_COMM_ALIGN(NDesc) != 0)
-        outs() << "(alignment 2^" << (int)MachO::GET_COMM_ALIGN(NDesc) << ") ";
+        OS << "(alignment 2^" << (int)MachO::GET_COMM_ALIGN(NDesc) << ") ";
     } else {
       if ((NType & MachO::N_TYPE) == MachO::N_PBUD)
-        outs() << "(prebound ";
+        OS << "(prebound ";
       else
-        outs() << "(";
+        OS << "(";
       if ((NDesc & MachO::REFERENCE_TYPE) ==
           MachO::REFERENCE_FLAG_UNDEFINED_LAZY)
-        outs() << "undefined [lazy bound]) ";
+        OS << "undefined [lazy bound]) ";
       else if ((NDesc & MachO::REFERENCE_TYPE) ==
                MachO::REFERENCE_FLAG_UNDEFINED_LAZY)
-        outs() << "undefined [private lazy bound]) ";
+        OS << "undefined [private lazy bound]) ";
       else if ((NDesc & MachO::REFERENCE_TYPE) ==
                MachO::REFERENCE_FLAG_PRIVATE_UNDEFINED_NON_LAZY)
-        outs() << "undefined [private]) ";
+        OS << "undefined [private]) ";
       else
-        outs() << "undefined) ";
+        OS << "undefined) ";
     }
     break;
   case MachO::N_ABS:
-    outs() << "(absolute) ";
+    OS << "(absolute) ";
     break;
   case MachO::N_INDR:
-    outs() << "(indirect) ";
+    OS << "(indirect) ";
     break;
   case MachO::N_SECT: {
     section_iterator Sec = MachO->section_end();
@@ -341,66 +371,66 @@ static void darwinPrintSymbol(MachOObjectFile *MachO, SymbolListT::iterator I,
     StringRef SectionName;
     MachO->getSectionName(Ref, SectionName);
     StringRef SegmentName = MachO->getSectionFinalSegmentName(Ref);
-    outs() << "(" << SegmentName << "," << SectionName << ") ";
+    OS << "(" << SegmentName << "," << SectionName << ") ";
     break;
   }
   default:
-    outs() << "(?) ";
+    OS << "(?) ";
     break;
   }
 
   if (NType & MachO::N_EXT) {
     if (NDesc & MachO::REFERENCED_DYNAMICALLY)
-      outs() << "[referenced dynamically] ";
+      OS << "[referenced dynamically] ";
     if (NType & MachO::N_PEXT) {
       if ((NDesc & MachO::N_WEAK_DEF) == MachO::N_WEAK_DEF)
-        outs() << "weak private external ";
+        OS << "weak private external ";
       else
-        outs() << "private external ";
+        OS << "private external ";
     } else {
       if ((NDesc & MachO::N_WEAK_REF) == MachO::N_WEAK_REF ||
           (NDesc & MachO::N_WEAK_DEF) == MachO::N_WEAK_DEF) {
         if ((NDesc & (MachO::N_WEAK_REF | MachO::N_WEAK_DEF)) ==
             (MachO::N_WEAK_REF | MachO::N_WEAK_DEF))
-          outs() << "weak external automatically hidden ";
+          OS << "weak external automatically hidden ";
         else
-          outs() << "weak external ";
+          OS << "weak external ";
       } else
-        outs() << "external ";
+        OS << "external ";
     }
   } else {
     if (NType & MachO::N_PEXT)
-      outs() << "non-external (was a private external) ";
+      OS << "non-external (was a private external) ";
     else
-      outs() << "non-external ";
+      OS << "non-external ";
   }
 
   if (Filetype == MachO::MH_OBJECT &&
       (NDesc & MachO::N_NO_DEAD_STRIP) == MachO::N_NO_DEAD_STRIP)
-    outs() << "[no dead strip] ";
+    OS << "[no dead strip] ";
 
   if (Filetype == MachO::MH_OBJECT &&
       ((NType & MachO::N_TYPE) != MachO::N_UNDF) &&
       (NDesc & MachO::N_SYMBOL_RESOLVER) == MachO::N_SYMBOL_RESOLVER)
-    outs() << "[symbol resolver] ";
+    OS << "[symbol resolver] ";
 
   if (Filetype == MachO::MH_OBJECT &&
       ((NType & MachO::N_TYPE) != MachO::N_UNDF) &&
       (NDesc & MachO::N_ALT_ENTRY) == MachO::N_ALT_ENTRY)
-    outs() << "[alt entry] ";
+    OS << "[alt entry] ";
 
   if ((NDesc & MachO::N_ARM_THUMB_DEF) == MachO::N_ARM_THUMB_DEF)
-    outs() << "[Thumb] ";
+    OS << "[Thumb] ";
 
   if ((NType & MachO::N_TYPE) == MachO::N_INDR) {
-    outs() << I->Name << " (for ";
+    OS << I->Name << " (for ";
     StringRef IndirectName;
     if (MachO->getIndirectName(I->Symb, IndirectName))
-      outs() << "?)";
+      OS << "?)";
     else
-      outs() << IndirectName << ")";
+      OS << IndirectName << ")";
   } else
-    outs() << I->Name;
+    OS << I->Name;
 
   if ((Flags & MachO::MH_TWOLEVEL) == MachO::MH_TWOLEVEL &&
       (((NType & MachO::N_TYPE) == MachO::N_UNDF && NValue == 0) ||
@@ -408,23 +438,25 @@ static void darwinPrintSymbol(MachOObjectFile *MachO, SymbolListT::iterator I,
     uint32_t LibraryOrdinal = MachO::GET_LIBRARY_ORDINAL(NDesc);
     if (LibraryOrdinal != 0) {
       if (LibraryOrdinal == MachO::EXECUTABLE_ORDINAL)
-        outs() << " (from executable)";
+        OS << " (from executable)";
       else if (LibraryOrdinal == MachO::DYNAMIC_LOOKUP_ORDINAL)
-        outs() << " (dynamically looked up)";
+        OS << " (dynamically looked up)";
       else {
         StringRef LibraryName;
         if (MachO->getLibraryShortNameByIndex(LibraryOrdinal - 1, LibraryName))
-          outs() << " (from bad library ordinal " << LibraryOrdinal << ")";
+          OS << " (from bad library ordinal " << LibraryOrdinal << ")";
         else
-          outs() << " (from " << LibraryName << ")";
+          OS << " (from " << LibraryName << ")";
       }
     }
   }
 
-  outs() << "\n";
+  OS << "\n";
 }
 
-static void sortAndPrintSymbolList(SymbolicFile *Obj, bool printName) {
+static void sortAndPrintSymbolList(SymbolicFile *Obj, bool printName,
+                                   StringRef CurrentFilename,
+                                   SymbolListT &SymbolList, raw_ostream &OS) {
   if (!NoSort) {
     if (NumericSort)
       std::sort(SymbolList.begin(), SymbolList.end(), compareSymbolAddress);
@@ -435,11 +467,11 @@ static void sortAndPrintSymbolList(SymbolicFile *Obj, bool printName) {
   }
 
   if (OutputFormat == posix && MultipleFiles && printName) {
-    outs() << '\n' << CurrentFilename << ":\n";
+    OS << '\n' << CurrentFilename << ":\n";
   } else if (OutputFormat == bsd && MultipleFiles && printName) {
-    outs() << "\n" << CurrentFilename << ":\n";
+    OS << "\n" << CurrentFilename << ":\n";
   } else if (OutputFormat == sysv) {
-    outs() << "\n\nSymbols from " << CurrentFilename << ":\n\n"
+    OS << "\n\nSymbols from " << CurrentFilename << ":\n\n"
            << "Name                  Value   Class        Type"
            << "         Size   Line  Section\n";
   }
@@ -462,7 +494,7 @@ static void sortAndPrintSymbolList(SymbolicFile *Obj, bool printName) {
     if (SizeSort && !PrintAddress && I->Size == UnknownAddressOrSize)
       continue;
     if (JustSymbolName) {
-      outs() << I->Name << "\n";
+      OS << I->Name << "\n";
       continue;
     }
 
@@ -485,34 +517,32 @@ static void sortAndPrintSymbolList(SymbolicFile *Obj, bool printName) {
     // fall back to OutputFormat bsd (see below).
     MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(Obj);
     if (OutputFormat == darwin && MachO) {
-      darwinPrintSymbol(MachO, I, SymbolAddrStr, printBlanks);
+      darwinPrintSymbol(MachO, I, SymbolAddrStr, printBlanks, OS);
     } else if (OutputFormat == posix) {
-      outs() << I->Name << " " << I->TypeChar << " " << SymbolAddrStr
+      OS << I->Name << " " << I->TypeChar << " " << SymbolAddrStr
              << SymbolSizeStr << "\n";
     } else if (OutputFormat == bsd || (OutputFormat == darwin && !MachO)) {
       if (PrintAddress)
-        outs() << SymbolAddrStr << ' ';
+        OS << SymbolAddrStr << ' ';
       if (PrintSize) {
-        outs() << SymbolSizeStr;
+        OS << SymbolSizeStr;
         if (I->Size != UnknownAddressOrSize)
-          outs() << ' ';
+          OS << ' ';
       }
-      outs() << I->TypeChar << " " << I->Name << "\n";
+      OS << I->TypeChar << " " << I->Name << "\n";
     } else if (OutputFormat == sysv) {
       std::string PaddedName(I->Name);
       while (PaddedName.length() < 20)
         PaddedName += " ";
-      outs() << PaddedName << "|" << SymbolAddrStr << "|   " << I->TypeChar
+      OS << PaddedName << "|" << SymbolAddrStr << "|   " << I->TypeChar
              << "  |                  |" << SymbolSizeStr << "|     |\n";
     }
   }
-
-  SymbolList.clear();
 }
 
 template <class ELFT>
 static char getSymbolNMTypeChar(ELFObjectFile<ELFT> &Obj,
-                                basic_symbol_iterator I) {
+                                basic_symbol_iterator I, raw_ostream &ErrOS) {
   typedef typename ELFObjectFile<ELFT>::Elf_Sym Elf_Sym;
   typedef typename ELFObjectFile<ELFT>::Elf_Shdr Elf_Shdr;
 
@@ -547,7 +577,7 @@ static char getSymbolNMTypeChar(ELFObjectFile<ELFT> &Obj,
 
   if (ESym->getType() == ELF::STT_SECTION) {
     StringRef Name;
-    if (error(SymI->getName(Name)))
+    if (error(SymI->getName(Name), ErrOS))
       return '?';
     return StringSwitch<char>(Name)
         .StartsWith(".debug", 'N')
@@ -558,13 +588,14 @@ static char getSymbolNMTypeChar(ELFObjectFile<ELFT> &Obj,
   return '?';
 }
 
-static char getSymbolNMTypeChar(COFFObjectFile &Obj, symbol_iterator I) {
+static char getSymbolNMTypeChar(COFFObjectFile &Obj, symbol_iterator I,
+                                raw_ostream &ErrOS) {
   const coff_symbol *Symb = Obj.getCOFFSymbol(*I);
   // OK, this is COFF.
   symbol_iterator SymI(I);
 
   StringRef Name;
-  if (error(SymI->getName(Name)))
+  if (error(SymI->getName(Name), ErrOS))
     return '?';
 
   char Ret = StringSwitch<char>(Name)
@@ -578,7 +609,7 @@ static char getSymbolNMTypeChar(COFFObjectFile &Obj, symbol_iterator I) {
   uint32_t Characteristics = 0;
   if (!COFF::isReservedSectionNumber(Symb->SectionNumber)) {
     section_iterator SecI = Obj.section_end();
-    if (error(SymI->getSection(SecI)))
+    if (error(SymI->getSection(SecI), ErrOS))
       return '?';
     const coff_section *Section = Obj.getCOFFSection(*SecI);
     Characteristics = Section->Characteristics;
@@ -685,7 +716,8 @@ static bool isObject(SymbolicFile *Obj, basic_symbol_iterator I) {
   return false;
 }
 
-static char getNMTypeChar(SymbolicFile *Obj, basic_symbol_iterator I) {
+static char getNMTypeChar(SymbolicFile *Obj, basic_symbol_iterator I,
+                          raw_ostream &ErrOS) {
   uint32_t Symflags = I->getFlags();
   if ((Symflags & object::SymbolRef::SF_Weak) && !isa<MachOObjectFile>(Obj)) {
     char Ret = isObject(Obj, I) ? 'v' : 'w';
@@ -706,17 +738,17 @@ static char getNMTypeChar(SymbolicFile *Obj, basic_symbol_iterator I) {
   else if (IRObjectFile *IR = dyn_cast<IRObjectFile>(Obj))
     Ret = getSymbolNMTypeChar(*IR, I);
   else if (COFFObjectFile *COFF = dyn_cast<COFFObjectFile>(Obj))
-    Ret = getSymbolNMTypeChar(*COFF, I);
+    Ret = getSymbolNMTypeChar(*COFF, I, ErrOS);
   else if (MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(Obj))
     Ret = getSymbolNMTypeChar(*MachO, I);
   else if (ELF32LEObjectFile *ELF = dyn_cast<ELF32LEObjectFile>(Obj))
-    Ret = getSymbolNMTypeChar(*ELF, I);
+    Ret = getSymbolNMTypeChar(*ELF, I, ErrOS);
   else if (ELF64LEObjectFile *ELF = dyn_cast<ELF64LEObjectFile>(Obj))
-    Ret = getSymbolNMTypeChar(*ELF, I);
+    Ret = getSymbolNMTypeChar(*ELF, I, ErrOS);
   else if (ELF32BEObjectFile *ELF = dyn_cast<ELF32BEObjectFile>(Obj))
-    Ret = getSymbolNMTypeChar(*ELF, I);
+    Ret = getSymbolNMTypeChar(*ELF, I, ErrOS);
   else
-    Ret = getSymbolNMTypeChar(*cast<ELF64BEObjectFile>(Obj), I);
+    Ret = getSymbolNMTypeChar(*cast<ELF64BEObjectFile>(Obj), I, ErrOS);
 
   if (Symflags & object::SymbolRef::SF_Global)
     Ret = toupper(Ret);
@@ -764,12 +796,14 @@ static unsigned getNsectInMachO(MachOObjectFile &Obj, basic_symbol_iterator I) {
   return 0;
 }
 
-static void dumpSymbolNamesFromObject(SymbolicFile *Obj, bool printName) {
+static void dumpSymbolNamesFromObject(SymbolicFile *Obj, bool printName,
+                                      raw_ostream &Out, raw_ostream &ErrOS) {
   basic_symbol_iterator IBegin = Obj->symbol_begin();
   basic_symbol_iterator IEnd = Obj->symbol_end();
   if (DynamicSyms) {
     if (!Obj->isELF()) {
-      error("File format has no dynamic symbol table", Obj->getFileName());
+      error("File format has no dynamic symbol table", Obj->getFileName(),
+            ErrOS);
       return;
     }
     std::pair<symbol_iterator, symbol_iterator> IDyn =
@@ -777,6 +811,7 @@ static void dumpSymbolNamesFromObject(SymbolicFile *Obj, bool printName) {
     IBegin = IDyn.first;
     IEnd = IDyn.second;
   }
+  SymbolListT SymbolList;
   std::string NameBuffer;
   raw_string_ostream OS(NameBuffer);
   // If a "-s segname sectname" option was specified and this is a Mach-O
@@ -810,14 +845,14 @@ static void dumpSymbolNamesFromObject(SymbolicFile *Obj, bool printName) {
     S.Address = UnknownAddressOrSize;
     if ((PrintSize || SizeSort) && isa<ObjectFile>(Obj)) {
       symbol_iterator SymI = I;
-      if (error(SymI->getSize(S.Size)))
+      if (error(SymI->getSize(S.Size), ErrOS))
         break;
     }
     if (PrintAddress && isa<ObjectFile>(Obj))
-      if (error(symbol_iterator(I)->getAddress(S.Address)))
+      if (error(symbol_iterator(I)->getAddress(S.Address), ErrOS))
         break;
-    S.TypeChar = getNMTypeChar(Obj, I);
-    if (error(I->printName(OS)))
+    S.TypeChar = getNMTypeChar(Obj, I, ErrOS);
+    if (error(I->printName(OS), ErrOS))
       break;
     OS << '\0';
     S.Symb = I->getRawDataRefImpl();
@@ -831,8 +866,7 @@ static void dumpSymbolNamesFromObject(SymbolicFile *Obj, bool printName) {
     P += strlen(P) + 1;
   }
 
-  CurrentFilename = Obj->getFileName();
-  sortAndPrintSymbolList(Obj, printName);
+  sortAndPrintSymbolList(Obj, printName, Obj->getFileName(), SymbolList, Out);
 }
 
 // checkMachOAndArchFlags() checks to see if the SymbolicFile is a Mach-O file
@@ -840,7 +874,8 @@ static void dumpSymbolNamesFromObject(SymbolicFile *Obj, bool printName) {
 // check to make sure this Mach-O file is one of those architectures or all
 // architectures was specificed.  If not then an error is generated and this
 // routine returns false.  Else it returns true.
-static bool checkMachOAndArchFlags(SymbolicFile *O, std::string &Filename) {
+static bool checkMachOAndArchFlags(SymbolicFile *O, std::string &Filename,
+                                   raw_ostream &ErrOS) {
   if (isa<MachOObjectFile>(O) && !ArchAll && ArchFlags.size() != 0) {
     MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(O);
     bool ArchFound = false;
@@ -862,13 +897,39 @@ static bool checkMachOAndArchFlags(SymbolicFile *O, std::string &Filename) {
     }
     if (!ArchFound) {
       error(ArchFlags[i],
-            "file: " + Filename + " does not contain architecture");
+            "file: " + Filename + " does not contain architecture", ErrOS);
       return false;
     }
   }
   return true;
 }
 
+// dumpArchiveMember() dumps the symbols of one member of the archive Filename
+// into Output.  It may be called on any thread, so each member is read into an
+// LLVMContext of its own.
+static void dumpArchiveMember(Archive::child_iterator Member,
+                              std::string &Filename, MemberOutput &Output) {
+  raw_string_ostream ErrOS(Output.Errs);
+  LLVMContext Context;
+  ErrorOr<std::unique_ptr<Binary>> ChildOrErr = Member->getAsBinary(&Context);
+  if (!ChildOrErr.getError()) {
+    if (SymbolicFile *O = dyn_cast<SymbolicFile>(&*ChildOrErr.get())) {
+      if (!checkMachOAndArchFlags(O, Filename, ErrOS)) {
+        Output.ArchMismatch = true;
+      } else {
+        raw_string_ostream OS(Output.Out);
+        OS << "\n";
+        if (isa<MachOObjectFile>(O)) {
+          OS << Filename << "(" << O->getFileName() << ")";
+        } else
+          OS << O->getFileName();
+        OS << ":\n";
+        dumpSymbolNamesFromObject(O, false, OS, ErrOS);
+      }
+    }
+  }
+}
+
 static void dumpSymbolNamesFromFile(std::string &Filename) {
   ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
       MemoryBuffer::getFileOrSTDIN(Filename);
@@ -903,21 +964,31 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
       }
     }
 
+    std::vector<Archive::child_iterator> Members;
     for (Archive::child_iterator I = A->child_begin(), E = A->child_end();
-         I != E; ++I) {
-      ErrorOr<std::unique_ptr<Binary>> ChildOrErr = I->getAsBinary(&Context);
-      if (ChildOrErr.getError())
-        continue;
-      if (SymbolicFile *O = dyn_cast<SymbolicFile>(&*ChildOrErr.get())) {
-        if (!checkMachOAndArchFlags(O, Filename))
+         I != E; ++I)
+      Members.push_back(I);
+    unsigned Threads = NumThreads ? NumThreads
+                                  : ThreadPool::getHardwareConcurrency();
+    ThreadPool Pool(std::min<size_t>(Threads, Members.size()));
+    // Dump the members in batches, so that only a bounded amount of output
+    // is buffered.  Each member is read only once its worker gets to it.
+    size_t BatchSize = 16 * Pool.getThreadCount();
+    for (size_t Begin = 0, E = Members.size(); Begin < E; Begin += BatchSize) {
+      size_t End = std::min(Begin + BatchSize, E);
+      std::vector<MemberOutput> Outputs(End - Begin);
+      for (size_t I = Begin; I != End; ++I)
+        Pool.async([&, I] {
+          dumpArchiveMember(Members[I], Filename, Outputs[I - Begin]);
+        });
+      Pool.wait();
+
+      for (const MemberOutput &Output : Outputs) {
+        outs() << Output.Out;
+        errs() << Output.Errs;
+        HadError |= !Output.Errs.empty();
+        if (Output.ArchMismatch)
           return;
-        outs() << "\n";
-        if (isa<MachOObjectFile>(O)) {
-          outs() << Filename << "(" << O->getFileName() << ")";
-        } else
-          outs() << O->getFileName();
-        outs() << ":\n";
-        dumpSymbolNamesFromObject(O, false);
       }
     }
     return;
@@ -944,7 +1015,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
                        << I->getArchTypeName() << ")"
                        << ":\n";
               }
-              dumpSymbolNamesFromObject(Obj.get(), false);
+              dumpSymbolNamesFromObject(Obj.get(), false, outs(), errs());
             } else if (!I->getAsArchive(A)) {
               for (Archive::child_iterator AI = A->child_begin(),
                                            AE = A->child_end();
@@ -962,7 +1033,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
                            << ")";
                   }
                   outs() << ":\n";
-                  dumpSymbolNamesFromObject(O, false);
+                  dumpSymbolNamesFromObject(O, false, outs(), errs());
                 }
               }
             }
@@ -988,7 +1059,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
           std::unique_ptr<Archive> A;
           if (ObjOrErr) {
             std::unique_ptr<ObjectFile> Obj = std::move(ObjOrErr.get());
-            dumpSymbolNamesFromObject(Obj.get(), false);
+            dumpSymbolNamesFromObject(Obj.get(), false, outs(), errs());
           } else if (!I->getAsArchive(A)) {
             for (Archive::child_iterator AI = A->child_begin(),
                                          AE = A->child_end();
@@ -1002,7 +1073,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
                 outs() << "\n" << A->getFileName() << "(" << O->getFileName()
                        << ")"
                        << ":\n";
-                dumpSymbolNamesFromObject(O, false);
+                dumpSymbolNamesFromObject(O, false, outs(), errs());
               }
             }
           }
@@ -1026,7 +1097,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
         if (isa<MachOObjectFile>(Obj.get()) && moreThanOneArch)
           outs() << " (for architecture " << I->getArchTypeName() << ")";
         outs() << ":\n";
-        dumpSymbolNamesFromObject(Obj.get(), false);
+        dumpSymbolNamesFromObject(Obj.get(), false, outs(), errs());
       } else if (!I->getAsArchive(A)) {
         for (Archive::child_iterator AI = A->child_begin(), AE = A->child_end();
              AI != AE; ++AI) {
@@ -1043,7 +1114,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
             } else
               outs() << ":" << O->getFileName();
             outs() << ":\n";
-            dumpSymbolNamesFromObject(O, false);
+            dumpSymbolNamesFromObject(O, false, outs(), errs());
           }
         }
       }
@@ -1051,9 +1122,9 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
     return;
   }
   if (SymbolicFile *O = dyn_cast<SymbolicFile>(Bin.get())) {
-    if (!checkMachOAndArchFlags(O, Filename))
+    if (!checkMachOAndArchFlags(O, Filename, errs()))
       return;
-    dumpSymbolNamesFromObject(O, true);
+    dumpSymbolNamesFromObject(O, true, outs(), errs());
     return;
   }
   error("unrecognizable file type", Filename);
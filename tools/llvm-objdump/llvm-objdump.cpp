@@ -56,8 +56,10 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstring>
 #include <system_error>
@@ -146,6 +148,14 @@ YAMLCFG("yaml-cfg",
         cl::desc("Create a CFG and write it as a YAML MCModule."),
         cl::value_desc("yaml output file"));
 
+static cl::opt<unsigned>
+NumThreads("num-threads", cl::init(0),
+           cl::desc("Number of threads used to disassemble "
+                    "(default: one per hardware thread)"));
+static cl::alias
+NumThreadsA("j", cl::desc("Alias for --num-threads"),
+            cl::aliasopt(NumThreads));
+
 static StringRef ToolName;
 
 bool llvm::error(std::error_code EC) {
@@ -239,6 +249,10 @@ static void emitDOTFile(const char *FileName, const MCFunction &f,
 }
 
 void llvm::DumpBytes(StringRef bytes) {
+  DumpBytes(bytes, outs());
+}
+
+void llvm::DumpBytes(StringRef bytes, raw_ostream &OS) {
   static const char hex_rep[] = "0123456789abcdef";
   // FIXME: The real way to do this is to figure out the longest instruction
   //        and align to that size before printing. I'll fix this when I get
@@ -261,7 +275,7 @@ void llvm::DumpBytes(StringRef bytes) {
   }
 
   output[sizeof(output) - 1] = 0;
-  outs() << output;
+  OS << output;
 }
 
 bool llvm::RelocAddressLess(RelocationRef a, RelocationRef b) {
@@ -271,6 +285,218 @@ bool llvm::RelocAddressLess(RelocationRef a, RelocationRef b) {
   return a_addr < b_addr;
 }
 
+namespace {
+/// The parts of a disassembler that hold mutable state.  Each thread that
+/// disassembles gets its own; the register, instruction and subtarget info
+/// they are built from are shared.
+struct DisassemblerState {
+  std::unique_ptr<const MCObjectFileInfo> MOFI;
+  std::unique_ptr<MCContext> Ctx;
+  std::unique_ptr<MCDisassembler> DisAsm;
+  std::unique_ptr<MCInstPrinter> IP;
+};
+
+/// Symbols sorted by address, used to name branch targets.
+class SymbolIndex {
+  struct Entry {
+    uint64_t Address;
+    uint64_t SectionEnd;
+    StringRef Name;
+    bool operator<(const Entry &RHS) const { return Address < RHS.Address; }
+  };
+  std::vector<Entry> Entries;
+
+public:
+  void add(uint64_t Address, uint64_t SectionEnd, StringRef Name) {
+    Entry E = { Address, SectionEnd, Name };
+    Entries.push_back(E);
+  }
+  void sort() { std::stable_sort(Entries.begin(), Entries.end()); }
+
+  /// Find the last symbol at or before \p Target whose section contains it.
+  /// Returns false if there is none.
+  bool lookup(uint64_t Target, StringRef &Name, uint64_t &Offset) const {
+    Entry Key = { Target, 0, StringRef() };
+    std::vector<Entry>::const_iterator I =
+        std::upper_bound(Entries.begin(), Entries.end(), Key);
+    while (I != Entries.begin()) {
+      --I;
+      if (Target < I->SectionEnd) {
+        Name = I->Name;
+        Offset = Target - I->Address;
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+/// A text section, with its symbols and relocations sorted by address.
+struct DisasmSection {
+  uint64_t Address;
+  uint64_t Size;
+  StringRef Bytes;
+  std::string Name;
+  std::vector<std::pair<uint64_t, StringRef>> Symbols;
+  std::vector<RelocationRef> Rels;
+  SymbolIndex Targets;
+};
+
+/// The range of a section covered by one symbol, and the text disassembled
+/// from it.  Chunks are independent and can be disassembled in any order.
+struct DisasmChunk {
+  const DisasmSection *Section;
+  StringRef Name;
+  uint64_t Start;
+  uint64_t End;
+  std::vector<RelocationRef>::const_iterator RelBegin;
+  std::vector<RelocationRef>::const_iterator RelEnd;
+  bool FirstInSection;
+  std::string Out;
+  std::string Errs;
+};
+}
+
+static bool createDisassemblerState(const Target *TheTarget,
+                                    const ObjectFile *Obj,
+                                    const MCAsmInfo &AsmInfo,
+                                    const MCRegisterInfo &MRI,
+                                    const MCSubtargetInfo &STI,
+                                    const MCInstrInfo &MII,
+                                    DisassemblerState &State) {
+  State.MOFI.reset(new MCObjectFileInfo);
+  State.Ctx.reset(new MCContext(&AsmInfo, &MRI, State.MOFI.get()));
+
+  State.DisAsm.reset(TheTarget->createMCDisassembler(STI, *State.Ctx));
+  if (!State.DisAsm) {
+    errs() << "error: no disassembler for target " << TripleName << "\n";
+    return false;
+  }
+
+  if (Symbolize) {
+    std::unique_ptr<MCRelocationInfo> RelInfo(
+        TheTarget->createMCRelocationInfo(TripleName, *State.Ctx));
+    if (RelInfo) {
+      std::unique_ptr<MCSymbolizer> Symzer(
+        MCObjectSymbolizer::createObjectSymbolizer(*State.Ctx,
+                                                   std::move(RelInfo), Obj));
+      if (Symzer)
+        State.DisAsm->setSymbolizer(std::move(Symzer));
+    }
+  }
+
+  int AsmPrinterVariant = AsmInfo.getAssemblerDialect();
+  State.IP.reset(TheTarget->createMCInstPrinter(AsmPrinterVariant, AsmInfo,
+                                                MII, MRI, STI));
+  if (!State.IP) {
+    errs() << "error: no instruction printer for target " << TripleName
+      << '\n';
+    return false;
+  }
+  return true;
+}
+
+static bool error(std::error_code EC, raw_ostream &OS) {
+  if (!EC)
+    return false;
+
+  OS << ToolName << ": error reading file: " << EC.message() << ".\n";
+  return true;
+}
+
+static void DisassembleChunk(DisasmChunk &Chunk, DisassemblerState &State,
+                             const MCInstrAnalysis *MIA,
+                             const SymbolIndex &AllTargets, StringRef Fmt) {
+  const DisasmSection &Sec = *Chunk.Section;
+  raw_string_ostream OS(Chunk.Out);
+  raw_string_ostream ErrOS(Chunk.Errs);
+
+  if (Chunk.FirstInSection)
+    OS << "Disassembly of section " << Sec.Name << ':';
+  OS << '\n' << Chunk.Name << ":\n";
+
+#ifndef NDEBUG
+  raw_ostream &DebugOut = DebugFlag ? dbgs() : nulls();
+#else
+  raw_ostream &DebugOut = nulls();
+#endif
+
+  StringRefMemoryObject MemoryObject(Sec.Bytes, Sec.Address);
+  SmallString<40> Comments;
+  raw_svector_ostream CommentStream(Comments);
+  std::vector<RelocationRef>::const_iterator rel_cur = Chunk.RelBegin;
+  std::vector<RelocationRef>::const_iterator rel_end = Chunk.RelEnd;
+  uint64_t Size;
+  for (uint64_t Index = Chunk.Start; Index < Chunk.End; Index += Size) {
+    MCInst Inst;
+
+    if (State.DisAsm->getInstruction(Inst, Size, MemoryObject,
+                                     Sec.Address + Index,
+                                     DebugOut, CommentStream)) {
+      OS << format("%8" PRIx64 ":", Sec.Address + Index);
+      if (!NoShowRawInsn) {
+        OS << "\t";
+        DumpBytes(StringRef(Sec.Bytes.data() + Index, Size), OS);
+      }
+      State.IP->printInst(&Inst, OS, "");
+
+      // Name the target of direct branches and calls.
+      uint64_t Target;
+      if (MIA && (MIA->isBranch(Inst) || MIA->isCall(Inst)) &&
+          Inst.getNumOperands() && Inst.getOperand(0).isImm() &&
+          MIA->evaluateBranch(Inst, Sec.Address + Index, Size, Target)) {
+        StringRef TargetName;
+        uint64_t Offset;
+        // Prefer the branch's own section: in relocatable objects every
+        // section starts at zero.
+        bool Found = Target >= Sec.Address &&
+                     Target < Sec.Address + Sec.Size &&
+                     Sec.Targets.lookup(Target, TargetName, Offset);
+        if (Found || AllTargets.lookup(Target, TargetName, Offset)) {
+          OS << " <" << TargetName;
+          if (Offset)
+            OS << format("+0x%" PRIx64, Offset);
+          OS << '>';
+        }
+      }
+
+      OS << CommentStream.str();
+      Comments.clear();
+      OS << "\n";
+    } else {
+      ErrOS << ToolName << ": warning: invalid instruction encoding\n";
+      if (Size == 0)
+        Size = 1; // skip illegible bytes
+    }
+
+    // Print relocation for instruction.
+    while (rel_cur != rel_end) {
+      bool hidden = false;
+      uint64_t addr;
+      SmallString<16> name;
+      SmallString<32> val;
+
+      // If this relocation is hidden, skip it.
+      if (error(rel_cur->getHidden(hidden), OS)) goto skip_print_rel;
+      if (hidden) goto skip_print_rel;
+
+      if (error(rel_cur->getOffset(addr), OS)) goto skip_print_rel;
+      // Stop when rel_cur's address is past the current instruction.
+      if (addr >= Index + Size) break;
+      if (error(rel_cur->getTypeName(name), OS)) goto skip_print_rel;
+      if (error(rel_cur->getValueString(val), OS)) goto skip_print_rel;
+
+      OS << format(Fmt.data(), Sec.Address + addr) << name
+         << "\t" << val << "\n";
+
+    skip_print_rel:
+      ++rel_cur;
+    }
+  }
+  OS.flush();
+  ErrOS.flush();
+}
+
 static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
   const Target *TheTarget = getTarget(Obj);
   // getTarget() will have already issued a diagnostic if necessary, so
@@ -315,42 +541,16 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
     return;
   }
 
-  std::unique_ptr<const MCObjectFileInfo> MOFI(new MCObjectFileInfo);
-  MCContext Ctx(AsmInfo.get(), MRI.get(), MOFI.get());
-
-  std::unique_ptr<MCDisassembler> DisAsm(
-    TheTarget->createMCDisassembler(*STI, Ctx));
-
-  if (!DisAsm) {
-    errs() << "error: no disassembler for target " << TripleName << "\n";
+  DisassemblerState MainState;
+  if (!createDisassemblerState(TheTarget, Obj, *AsmInfo, *MRI, *STI, *MII,
+                               MainState))
     return;
-  }
-
-
-  if (Symbolize) {
-    std::unique_ptr<MCRelocationInfo> RelInfo(
-        TheTarget->createMCRelocationInfo(TripleName, Ctx));
-    if (RelInfo) {
-      std::unique_ptr<MCSymbolizer> Symzer(
-        MCObjectSymbolizer::createObjectSymbolizer(Ctx, std::move(RelInfo),
-                                                   Obj));
-      if (Symzer)
-        DisAsm->setSymbolizer(std::move(Symzer));
-    }
-  }
+  MCDisassembler *DisAsm = MainState.DisAsm.get();
+  MCInstPrinter *IP = MainState.IP.get();
 
   std::unique_ptr<const MCInstrAnalysis> MIA(
       TheTarget->createMCInstrAnalysis(MII.get()));
 
-  int AsmPrinterVariant = AsmInfo->getAssemblerDialect();
-  std::unique_ptr<MCInstPrinter> IP(TheTarget->createMCInstPrinter(
-      AsmPrinterVariant, *AsmInfo, *MII, *MRI, *STI));
-  if (!IP) {
-    errs() << "error: no instruction printer for target " << TripleName
-      << '\n';
-    return;
-  }
-
   if (CFG || !YAMLCFG.empty()) {
     std::unique_ptr<MCObjectDisassembler> OD(
         new MCObjectDisassembler(*Obj, *DisAsm, *MIA));
@@ -375,7 +575,7 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
         static int filenum = 0;
         emitDOTFile((Twine((*FI)->getName()) + "_" +
                      utostr(filenum) + ".dot").str().c_str(),
-                      **FI, IP.get());
+                      **FI, IP);
         ++filenum;
       }
     }
@@ -395,7 +595,6 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
 
   // Create a mapping, RelocSecs = SectionRelocMap[S], where sections
   // in RelocSecs contain the relocations for section S.
-  std::error_code EC;
   std::map<SectionRef, SmallVector<SectionRef, 1>> SectionRelocMap;
   for (const SectionRef &Section : Obj->sections()) {
     section_iterator Sec2 = Section.getRelocatedSection();
@@ -403,6 +602,10 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
       SectionRelocMap[*Sec2].push_back(Section);
   }
 
+  // Gather the text sections with their symbols and relocations, and build
+  // an index of every symbol for naming branch targets.
+  std::vector<std::unique_ptr<DisasmSection>> Sections;
+  SymbolIndex AllTargets;
   for (const SectionRef &Section : Obj->sections()) {
     bool Text;
     if (error(Section.isText(Text)))
@@ -410,16 +613,15 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
     if (!Text)
       continue;
 
-    uint64_t SectionAddr;
-    if (error(Section.getAddress(SectionAddr)))
+    std::unique_ptr<DisasmSection> Sec(new DisasmSection);
+    if (error(Section.getAddress(Sec->Address)))
       break;
 
-    uint64_t SectSize;
-    if (error(Section.getSize(SectSize)))
+    if (error(Section.getSize(Sec->Size)))
       break;
 
     // Make a list of all the symbols in this section.
-    std::vector<std::pair<uint64_t, StringRef>> Symbols;
+    std::vector<std::pair<uint64_t, StringRef>> &Symbols = Sec->Symbols;
     for (const SymbolRef &Symbol : Obj->symbols()) {
       bool contains;
       if (!error(Section.containsSymbol(Symbol, contains)) && contains) {
@@ -428,8 +630,8 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
           break;
         if (Address == UnknownAddressOrSize)
           continue;
-        Address -= SectionAddr;
-        if (Address >= SectSize)
+        Address -= Sec->Address;
+        if (Address >= Sec->Size)
           continue;
 
         StringRef Name;
@@ -443,17 +645,16 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
     array_pod_sort(Symbols.begin(), Symbols.end());
 
     // Make a list of all the relocations for this section.
-    std::vector<RelocationRef> Rels;
     if (InlineRelocs) {
       for (const SectionRef &RelocSec : SectionRelocMap[Section]) {
         for (const RelocationRef &Reloc : RelocSec.relocations()) {
-          Rels.push_back(Reloc);
+          Sec->Rels.push_back(Reloc);
         }
       }
     }
 
     // Sort relocations by address.
-    std::sort(Rels.begin(), Rels.end(), RelocAddressLess);
+    std::sort(Sec->Rels.begin(), Sec->Rels.end(), RelocAddressLess);
 
     StringRef SegmentName = "";
     if (const MachOObjectFile *MachO = dyn_cast<const MachOObjectFile>(Obj)) {
@@ -463,98 +664,107 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
     StringRef name;
     if (error(Section.getName(name)))
       break;
-    outs() << "Disassembly of section ";
-    if (!SegmentName.empty())
-      outs() << SegmentName << ",";
-    outs() << name << ':';
+    Sec->Name = SegmentName.empty() ? name.str()
+                                    : (SegmentName + "," + name).str();
+
+    for (unsigned si = 0, se = Symbols.size(); si != se; ++si) {
+      uint64_t Address = Sec->Address + Symbols[si].first;
+      Sec->Targets.add(Address, Sec->Address + Sec->Size, Symbols[si].second);
+      AllTargets.add(Address, Sec->Address + Sec->Size, Symbols[si].second);
+    }
+    Sec->Targets.sort();
 
     // If the section has no symbols just insert a dummy one and disassemble
     // the whole section.
     if (Symbols.empty())
       Symbols.push_back(std::make_pair(0, name));
 
-
-    SmallString<40> Comments;
-    raw_svector_ostream CommentStream(Comments);
-
-    StringRef Bytes;
-    if (error(Section.getContents(Bytes)))
+    if (error(Section.getContents(Sec->Bytes)))
       break;
-    StringRefMemoryObject memoryObject(Bytes, SectionAddr);
-    uint64_t Size;
-    uint64_t Index;
 
-    std::vector<RelocationRef>::const_iterator rel_cur = Rels.begin();
-    std::vector<RelocationRef>::const_iterator rel_end = Rels.end();
-    // Disassemble symbol by symbol.
+    Sections.push_back(std::move(Sec));
+  }
+  AllTargets.sort();
+
+  // Split each section at its symbols.
+  std::vector<DisasmChunk> Chunks;
+  for (const std::unique_ptr<DisasmSection> &Sec : Sections) {
+    const std::vector<std::pair<uint64_t, StringRef>> &Symbols = Sec->Symbols;
+    bool First = true;
     for (unsigned si = 0, se = Symbols.size(); si != se; ++si) {
-      uint64_t Start = Symbols[si].first;
-      uint64_t End;
+      DisasmChunk Chunk;
+      Chunk.Section = Sec.get();
+      Chunk.Name = Symbols[si].second;
+      Chunk.Start = Symbols[si].first;
       // The end is either the size of the section or the beginning of the next
       // symbol.
       if (si == se - 1)
-        End = SectSize;
+        Chunk.End = Sec->Size;
       // Make sure this symbol takes up space.
-      else if (Symbols[si + 1].first != Start)
-        End = Symbols[si + 1].first - 1;
+      else if (Symbols[si + 1].first != Chunk.Start)
+        Chunk.End = Symbols[si + 1].first - 1;
       else
         // This symbol has the same address as the next symbol. Skip it.
         continue;
 
-      outs() << '\n' << Symbols[si].second << ":\n";
-
-#ifndef NDEBUG
-      raw_ostream &DebugOut = DebugFlag ? dbgs() : nulls();
-#else
-      raw_ostream &DebugOut = nulls();
-#endif
-
-      for (Index = Start; Index < End; Index += Size) {
-        MCInst Inst;
-
-        if (DisAsm->getInstruction(Inst, Size, memoryObject,
-                                   SectionAddr + Index,
-                                   DebugOut, CommentStream)) {
-          outs() << format("%8" PRIx64 ":", SectionAddr + Index);
-          if (!NoShowRawInsn) {
-            outs() << "\t";
-            DumpBytes(StringRef(Bytes.data() + Index, Size));
-          }
-          IP->printInst(&Inst, outs(), "");
-          outs() << CommentStream.str();
-          Comments.clear();
-          outs() << "\n";
-        } else {
-          errs() << ToolName << ": warning: invalid instruction encoding\n";
-          if (Size == 0)
-            Size = 1; // skip illegible bytes
-        }
-
-        // Print relocation for instruction.
-        while (rel_cur != rel_end) {
-          bool hidden = false;
-          uint64_t addr;
-          SmallString<16> name;
-          SmallString<32> val;
-
-          // If this relocation is hidden, skip it.
-          if (error(rel_cur->getHidden(hidden))) goto skip_print_rel;
-          if (hidden) goto skip_print_rel;
+      // A chunk prints the relocations up to the next chunk's symbol; the
+      // first one also picks up any that precede it.
+      Chunk.RelBegin = First ? Sec->Rels.begin() : Chunks.back().RelEnd;
+      Chunk.RelEnd = Sec->Rels.end();
+      if (si != se - 1) {
+        uint64_t Next = Symbols[si + 1].first;
+        Chunk.RelEnd = std::partition_point(
+            Chunk.RelBegin, Chunk.RelEnd, [Next](const RelocationRef &R) {
+              uint64_t Offset;
+              return !R.getOffset(Offset) && Offset < Next;
+            });
+      }
+      Chunk.FirstInSection = First;
+      First = false;
+      Chunks.push_back(std::move(Chunk));
+    }
+  }
 
-          if (error(rel_cur->getOffset(addr))) goto skip_print_rel;
-          // Stop when rel_cur's address is past the current instruction.
-          if (addr >= Index + Size) break;
-          if (error(rel_cur->getTypeName(name))) goto skip_print_rel;
-          if (error(rel_cur->getValueString(val))) goto skip_print_rel;
+  // Disassemble the chunks on a pool of threads, each with its own
+  // disassembler, and print them in order.  The work is done in batches so
+  // that only a bounded amount of text is buffered at a time.
+  unsigned Threads = NumThreads ? NumThreads
+                                : ThreadPool::getHardwareConcurrency();
+  const uint64_t BatchBytes = uint64_t(Threads) << 22;
+  for (size_t BatchBegin = 0, E = Chunks.size(); BatchBegin != E;) {
+    size_t BatchEnd = BatchBegin;
+    uint64_t Bytes = 0;
+    while (BatchEnd != E && Bytes < BatchBytes) {
+      Bytes += Chunks[BatchEnd].End - Chunks[BatchEnd].Start;
+      ++BatchEnd;
+    }
 
-          outs() << format(Fmt.data(), SectionAddr + addr) << name
-                 << "\t" << val << "\n";
+    unsigned Workers = std::min<size_t>(Threads, BatchEnd - BatchBegin);
+    if (Workers <= 1) {
+      for (size_t I = BatchBegin; I != BatchEnd; ++I)
+        DisassembleChunk(Chunks[I], MainState, MIA.get(), AllTargets, Fmt);
+    } else {
+      std::atomic<size_t> Next(BatchBegin);
+      ThreadPool Pool(Workers);
+      for (unsigned W = 0; W != Workers; ++W)
+        Pool.async([&, BatchEnd] {
+          DisassemblerState State;
+          if (!createDisassemblerState(TheTarget, Obj, *AsmInfo, *MRI, *STI,
+                                       *MII, State))
+            return;
+          for (size_t I = Next++; I < BatchEnd; I = Next++)
+            DisassembleChunk(Chunks[I], State, MIA.get(), AllTargets, Fmt);
+        });
+      Pool.wait();
+    }
 
-        skip_print_rel:
-          ++rel_cur;
-        }
-      }
+    for (size_t I = BatchBegin; I != BatchEnd; ++I) {
+      outs() << Chunks[I].Out;
+      errs() << Chunks[I].Errs;
+      std::string().swap(Chunks[I].Out);
+      std::string().swap(Chunks[I].Errs);
     }
+    BatchBegin = BatchEnd;
   }
 }
 
@@ -26,10 +26,12 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <string>
 #include <system_error>
+#include <vector>
 using namespace llvm;
 using namespace object;
 
@@ -76,15 +78,23 @@ RadixShort(cl::desc("Print size in radix:"),
 static cl::list<std::string>
 InputFilenames(cl::Positional, cl::desc("<input files>"), cl::ZeroOrMore);
 
+static cl::opt<unsigned>
+NumThreads("num-threads", cl::init(0),
+           cl::desc("Number of threads used to read archive members "
+                    "(default: one per hardware thread)"));
+static cl::alias
+NumThreadsA("j", cl::desc("Alias for --num-threads"),
+            cl::aliasopt(NumThreads));
+
 static std::string ToolName;
 
 ///  @brief If ec is not success, print the error and return true.
-static bool error(std::error_code ec) {
+static bool error(std::error_code ec, raw_ostream &OS) {
   if (!ec)
     return false;
 
-  outs() << ToolName << ": error reading file: " << ec.message() << ".\n";
-  outs().flush();
+  OS << ToolName << ": error reading file: " << ec.message() << ".\n";
+  OS.flush();
   return true;
 }
 
@@ -110,11 +120,24 @@ static const char *getRadixFmt(void) {
   return nullptr;
 }
 
+/// @brief Print the column headings of the berkeley format, unless they have
+///        already been printed.  Mach-O files use darwin's headings.
+static void PrintBerkeleyHeader(bool MachO, raw_ostream &OS) {
+  if (berkeleyHeaderPrinted)
+    return;
+  if (MachO)
+    OS << "__TEXT\t__DATA\t__OBJC\tothers\tdec\thex\n";
+  else
+    OS << "   text    data     bss     "
+       << (Radix == octal ? "oct" : "dec") << "     hex filename\n";
+  berkeleyHeaderPrinted = true;
+}
+
 /// @brief Print the size of each Mach-O segment and section in @p MachO.
 ///
 /// This is when used when @c OutputFormat is darwin and produces the same
 /// output as darwin's size(1) -m output.
-static void PrintDarwinSectionSizes(MachOObjectFile *MachO) {
+static void PrintDarwinSectionSizes(MachOObjectFile *MachO, raw_ostream &OS) {
   std::string fmtbuf;
   raw_string_ostream fmt(fmtbuf);
   const char *radix_fmt = getRadixFmt();
@@ -130,70 +153,71 @@ static void PrintDarwinSectionSizes(MachOObjectFile *MachO) {
   for (unsigned I = 0;; ++I) {
     if (Load.C.cmd == MachO::LC_SEGMENT_64) {
       MachO::segment_command_64 Seg = MachO->getSegment64LoadCommand(Load);
-      outs() << "Segment " << Seg.segname << ": "
+      OS << "Segment " << Seg.segname << ": "
              << format(fmt.str().c_str(), Seg.vmsize);
       if (DarwinLongFormat)
-        outs() << " (vmaddr 0x" << format("%" PRIx64, Seg.vmaddr) << " fileoff "
+        OS << " (vmaddr 0x" << format("%" PRIx64, Seg.vmaddr) << " fileoff "
                << Seg.fileoff << ")";
-      outs() << "\n";
+      OS << "\n";
       total += Seg.vmsize;
       uint64_t sec_total = 0;
       for (unsigned J = 0; J < Seg.nsects; ++J) {
         MachO::section_64 Sec = MachO->getSection64(Load, J);
         if (Filetype == MachO::MH_OBJECT)
-          outs() << "\tSection (" << format("%.16s", &Sec.segname) << ", "
+          OS << "\tSection (" << format("%.16s", &Sec.segname) << ", "
                  << format("%.16s", &Sec.sectname) << "): ";
         else
-          outs() << "\tSection " << format("%.16s", &Sec.sectname) << ": ";
-        outs() << format(fmt.str().c_str(), Sec.size);
+          OS << "\tSection " << format("%.16s", &Sec.sectname) << ": ";
+        OS << format(fmt.str().c_str(), Sec.size);
         if (DarwinLongFormat)
-          outs() << " (addr 0x" << format("%" PRIx64, Sec.addr) << " offset "
+          OS << " (addr 0x" << format("%" PRIx64, Sec.addr) << " offset "
                  << Sec.offset << ")";
-        outs() << "\n";
+        OS << "\n";
         sec_total += Sec.size;
       }
       if (Seg.nsects != 0)
-        outs() << "\ttotal " << format(fmt.str().c_str(), sec_total) << "\n";
+        OS << "\ttotal " << format(fmt.str().c_str(), sec_total) << "\n";
     } else if (Load.C.cmd == MachO::LC_SEGMENT) {
       MachO::segment_command Seg = MachO->getSegmentLoadCommand(Load);
-      outs() << "Segment " << Seg.segname << ": "
+      OS << "Segment " << Seg.segname << ": "
              << format(fmt.str().c_str(), Seg.vmsize);
       if (DarwinLongFormat)
-        outs() << " (vmaddr 0x" << format("%" PRIx64, Seg.vmaddr) << " fileoff "
+        OS << " (vmaddr 0x" << format("%" PRIx64, Seg.vmaddr) << " fileoff "
                << Seg.fileoff << ")";
-      outs() << "\n";
+      OS << "\n";
       total += Seg.vmsize;
       uint64_t sec_total = 0;
       for (unsigned J = 0; J < Seg.nsects; ++J) {
         MachO::section Sec = MachO->getSection(Load, J);
         if (Filetype == MachO::MH_OBJECT)
-          outs() << "\tSection (" << format("%.16s", &Sec.segname) << ", "
+          OS << "\tSection (" << format("%.16s", &Sec.segname) << ", "
                  << format("%.16s", &Sec.sectname) << "): ";
         else
-          outs() << "\tSection " << format("%.16s", &Sec.sectname) << ": ";
-        outs() << format(fmt.str().c_str(), Sec.size);
+          OS << "\tSection " << format("%.16s", &Sec.sectname) << ": ";
+        OS << format(fmt.str().c_str(), Sec.size);
         if (DarwinLongFormat)
-          outs() << " (addr 0x" << format("%" PRIx64, Sec.addr) << " offset "
+          OS << " (addr 0x" << format("%" PRIx64, Sec.addr) << " offset "
                  << Sec.offset << ")";
-        outs() << "\n";
+        OS << "\n";
         sec_total += Sec.size;
       }
       if (Seg.nsects != 0)
-        outs() << "\ttotal " << format(fmt.str().c_str(), sec_total) << "\n";
+        OS << "\ttotal " << format(fmt.str().c_str(), sec_total) << "\n";
     }
     if (I == LoadCommandCount - 1)
       break;
     else
       Load = MachO->getNextLoadCommandInfo(Load);
   }
-  outs() << "total " << format(fmt.str().c_str(), total) << "\n";
+  OS << "total " << format(fmt.str().c_str(), total) << "\n";
 }
 
 /// @brief Print the summary sizes of the standard Mach-O segments in @p MachO.
 ///
 /// This is when used when @c OutputFormat is berkeley with a Mach-O file and
 /// produces the same output as darwin's size(1) default output.
-static void PrintDarwinSegmentSizes(MachOObjectFile *MachO) {
+static void PrintDarwinSegmentSizes(MachOObjectFile *MachO, raw_ostream &OS,
+                                    bool PrintHeader) {
   uint32_t LoadCommandCount = MachO->getHeader().ncmds;
   MachOObjectFile::LoadCommandInfo Load = MachO->getFirstLoadCommandInfo();
 
@@ -262,11 +286,9 @@ static void PrintDarwinSegmentSizes(MachOObjectFile *MachO) {
   }
   uint64_t total = total_text + total_data + total_objc + total_others;
 
-  if (!berkeleyHeaderPrinted) {
-    outs() << "__TEXT\t__DATA\t__OBJC\tothers\tdec\thex\n";
-    berkeleyHeaderPrinted = true;
-  }
-  outs() << total_text << "\t" << total_data << "\t" << total_objc << "\t"
+  if (PrintHeader)
+    PrintBerkeleyHeader(true, OS);
+  OS << total_text << "\t" << total_data << "\t" << total_objc << "\t"
          << total_others << "\t" << total << "\t" << format("%" PRIx64, total)
          << "\t";
 }
@@ -274,7 +296,8 @@ static void PrintDarwinSegmentSizes(MachOObjectFile *MachO) {
 /// @brief Print the size of each section in @p Obj.
 ///
 /// The format used is determined by @c OutputFormat and @c Radix.
-static void PrintObjectSectionSizes(ObjectFile *Obj) {
+static void PrintObjectSectionSizes(ObjectFile *Obj, raw_ostream &OS,
+                                    bool PrintHeader = true) {
   uint64_t total = 0;
   std::string fmtbuf;
   raw_string_ostream fmt(fmtbuf);
@@ -285,11 +308,11 @@ static void PrintObjectSectionSizes(ObjectFile *Obj) {
   // let it fall through to OutputFormat berkeley.
   MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(Obj);
   if (OutputFormat == darwin && MachO)
-    PrintDarwinSectionSizes(MachO);
+    PrintDarwinSectionSizes(MachO, OS);
   // If we have a MachOObjectFile and the OutputFormat is berkeley print as
   // darwin's default berkeley format for Mach-O files.
   else if (MachO && OutputFormat == berkeley)
-    PrintDarwinSegmentSizes(MachO);
+    PrintDarwinSegmentSizes(MachO, OS, PrintHeader);
   else if (OutputFormat == sysv) {
     // Run two passes over all sections. The first gets the lengths needed for
     // formatting the output. The second actually does the output.
@@ -298,15 +321,15 @@ static void PrintObjectSectionSizes(ObjectFile *Obj) {
     std::size_t max_addr_len = strlen("addr");
     for (const SectionRef &Section : Obj->sections()) {
       uint64_t size = 0;
-      if (error(Section.getSize(size)))
+      if (error(Section.getSize(size), OS))
         return;
       total += size;
 
       StringRef name;
       uint64_t addr = 0;
-      if (error(Section.getName(name)))
+      if (error(Section.getName(name), OS))
         return;
-      if (error(Section.getAddress(addr)))
+      if (error(Section.getAddress(addr), OS))
         return;
       max_name_len = std::max(max_name_len, name.size());
       max_size_len = std::max(max_size_len, getNumLengthAsString(size));
@@ -324,7 +347,7 @@ static void PrintObjectSectionSizes(ObjectFile *Obj) {
         << "%" << max_addr_len << "s\n";
 
     // Print header
-    outs() << format(fmt.str().c_str(), static_cast<const char *>("section"),
+    OS << format(fmt.str().c_str(), static_cast<const char *>("section"),
                      static_cast<const char *>("size"),
                      static_cast<const char *>("addr"));
     fmtbuf.clear();
@@ -339,22 +362,22 @@ static void PrintObjectSectionSizes(ObjectFile *Obj) {
       StringRef name;
       uint64_t size = 0;
       uint64_t addr = 0;
-      if (error(Section.getName(name)))
+      if (error(Section.getName(name), OS))
         return;
-      if (error(Section.getSize(size)))
+      if (error(Section.getSize(size), OS))
         return;
-      if (error(Section.getAddress(addr)))
+      if (error(Section.getAddress(addr), OS))
         return;
       std::string namestr = name;
 
-      outs() << format(fmt.str().c_str(), namestr.c_str(), size, addr);
+      OS << format(fmt.str().c_str(), namestr.c_str(), size, addr);
     }
 
     // Print total.
     fmtbuf.clear();
     fmt << "%-" << max_name_len << "s "
         << "%#" << max_size_len << radix_fmt << "\n";
-    outs() << format(fmt.str().c_str(), static_cast<const char *>("Total"),
+    OS << format(fmt.str().c_str(), static_cast<const char *>("Total"),
                      total);
   } else {
     // The Berkeley format does not display individual section sizes. It
@@ -369,13 +392,13 @@ static void PrintObjectSectionSizes(ObjectFile *Obj) {
       bool isText = false;
       bool isData = false;
       bool isBSS = false;
-      if (error(Section.getSize(size)))
+      if (error(Section.getSize(size), OS))
         return;
-      if (error(Section.isText(isText)))
+      if (error(Section.isText(isText), OS))
         return;
-      if (error(Section.isData(isData)))
+      if (error(Section.isData(isData), OS))
         return;
-      if (error(Section.isBSS(isBSS)))
+      if (error(Section.isBSS(isBSS), OS))
         return;
       if (isText)
         total_text += size;
@@ -387,21 +410,18 @@ static void PrintObjectSectionSizes(ObjectFile *Obj) {
 
     total = total_text + total_data + total_bss;
 
-    if (!berkeleyHeaderPrinted) {
-      outs() << "   text    data     bss     "
-             << (Radix == octal ? "oct" : "dec") << "     hex filename\n";
-      berkeleyHeaderPrinted = true;
-    }
+    if (PrintHeader)
+      PrintBerkeleyHeader(false, OS);
 
     // Print result.
     fmt << "%#7" << radix_fmt << " "
         << "%#7" << radix_fmt << " "
         << "%#7" << radix_fmt << " ";
-    outs() << format(fmt.str().c_str(), total_text, total_data, total_bss);
+    OS << format(fmt.str().c_str(), total_text, total_data, total_bss);
     fmtbuf.clear();
     fmt << "%7" << (Radix == octal ? PRIo64 : PRIu64) << " "
         << "%7" PRIx64 " ";
-    outs() << format(fmt.str().c_str(), total, total);
+    OS << format(fmt.str().c_str(), total, total);
   }
 }
 
@@ -410,7 +430,8 @@ static void PrintObjectSectionSizes(ObjectFile *Obj) {
 ///        make sure this Mach-O file is one of those architectures or all
 ///        architectures was specificed.  If not then an error is generated and
 ///        this routine returns false.  Else it returns true.
-static bool checkMachOAndArchFlags(ObjectFile *o, StringRef file) {
+static bool checkMachOAndArchFlags(ObjectFile *o, StringRef file,
+                                   raw_ostream &ErrOS) {
   if (isa<MachOObjectFile>(o) && !ArchAll && ArchFlags.size() != 0) {
     MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(o);
     bool ArchFound = false;
@@ -431,14 +452,59 @@ static bool checkMachOAndArchFlags(ObjectFile *o, StringRef file) {
       break;
     }
     if (!ArchFound) {
-      errs() << ToolName << ": file: " << file
-             << " does not contain architecture: " << ArchFlags[i] << ".\n";
+      ErrOS << ToolName << ": file: " << file
+            << " does not contain architecture: " << ArchFlags[i] << ".\n";
       return false;
     }
   }
   return true;
 }
 
+namespace {
+/// The sizes of one archive member, formatted on a worker thread.
+struct MemberSizes {
+  std::string Out;
+  std::string Errs;
+  bool IsObject;
+  bool IsMachO;
+  bool ArchMismatch;
+  MemberSizes() : IsObject(false), IsMachO(false), ArchMismatch(false) {}
+};
+}
+
+/// @brief Format the section sizes of the archive member @p i of @p a into
+///        @p Sizes.  The berkeley header is left to the caller.
+static void PrintArchiveMemberSizes(Archive *a, Archive::child_iterator i,
+                                    StringRef file, MemberSizes &Sizes) {
+  raw_string_ostream OS(Sizes.Out);
+  raw_string_ostream ErrOS(Sizes.Errs);
+  ErrorOr<std::unique_ptr<Binary>> ChildOrErr = i->getAsBinary();
+  if (std::error_code EC = ChildOrErr.getError()) {
+    ErrOS << ToolName << ": " << file << ": " << EC.message() << ".\n";
+    return;
+  }
+  if (ObjectFile *o = dyn_cast<ObjectFile>(&*ChildOrErr.get())) {
+    MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(o);
+    if (!checkMachOAndArchFlags(o, file, ErrOS)) {
+      Sizes.ArchMismatch = true;
+      return;
+    }
+    Sizes.IsObject = true;
+    Sizes.IsMachO = MachO;
+    if (OutputFormat == sysv)
+      OS << o->getFileName() << "   (ex " << a->getFileName() << "):\n";
+    else if (MachO && OutputFormat == darwin)
+      OS << a->getFileName() << "(" << o->getFileName() << "):\n";
+    PrintObjectSectionSizes(o, OS, /*PrintHeader=*/false);
+    if (OutputFormat == berkeley) {
+      if (MachO)
+        OS << a->getFileName() << "(" << o->getFileName() << ")\n";
+      else
+        OS << o->getFileName() << " (ex " << a->getFileName() << ")\n";
+    }
+  }
+}
+
 /// @brief Print the section sizes for @p file. If @p file is an archive, print
 ///        the section sizes for each archive member.
 static void PrintFileSectionSizes(StringRef file) {
@@ -461,30 +527,33 @@ static void PrintFileSectionSizes(StringRef file) {
   std::unique_ptr<Binary> binary(BinaryOrErr.get());
 
   if (Archive *a = dyn_cast<Archive>(binary.get())) {
-    // This is an archive. Iterate over each member and display its sizes.
+    // This is an archive. Display the sizes of the members on a pool of
+    // threads, in batches, and print them in archive order.
+    std::vector<Archive::child_iterator> Members;
     for (object::Archive::child_iterator i = a->child_begin(),
                                          e = a->child_end();
-         i != e; ++i) {
-      ErrorOr<std::unique_ptr<Binary>> ChildOrErr = i->getAsBinary();
-      if (std::error_code EC = ChildOrErr.getError()) {
-        errs() << ToolName << ": " << file << ": " << EC.message() << ".\n";
-        continue;
-      }
-      if (ObjectFile *o = dyn_cast<ObjectFile>(&*ChildOrErr.get())) {
-        MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(o);
-        if (!checkMachOAndArchFlags(o, file))
+         i != e; ++i)
+      Members.push_back(i);
+    unsigned Threads = NumThreads ? NumThreads
+                                  : ThreadPool::getHardwareConcurrency();
+    ThreadPool Pool(std::min<size_t>(Threads, Members.size()));
+    size_t BatchSize = 16 * Pool.getThreadCount();
+    for (size_t Begin = 0, E = Members.size(); Begin < E; Begin += BatchSize) {
+      size_t End = std::min(Begin + BatchSize, E);
+      std::vector<MemberSizes> Sizes(End - Begin);
+      for (size_t I = Begin; I != End; ++I)
+        Pool.async([&, I] {
+          PrintArchiveMemberSizes(a, Members[I], file, Sizes[I - Begin]);
+        });
+      Pool.wait();
+
+      for (const MemberSizes &Member : Sizes) {
+        if (Member.IsObject && OutputFormat == berkeley)
+          PrintBerkeleyHeader(Member.IsMachO, outs());
+        outs() << Member.Out;
+        errs() << Member.Errs;
+        if (Member.ArchMismatch)
           return;
-        if (OutputFormat == sysv)
-          outs() << o->getFileName() << "   (ex " << a->getFileName() << "):\n";
-        else if (MachO && OutputFormat == darwin)
-          outs() << a->getFileName() << "(" << o->getFileName() << "):\n";
-        PrintObjectSectionSizes(o);
-        if (OutputFormat == berkeley) {
-          if (MachO)
-            outs() << a->getFileName() << "(" << o->getFileName() << ")\n";
-          else
-            outs() << o->getFileName() << " (ex " << a->getFileName() << ")\n";
-        }
       }
     }
   } else if (MachOUniversalBinary *UB =
@@ -512,7 +581,7 @@ static void PrintFileSectionSizes(StringRef file) {
                     outs() << o->getFileName() << " (for architecture "
                            << I->getArchTypeName() << "): \n";
                 }
-                PrintObjectSectionSizes(o);
+                PrintObjectSectionSizes(o, outs());
                 if (OutputFormat == berkeley) {
                   if (!MachO || moreThanOneFile || ArchFlags.size() > 1)
                     outs() << o->getFileName() << " (for architecture "
@@ -542,7 +611,7 @@ static void PrintFileSectionSizes(StringRef file) {
                            << ")"
                            << " (for architecture " << I->getArchTypeName()
                            << "):\n";
-                  PrintObjectSectionSizes(o);
+                  PrintObjectSectionSizes(o, outs());
                   if (OutputFormat == berkeley) {
                     if (MachO) {
                       outs() << UA->getFileName() << "(" << o->getFileName()
@@ -588,7 +657,7 @@ static void PrintFileSectionSizes(StringRef file) {
                   outs() << o->getFileName() << " (for architecture "
                          << I->getArchTypeName() << "):\n";
               }
-              PrintObjectSectionSizes(o);
+              PrintObjectSectionSizes(o, outs());
               if (OutputFormat == berkeley) {
                 if (!MachO || moreThanOneFile)
                   outs() << o->getFileName() << " (for architecture "
@@ -617,7 +686,7 @@ static void PrintFileSectionSizes(StringRef file) {
                   outs() << UA->getFileName() << "(" << o->getFileName() << ")"
                          << " (for architecture " << I->getArchTypeName()
                          << "):\n";
-                PrintObjectSectionSizes(o);
+                PrintObjectSectionSizes(o, outs());
                 if (OutputFormat == berkeley) {
                   if (MachO)
                     outs() << UA->getFileName() << "(" << o->getFileName()
@@ -652,7 +721,7 @@ static void PrintFileSectionSizes(StringRef file) {
                      << I->getArchTypeName() << "):";
             outs() << "\n";
           }
-          PrintObjectSectionSizes(o);
+          PrintObjectSectionSizes(o, outs());
           if (OutputFormat == berkeley) {
             if (!MachO || moreThanOneFile || moreThanOneArch)
               outs() << o->getFileName() << " (for architecture "
@@ -678,7 +747,7 @@ static void PrintFileSectionSizes(StringRef file) {
             else if (MachO && OutputFormat == darwin)
               outs() << UA->getFileName() << "(" << o->getFileName() << ")"
                      << " (for architecture " << I->getArchTypeName() << "):\n";
-            PrintObjectSectionSizes(o);
+            PrintObjectSectionSizes(o, outs());
             if (OutputFormat == berkeley) {
               if (MachO)
                 outs() << UA->getFileName() << "(" << o->getFileName() << ")"
@@ -693,11 +762,11 @@ static void PrintFileSectionSizes(StringRef file) {
       }
     }
   } else if (ObjectFile *o = dyn_cast<ObjectFile>(binary.get())) {
-    if (!checkMachOAndArchFlags(o, file))
+    if (!checkMachOAndArchFlags(o, file, errs()))
       return;
     if (OutputFormat == sysv)
       outs() << o->getFileName() << "  :\n";
-    PrintObjectSectionSizes(o);
+    PrintObjectSectionSizes(o, outs());
     if (OutputFormat == berkeley) {
       MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(o);
       if (!MachO || moreThanOneFile)
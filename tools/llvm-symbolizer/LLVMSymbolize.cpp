@@ -23,6 +23,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <sstream>
 #include <stdlib.h>
 
@@ -57,6 +58,25 @@ ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
       addSymbol(*si);
     }
   }
+  sortSymbols(Functions);
+  sortSymbols(Objects);
+}
+
+void ModuleInfo::sortSymbols(SymbolMapTy &M) {
+  // Keep the first symbol added at each address, as inserting into a map
+  // keyed by address would.
+  std::stable_sort(M.begin(), M.end(),
+                   [](const std::pair<SymbolDesc, StringRef> &LHS,
+                      const std::pair<SymbolDesc, StringRef> &RHS) {
+    return LHS.first < RHS.first;
+  });
+  M.erase(std::unique(M.begin(), M.end(),
+                      [](const std::pair<SymbolDesc, StringRef> &LHS,
+                         const std::pair<SymbolDesc, StringRef> &RHS) {
+            return LHS.first.Addr == RHS.first.Addr;
+          }),
+          M.end());
+  SymbolMapTy(M).swap(M);
 }
 
 void ModuleInfo::addSymbol(const SymbolRef &Symbol) {
@@ -87,7 +107,7 @@ void ModuleInfo::addSymbol(const SymbolRef &Symbol) {
   // with same address size. Make sure we choose the correct one.
   SymbolMapTy &M = SymbolType == SymbolRef::ST_Function ? Functions : Objects;
   SymbolDesc SD = { SymbolAddress, SymbolSize };
-  M.insert(std::make_pair(SD, SymbolName));
+  M.push_back(std::make_pair(SD, SymbolName));
 }
 
 bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
@@ -96,8 +116,11 @@ bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
   const SymbolMapTy &M = Type == SymbolRef::ST_Function ? Functions : Objects;
   if (M.empty())
     return false;
-  SymbolDesc SD = { Address, Address };
-  SymbolMapTy::const_iterator it = M.upper_bound(SD);
+  SymbolMapTy::const_iterator it = std::upper_bound(
+      M.begin(), M.end(), Address,
+      [](uint64_t Address, const std::pair<SymbolDesc, StringRef> &Symbol) {
+    return Address < Symbol.first.Addr;
+  });
   if (it == M.begin())
     return false;
   --it;
@@ -169,7 +192,33 @@ const char LLVMSymbolizer::kBadString[] = "??";
 
 std::string LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
                                           uint64_t ModuleOffset) {
+  return symbolizeCode(getOrCreateModuleInfo(ModuleName), ModuleOffset);
+}
+
+std::vector<std::string>
+LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
+                              ArrayRef<uint64_t> ModuleOffsets) {
   ModuleInfo *Info = getOrCreateModuleInfo(ModuleName);
+  // Visit the offsets in ascending order so that lookups walk the symbol
+  // table and the line tables front to back.
+  std::vector<unsigned> Order(ModuleOffsets.size());
+  for (unsigned i = 0, e = Order.size(); i != e; ++i)
+    Order[i] = i;
+  std::stable_sort(Order.begin(), Order.end(), [&](unsigned LHS, unsigned RHS) {
+    return ModuleOffsets[LHS] < ModuleOffsets[RHS];
+  });
+  std::vector<std::string> Results(ModuleOffsets.size());
+  for (unsigned i = 0, e = Order.size(); i != e; ++i) {
+    if (i > 0 && ModuleOffsets[Order[i]] == ModuleOffsets[Order[i - 1]])
+      Results[Order[i]] = Results[Order[i - 1]];
+    else
+      Results[Order[i]] = symbolizeCode(Info, ModuleOffsets[Order[i]]);
+  }
+  return Results;
+}
+
+std::string LLVMSymbolizer::symbolizeCode(ModuleInfo *Info,
+                                          uint64_t ModuleOffset) const {
   if (!Info)
     return printDILineInfo(DILineInfo());
   if (Opts.PrintInlining) {
@@ -207,7 +256,27 @@ std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
 void LLVMSymbolizer::flush() {
   DeleteContainerSeconds(Modules);
   BinaryForPath.clear();
-  ObjectFileForArch.clear();
+  LRUBinaries.clear();
+  CacheSize = 0;
+}
+
+void LLVMSymbolizer::pruneCache() {
+  if (!Opts.MaxCacheSize)
+    return;
+  while (CacheSize > Opts.MaxCacheSize && LRUBinaries.size() > 1) {
+    BinaryMapTy::iterator I = BinaryForPath.find(LRUBinaries.back());
+    assert(I != BinaryForPath.end());
+    BinaryCacheEntry &Entry = I->second;
+    for (const std::string &ModuleName : Entry.ModuleNames) {
+      ModuleMapTy::iterator MI = Modules.find(ModuleName);
+      assert(MI != Modules.end());
+      delete MI->second;
+      Modules.erase(MI);
+    }
+    CacheSize -= Entry.Size;
+    LRUBinaries.pop_back();
+    BinaryForPath.erase(I);
+  }
 }
 
 static std::string getDarwinDWARFResourceForPath(const std::string &Path) {
@@ -293,11 +362,17 @@ static bool getGNUDebuglinkContents(const Binary *Bin, std::string &DebugName,
   return false;
 }
 
-LLVMSymbolizer::BinaryPair
+LLVMSymbolizer::BinaryCacheEntry &
 LLVMSymbolizer::getOrCreateBinary(const std::string &Path) {
   BinaryMapTy::iterator I = BinaryForPath.find(Path);
-  if (I != BinaryForPath.end())
+  if (I != BinaryForPath.end()) {
+    // Mark the binary as most recently used.
+    LRUBinaries.splice(LRUBinaries.begin(), LRUBinaries, I->second.LRUPos);
     return I->second;
+  }
+  BinaryCacheEntry &Entry = BinaryForPath[Path];
+  SmallVectorImpl<std::unique_ptr<Binary>> &ParsedBinariesAndObjects =
+      Entry.ParsedBinariesAndObjects;
   Binary *Bin = nullptr;
   Binary *DbgBin = nullptr;
   ErrorOr<Binary *> BinaryOrErr = createBinary(Path);
@@ -335,28 +410,34 @@ LLVMSymbolizer::getOrCreateBinary(const std::string &Path) {
   }
   if (!DbgBin)
     DbgBin = Bin;
-  BinaryPair Res = std::make_pair(Bin, DbgBin);
-  BinaryForPath[Path] = Res;
-  return Res;
+  Entry.Binaries = std::make_pair(Bin, DbgBin);
+  Entry.Size = 0;
+  for (const auto &B : ParsedBinariesAndObjects)
+    Entry.Size += B->getData().size();
+  CacheSize += Entry.Size;
+  Entry.LRUPos = LRUBinaries.insert(LRUBinaries.begin(), Path);
+  pruneCache();
+  return Entry;
 }
 
 ObjectFile *
-LLVMSymbolizer::getObjectFileFromBinary(Binary *Bin, const std::string &ArchName) {
+LLVMSymbolizer::getObjectFileFromBinary(BinaryCacheEntry &Entry, Binary *Bin,
+                                        const std::string &ArchName) {
   if (!Bin)
     return nullptr;
   ObjectFile *Res = nullptr;
   if (MachOUniversalBinary *UB = dyn_cast<MachOUniversalBinary>(Bin)) {
-    ObjectFileForArchMapTy::iterator I = ObjectFileForArch.find(
-        std::make_pair(UB, ArchName));
-    if (I != ObjectFileForArch.end())
+    BinaryCacheEntry::ObjectFileForArchMapTy::iterator I =
+        Entry.ObjectFileForArch.find(std::make_pair(UB, ArchName));
+    if (I != Entry.ObjectFileForArch.end())
       return I->second;
     ErrorOr<std::unique_ptr<ObjectFile>> ParsedObj =
         UB->getObjectForArch(Triple(ArchName).getArch());
     if (ParsedObj) {
       Res = ParsedObj.get().get();
-      ParsedBinariesAndObjects.push_back(std::move(ParsedObj.get()));
+      Entry.ParsedBinariesAndObjects.push_back(std::move(ParsedObj.get()));
     }
-    ObjectFileForArch[std::make_pair(UB, ArchName)] = Res;
+    Entry.ObjectFileForArch[std::make_pair(UB, ArchName)] = Res;
   } else if (Bin->isObject()) {
     Res = cast<ObjectFile>(Bin);
   }
@@ -365,9 +446,6 @@ LLVMSymbolizer::getObjectFileFromBinary(Binary *Bin, const std::string &ArchName
 
 ModuleInfo *
 LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
-  ModuleMapTy::iterator I = Modules.find(ModuleName);
-  if (I != Modules.end())
-    return I->second;
   std::string BinaryName = ModuleName;
   std::string ArchName = Opts.DefaultArch;
   size_t ColonPos = ModuleName.find_last_of(':');
@@ -379,9 +457,15 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
       ArchName = ArchStr;
     }
   }
-  BinaryPair Binaries = getOrCreateBinary(BinaryName);
-  ObjectFile *Obj = getObjectFileFromBinary(Binaries.first, ArchName);
-  ObjectFile *DbgObj = getObjectFileFromBinary(Binaries.second, ArchName);
+  BinaryCacheEntry &Entry = getOrCreateBinary(BinaryName);
+  ModuleMapTy::iterator I = Modules.find(ModuleName);
+  if (I != Modules.end())
+    return I->second;
+  ObjectFile *Obj = getObjectFileFromBinary(Entry, Entry.Binaries.first,
+                                            ArchName);
+  ObjectFile *DbgObj = getObjectFileFromBinary(Entry, Entry.Binaries.second,
+                                               ArchName);
+  Entry.ModuleNames.push_back(ModuleName);
 
   if (!Obj) {
     // Failed to find valid object file.
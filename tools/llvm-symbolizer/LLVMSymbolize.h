@@ -13,14 +13,17 @@
 #ifndef LLVM_SYMBOLIZE_H
 #define LLVM_SYMBOLIZE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/DebugInfo/DIContext.h"
 #include "llvm/Object/MachOUniversal.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace llvm {
 
@@ -39,16 +42,19 @@ public:
     bool PrintInlining : 1;
     bool Demangle : 1;
     std::string DefaultArch;
+    // Total size in bytes of the binaries kept open at once. When it is
+    // exceeded the least recently used binaries are closed. 0 means no limit.
+    uint64_t MaxCacheSize;
     Options(bool UseSymbolTable = true,
             FunctionNameKind PrintFunctions = FunctionNameKind::LinkageName,
             bool PrintInlining = true, bool Demangle = true,
-            std::string DefaultArch = "")
+            std::string DefaultArch = "", uint64_t MaxCacheSize = 0)
         : UseSymbolTable(UseSymbolTable), PrintFunctions(PrintFunctions),
           PrintInlining(PrintInlining), Demangle(Demangle),
-          DefaultArch(DefaultArch) {}
+          DefaultArch(DefaultArch), MaxCacheSize(MaxCacheSize) {}
   };
 
-  LLVMSymbolizer(const Options &Opts = Options()) : Opts(Opts) {}
+  LLVMSymbolizer(const Options &Opts = Options()) : CacheSize(0), Opts(Opts) {}
   ~LLVMSymbolizer() {
     flush();
   }
@@ -59,30 +65,55 @@ public:
   symbolizeCode(const std::string &ModuleName, uint64_t ModuleOffset);
   std::string
   symbolizeData(const std::string &ModuleName, uint64_t ModuleOffset);
+  // Symbolizes several offsets in the same module. The module is looked up
+  // once, offsets are resolved in ascending order and repeated offsets are
+  // resolved only once. Results are returned in the order of ModuleOffsets.
+  std::vector<std::string>
+  symbolizeCode(const std::string &ModuleName,
+                ArrayRef<uint64_t> ModuleOffsets);
   void flush();
   static std::string DemangleName(const std::string &Name);
 private:
   typedef std::pair<Binary*, Binary*> BinaryPair;
 
+  // Everything parsed from one binary path: the binary, its debug binary,
+  // the object files for particular architectures of universal binaries,
+  // and the names of the modules created from them.
+  struct BinaryCacheEntry {
+    BinaryPair Binaries;
+    SmallVector<std::unique_ptr<Binary>, 2> ParsedBinariesAndObjects;
+    typedef std::map<std::pair<Binary *, std::string>, ObjectFile *>
+        ObjectFileForArchMapTy;
+    ObjectFileForArchMapTy ObjectFileForArch;
+    std::vector<std::string> ModuleNames;
+    uint64_t Size;
+    std::list<std::string>::iterator LRUPos;
+  };
+
   ModuleInfo *getOrCreateModuleInfo(const std::string &ModuleName);
-  /// \brief Returns pair of pointers to binary and debug binary.
-  BinaryPair getOrCreateBinary(const std::string &Path);
+  /// \brief Returns the cache entry for the binary at a given path, parsing
+  /// the binary and its debug binary if necessary.
+  BinaryCacheEntry &getOrCreateBinary(const std::string &Path);
   /// \brief Returns a parsed object file for a given architecture in a
   /// universal binary (or the binary itself if it is an object file).
-  ObjectFile *getObjectFileFromBinary(Binary *Bin, const std::string &ArchName);
+  ObjectFile *getObjectFileFromBinary(BinaryCacheEntry &Entry, Binary *Bin,
+                                      const std::string &ArchName);
+  /// \brief Closes least recently used binaries until the cache fits in
+  /// Opts.MaxCacheSize. The most recently used binary is always kept.
+  void pruneCache();
 
   std::string printDILineInfo(DILineInfo LineInfo) const;
+  std::string symbolizeCode(ModuleInfo *Info, uint64_t ModuleOffset) const;
 
-  // Owns all the parsed binaries and object files.
-  SmallVector<std::unique_ptr<Binary>, 4> ParsedBinariesAndObjects;
   // Owns module info objects.
   typedef std::map<std::string, ModuleInfo *> ModuleMapTy;
   ModuleMapTy Modules;
-  typedef std::map<std::string, BinaryPair> BinaryMapTy;
+  typedef std::map<std::string, BinaryCacheEntry> BinaryMapTy;
   BinaryMapTy BinaryForPath;
-  typedef std::map<std::pair<MachOUniversalBinary *, std::string>, ObjectFile *>
-      ObjectFileForArchMapTy;
-  ObjectFileForArchMapTy ObjectFileForArch;
+  // Binary paths, most recently used first.
+  std::list<std::string> LRUBinaries;
+  // Total size of the binaries in BinaryForPath.
+  uint64_t CacheSize;
 
   Options Opts;
   static const char kBadString[];
@@ -116,7 +147,10 @@ private:
       return s1.Addr < s2.Addr;
     }
   };
-  typedef std::map<SymbolDesc, StringRef> SymbolMapTy;
+  // Symbols sorted by address, with one entry per address. Filled by
+  // addSymbol and sorted once all symbols have been added.
+  typedef std::vector<std::pair<SymbolDesc, StringRef> > SymbolMapTy;
+  static void sortSymbols(SymbolMapTy &M);
   SymbolMapTy Functions;
   SymbolMapTy Objects;
 };
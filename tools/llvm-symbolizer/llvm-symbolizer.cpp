@@ -61,6 +61,14 @@ ClBinaryName("obj", cl::init(""),
              cl::desc("Path to object file to be symbolized (if not provided, "
                       "object file should be specified for each input line)"));
 
+static cl::opt<unsigned long long>
+ClCacheSize("cache-size", cl::init(0),
+            cl::desc("Maximum total size in bytes of the binaries kept open "
+                     "at once (0 means no limit)"));
+
+static cl::list<std::string>
+ClInputAddresses(cl::Positional, cl::desc("<address>..."), cl::ZeroOrMore);
+
 static bool parseCommand(bool &IsData, std::string &ModuleName,
                          uint64_t &ModuleOffset) {
   const char *kDataCmd = "DATA ";
@@ -118,9 +126,32 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm-symbolizer\n");
   LLVMSymbolizer::Options Opts(ClUseSymbolTable, ClPrintFunctions,
-                               ClPrintInlining, ClDemangle, ClDefaultArch);
+                               ClPrintInlining, ClDemangle, ClDefaultArch,
+                               ClCacheSize);
   LLVMSymbolizer Symbolizer(Opts);
 
+  // Addresses given on the command line are code addresses in the -obj
+  // binary; symbolize them all in one batch.
+  if (!ClInputAddresses.empty()) {
+    if (ClBinaryName.empty()) {
+      errs() << argv[0] << ": addresses on the command line require -obj\n";
+      return 1;
+    }
+    std::vector<uint64_t> ModuleOffsets;
+    for (const std::string &Address : ClInputAddresses) {
+      uint64_t ModuleOffset;
+      if (StringRef(Address).getAsInteger(0, ModuleOffset)) {
+        errs() << argv[0] << ": invalid address '" << Address << "'\n";
+        return 1;
+      }
+      ModuleOffsets.push_back(ModuleOffset);
+    }
+    for (const std::string &Result :
+         Symbolizer.symbolizeCode(ClBinaryName, ModuleOffsets))
+      outs() << Result << "\n";
+    return 0;
+  }
+
   bool IsData = false;
   std::string ModuleName;
   uint64_t ModuleOffset;
@@ -269,6 +269,31 @@ bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
                                       DisableGVNLoadPRE, sLastErrorString);
 }
 
+void lto_codegen_set_codegen_partitions(lto_code_gen_t cg,
+                                        unsigned partitions) {
+  unwrap(cg)->setCodeGenPartitions(partitions);
+}
+
+bool lto_codegen_compile_to_files(lto_code_gen_t cg, const char ***names,
+                                  unsigned *count) {
+  if (!parsedOptions) {
+    unwrap(cg)->parseCodeGenDebugOptions();
+    lto_add_attrs(cg);
+    parsedOptions = true;
+  }
+  return !unwrap(cg)->compile_to_files(names, count, DisableOpt, DisableInline,
+                                       DisableGVNLoadPRE, sLastErrorString);
+}
+
+void lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *dir) {
+  unwrap(cg)->setCacheDir(dir ? dir : "");
+}
+
+void lto_codegen_set_cache_size_limit(lto_code_gen_t cg,
+                                      unsigned long long bytes) {
+  unwrap(cg)->setCacheSizeLimit(bytes);
+}
+
 void lto_codegen_debug_options(lto_code_gen_t cg, const char *opt) {
   unwrap(cg)->setCodeGenDebugOptions(opt);
 }
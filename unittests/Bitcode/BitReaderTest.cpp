@@ -15,6 +15,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Pass.h"
 #include "llvm/PassManager.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "gtest/gtest.h"
@@ -63,5 +64,126 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddr) { // PR11677
   passes.run(*m);
 }
 
+/// Records how many basic blocks each function has when it is visited.
+struct CountBlocksPass : public FunctionPass {
+  static char ID;
+  std::vector<std::pair<std::string, unsigned> > &Visited;
+
+  CountBlocksPass(std::vector<std::pair<std::string, unsigned> > &Visited)
+      : FunctionPass(ID), Visited(Visited) {}
+
+  bool runOnFunction(Function &F) override {
+    Visited.push_back(std::make_pair(F.getName().str(), F.size()));
+    return false;
+  }
+};
+char CountBlocksPass::ID = 0;
+
+/// Appends an unreachable block to every function it visits.
+struct AddBlockPass : public FunctionPass {
+  static char ID;
+  AddBlockPass() : FunctionPass(ID) {}
+
+  bool runOnFunction(Function &F) override {
+    new UnreachableInst(F.getContext(),
+                        BasicBlock::Create(F.getContext(), "added", &F));
+    return true;
+  }
+};
+char AddBlockPass::ID = 0;
+
+/// A module pass that does nothing, forcing a new function pass manager for
+/// the function passes that follow it.
+struct NopModulePass : public ModulePass {
+  static char ID;
+  NopModulePass() : ModulePass(ID) {}
+
+  bool runOnModule(Module &M) override { return false; }
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+  }
+};
+char NopModulePass::ID = 0;
+
+TEST(BitReaderTest, StreamFunctions) {
+  SmallString<1024> Mem;
+  {
+    Module Mod("test-stream", getGlobalContext());
+    LLVMContext &Ctx = Mod.getContext();
+    FunctionType *FuncTy = FunctionType::get(Type::getVoidTy(Ctx), false);
+    Function *Callee = Function::Create(FuncTy, GlobalValue::InternalLinkage,
+                                        "callee", &Mod);
+    ReturnInst::Create(Ctx, BasicBlock::Create(Ctx, "entry", Callee));
+    Function *Caller = Function::Create(FuncTy, GlobalValue::ExternalLinkage,
+                                        "caller", &Mod);
+    BasicBlock *Entry = BasicBlock::Create(Ctx, "entry", Caller);
+    CallInst::Create(Callee, "", Entry);
+    ReturnInst::Create(Ctx, Entry);
+
+    raw_svector_ostream OS(Mem);
+    WriteBitcodeToFile(&Mod, OS);
+  }
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(Mem.str(), "test", false);
+  ErrorOr<Module *> ModuleOrErr =
+      getLazyBitcodeModule(Buffer, getGlobalContext());
+  std::unique_ptr<Module> m(ModuleOrErr.get());
+
+  std::vector<std::pair<std::string, unsigned> > Visited;
+  PassManager passes;
+  passes.setStreamFunctions(true);
+  passes.add(new CountBlocksPass(Visited));
+  passes.run(*m);
+
+  // Both bodies were materialized for the pass and released afterwards.
+  ASSERT_EQ(2u, Visited.size());
+  EXPECT_EQ(1u, Visited[0].second);
+  EXPECT_EQ(1u, Visited[1].second);
+
+  Function *Callee = m->getFunction("callee");
+  Function *Caller = m->getFunction("caller");
+  EXPECT_TRUE(Callee->isMaterializable());
+  EXPECT_TRUE(Caller->isMaterializable());
+  EXPECT_TRUE(Callee->hasInternalLinkage());
+
+  // Released bodies can be read back in.
+  EXPECT_FALSE(Caller->Materialize());
+  EXPECT_EQ(1u, Caller->size());
+  EXPECT_EQ(Callee, cast<CallInst>(Caller->front().front()).getCalledValue());
+  EXPECT_FALSE(verifyModule(*m));
+}
+
+TEST(BitReaderTest, StreamFunctionsAcrossModulePass) {
+  SmallString<1024> Mem;
+  {
+    Module Mod("test-stream-split", getGlobalContext());
+    LLVMContext &Ctx = Mod.getContext();
+    FunctionType *FuncTy = FunctionType::get(Type::getVoidTy(Ctx), false);
+    Function *Func = Function::Create(FuncTy, GlobalValue::ExternalLinkage,
+                                      "func", &Mod);
+    ReturnInst::Create(Ctx, BasicBlock::Create(Ctx, "entry", Func));
+
+    raw_svector_ostream OS(Mem);
+    WriteBitcodeToFile(&Mod, OS);
+  }
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(Mem.str(), "test", false);
+  ErrorOr<Module *> ModuleOrErr =
+      getLazyBitcodeModule(Buffer, getGlobalContext());
+  std::unique_ptr<Module> m(ModuleOrErr.get());
+
+  // The module pass splits the function passes into two function pass
+  // managers. The body changed by the first must reach the second.
+  std::vector<std::pair<std::string, unsigned> > Visited;
+  PassManager passes;
+  passes.setStreamFunctions(true);
+  passes.add(new AddBlockPass());
+  passes.add(new NopModulePass());
+  passes.add(new CountBlocksPass(Visited));
+  passes.run(*m);
+
+  ASSERT_EQ(1u, Visited.size());
+  EXPECT_EQ(2u, Visited[0].second);
+  EXPECT_TRUE(m->getFunction("func")->isMaterializable());
+}
+
 }
 }
@@ -0,0 +1,77 @@
+//===- llvm/unittest/DebugInfo/DWARFDebugArangesTest.cpp ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../lib/DebugInfo/DWARFDebugAranges.h"
+#include "gtest/gtest.h"
+using namespace llvm;
+
+namespace {
+
+TEST(DWARFDebugAranges, DisjointRanges) {
+  DWARFDebugAranges Aranges;
+  Aranges.appendRange(0x20, 0x100, 0x110);
+  Aranges.appendRange(0x10, 0x110, 0x120);
+  Aranges.appendRange(0x30, 0x130, 0x140);
+  Aranges.construct();
+
+  EXPECT_EQ(-1U, Aranges.findAddress(0xff));
+  EXPECT_EQ(0x20U, Aranges.findAddress(0x100));
+  EXPECT_EQ(0x20U, Aranges.findAddress(0x10f));
+  EXPECT_EQ(0x10U, Aranges.findAddress(0x110));
+  EXPECT_EQ(0x10U, Aranges.findAddress(0x11f));
+  EXPECT_EQ(-1U, Aranges.findAddress(0x120));
+  EXPECT_EQ(0x30U, Aranges.findAddress(0x130));
+  EXPECT_EQ(-1U, Aranges.findAddress(0x140));
+}
+
+TEST(DWARFDebugAranges, EmptyRangesAreIgnored) {
+  DWARFDebugAranges Aranges;
+  Aranges.appendRange(0x10, 0x100, 0x100);
+  Aranges.appendRange(0x20, 0x110, 0x100);
+  Aranges.construct();
+  EXPECT_EQ(-1U, Aranges.findAddress(0x100));
+  EXPECT_EQ(-1U, Aranges.findAddress(0x108));
+}
+
+TEST(DWARFDebugAranges, OverlapKeepsTheRangeThatStartedFirst) {
+  // The range that reaches the overlap first keeps it, even though its
+  // offset is not the lowest.
+  DWARFDebugAranges Aranges;
+  Aranges.appendRange(0x20, 0x100, 0x110);
+  Aranges.appendRange(0x10, 0x108, 0x118);
+  Aranges.construct();
+  EXPECT_EQ(0x20U, Aranges.findAddress(0x100));
+  EXPECT_EQ(0x20U, Aranges.findAddress(0x108));
+  EXPECT_EQ(0x20U, Aranges.findAddress(0x10f));
+  EXPECT_EQ(0x10U, Aranges.findAddress(0x110));
+  EXPECT_EQ(0x10U, Aranges.findAddress(0x117));
+}
+
+TEST(DWARFDebugAranges, OverlapStartingTogetherGoesToLowestOffset) {
+  DWARFDebugAranges Aranges;
+  Aranges.appendRange(0x20, 0x100, 0x110);
+  Aranges.appendRange(0x10, 0x100, 0x108);
+  Aranges.construct();
+  EXPECT_EQ(0x10U, Aranges.findAddress(0x100));
+  EXPECT_EQ(0x10U, Aranges.findAddress(0x107));
+  EXPECT_EQ(0x20U, Aranges.findAddress(0x108));
+}
+
+TEST(DWARFDebugAranges, NestedRange) {
+  // A range nested in an earlier one, like a subprogram nested in another,
+  // is covered by the outer range.
+  DWARFDebugAranges Aranges;
+  Aranges.appendRange(0x20, 0x100, 0x120);
+  Aranges.appendRange(0x10, 0x108, 0x110);
+  Aranges.construct();
+  EXPECT_EQ(0x20U, Aranges.findAddress(0x108));
+  EXPECT_EQ(0x20U, Aranges.findAddress(0x118));
+}
+
+} // end anonymous namespace
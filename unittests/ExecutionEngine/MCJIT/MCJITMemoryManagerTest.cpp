@@ -167,5 +167,89 @@ TEST(MCJITMemoryManagerTest, ManyVariedAllocations) {
   }
 }
 
+TEST(MCJITMemoryManagerTest, AllocateAfterFinalize) {
+  std::unique_ptr<SectionMemoryManager> MemMgr(new SectionMemoryManager());
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1, "");
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 2, "", false);
+  ASSERT_NE((uint8_t*)nullptr, code1);
+  ASSERT_NE((uint8_t*)nullptr, data1);
+  for (unsigned i = 0; i < 256; ++i) {
+    code1[i] = 1;
+    data1[i] = 2;
+  }
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  // Later sections come from the same slabs, but never from a page that has
+  // already been made executable, so they must still be writable.
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 0, 3, "");
+  uint8_t *data2 = MemMgr->allocateDataSection(256, 0, 4, "", false);
+  ASSERT_NE((uint8_t*)nullptr, code2);
+  ASSERT_NE((uint8_t*)nullptr, data2);
+  EXPECT_LT((uintptr_t)(code2 - code1),
+            (uintptr_t)SectionMemoryManager::DefaultSlabSize);
+  EXPECT_EQ(data1 + 256, data2);
+  for (unsigned i = 0; i < 256; ++i) {
+    code2[i] = 3;
+    data2[i] = 4;
+  }
+
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  for (unsigned i = 0; i < 256; ++i) {
+    EXPECT_EQ(1, code1[i]);
+    EXPECT_EQ(2, data1[i]);
+    EXPECT_EQ(3, code2[i]);
+    EXPECT_EQ(4, data2[i]);
+  }
+}
+
+TEST(MCJITMemoryManagerTest, HugePageSlabs) {
+  // A slab size below one huge page is raised to one huge page.
+  std::unique_ptr<SectionMemoryManager> MemMgr(
+      new SectionMemoryManager(4096, /*UseHugePages=*/true));
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1, "");
+  uint8_t *code2 = MemMgr->allocateCodeSection(0x100000, 0, 2, "");
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 3, "", false);
+  ASSERT_NE((uint8_t*)nullptr, code1);
+  ASSERT_NE((uint8_t*)nullptr, code2);
+  ASSERT_NE((uint8_t*)nullptr, data1);
+
+  // Each slab starts on a huge page boundary, and both code sections fit in
+  // the first huge page of the code slab.
+  const uintptr_t HugePageSize = SectionMemoryManager::HugePageSize;
+  EXPECT_EQ(0U, (uintptr_t)code1 % HugePageSize);
+  EXPECT_EQ(0U, (uintptr_t)data1 % HugePageSize);
+  EXPECT_EQ((uintptr_t)code1 / HugePageSize,
+            (uintptr_t)(code2 + 0x100000 - 1) / HugePageSize);
+  for (unsigned i = 0; i < 256; ++i)
+    code1[i] = 1;
+  for (unsigned i = 0; i < 0x100000; ++i)
+    code2[i] = 2;
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  for (unsigned i = 0; i < 256; ++i)
+    EXPECT_EQ(1, code1[i]);
+  for (unsigned i = 0; i < 0x100000; ++i)
+    EXPECT_EQ(2, code2[i]);
+
+  // Finalizing protected the whole huge page, so later code goes on a fresh,
+  // writable one.
+  uint8_t *code3 = MemMgr->allocateCodeSection(256, 0, 4, "");
+  ASSERT_NE((uint8_t*)nullptr, code3);
+  EXPECT_EQ(0U, (uintptr_t)code3 % HugePageSize);
+  EXPECT_NE((uintptr_t)code1 / HugePageSize, (uintptr_t)code3 / HugePageSize);
+  for (unsigned i = 0; i < 256; ++i)
+    code3[i] = 3;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+  for (unsigned i = 0; i < 256; ++i)
+    EXPECT_EQ(3, code3[i]);
+}
+
 } // Namespace
 
@@ -12,6 +12,7 @@
 // modules, accessing global variables, etc.
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "MCJITTestBase.h"
 #include "gtest/gtest.h"
@@ -22,6 +23,15 @@ namespace {
 
 class MCJITMultipleModuleTest : public testing::Test, public MCJITTestBase {};
 
+// Builds modules in an LLVMContext of its own.
+class OtherContextBuilder : public TrivialModuleBuilder {
+public:
+  OtherContextBuilder(const std::string &Triple)
+    : TrivialModuleBuilder(Triple) {}
+  using TrivialModuleBuilder::createEmptyModule;
+  using TrivialModuleBuilder::insertAddFunction;
+};
+
 // FIXME: ExecutionEngine has no support empty modules
 /*
 TEST_F(MCJITMultipleModuleTest, multiple_empty_modules) {
@@ -392,4 +402,83 @@ TEST_F(MCJITMultipleModuleTest, cross_module_dependency_case3) {
   ptr = TheJIT->getFunctionAddress(FB2->getName().str());
   checkAccumulate(ptr);
 }
+
+// Module A { Function FA },
+// Module B { Extern FA, Function FB which calls FA },
+// Module C { Extern FB, Function FC which calls FB },
+// compile in the background, execute FC, FB, FA
+TEST_F(MCJITMultipleModuleTest, background_compilation_case) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  std::unique_ptr<Module> A, B, C;
+  Function *FA, *FB, *FC;
+  createThreeModuleChainedCallsCase(A, FA, B, FB, C, FC);
+  std::string NameA = FA->getName(), NameB = FB->getName(),
+              NameC = FC->getName();
+
+  createJIT(A.release());
+  TheJIT->setBackgroundCompilation(2);
+  TheJIT->addModule(B.release());
+  TheJIT->addModule(C.release());
+
+  uint64_t ptr = TheJIT->getFunctionAddress(NameC);
+  checkAdd(ptr);
+
+  ptr = TheJIT->getFunctionAddress(NameB);
+  checkAdd(ptr);
+
+  ptr = TheJIT->getFunctionAddress(NameA);
+  checkAdd(ptr);
+}
+
+// Module A { Function FA },
+// Module B { Function FB },
+// compile in the background, remove B before it is needed, execute FA
+TEST_F(MCJITMultipleModuleTest, background_compilation_remove_case) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  std::unique_ptr<Module> A, B;
+  Function *FA, *FB;
+  createTwoModuleCase(A, FA, B, FB);
+  std::string NameA = FA->getName();
+  Module *ModB = B.get();
+
+  createJIT(A.release());
+  TheJIT->setBackgroundCompilation(1);
+  TheJIT->addModule(B.release());
+  EXPECT_TRUE(TheJIT->removeModule(ModB));
+  delete ModB;
+
+  uint64_t ptr = TheJIT->getFunctionAddress(NameA);
+  checkAdd(ptr);
+}
+
+// Modules A0..A15 in one context and B0..B15 in another, each { Function FAi }
+// or { Function FBi }, compiled in the background, execute all of them.
+TEST_F(MCJITMultipleModuleTest, background_compilation_two_contexts_case) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  OtherContextBuilder Other(BuilderTriple);
+  std::vector<std::string> Names;
+  std::vector<Module *> Modules;
+  for (unsigned i = 0; i != 16; ++i) {
+    Module *A = createEmptyModule("A" + utostr(i));
+    Names.push_back(insertAddFunction(A, "FA" + utostr(i))->getName());
+    Modules.push_back(A);
+    Module *B = Other.createEmptyModule("B" + utostr(i));
+    Names.push_back(Other.insertAddFunction(B, "FB" + utostr(i))->getName());
+    Modules.push_back(B);
+  }
+
+  createJIT(Modules[0]);
+  TheJIT->setBackgroundCompilation(4);
+  for (unsigned i = 1, e = Modules.size(); i != e; ++i)
+    TheJIT->addModule(Modules[i]);
+
+  for (unsigned i = 0, e = Names.size(); i != e; ++i)
+    checkAdd(TheJIT->getFunctionAddress(Names[i]));
+
+  // The engine owns modules of Other's context; destroy it first.
+  TheJIT.reset();
+}
 }
@@ -11,6 +11,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/ExecutionEngine/JIT.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
@@ -237,5 +238,28 @@ TEST_F(MCJITObjectCacheTest, VerifyNonLoadFromCache) {
   EXPECT_FALSE(Cache->wereDuplicatesInserted());
 }
 
+#if LLVM_ENABLE_THREADS
+TEST_F(MCJITObjectCacheTest, VerifyRemovedBackgroundCompileIsCached) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  std::unique_ptr<TestObjectCache> Cache(new TestObjectCache);
+
+  Module *SavedModulePointer = M.get();
+
+  // The module is looked up and compiled as soon as the pool exists.
+  createJIT(M.release());
+  TheJIT->setObjectCache(Cache.get());
+  TheJIT->setBackgroundCompilation(1);
+  EXPECT_TRUE(Cache->wasModuleLookedUp(SavedModulePointer));
+
+  // Removing the module before it is loaded must still hand the finished
+  // object to the cache, which may be holding the entry locked until then.
+  EXPECT_TRUE(TheJIT->removeModule(SavedModulePointer));
+  EXPECT_TRUE(nullptr != Cache->getObjectInternal(SavedModulePointer));
+  EXPECT_FALSE(Cache->wereDuplicatesInserted());
+  delete SavedModulePointer;
+}
+#endif
+
 } // Namespace
 
@@ -0,0 +1,87 @@
+//===- llvm/unittest/LTO/LTOModuleTest.cpp - LTOModule tests --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/LTO/LTOModule.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetOptions.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class LTOModuleTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    InitializeAllTargets();
+    InitializeAllTargetMCs();
+    InitializeAllAsmParsers();
+  }
+
+  /// Write a module defining an external function and a second function
+  /// with the given linkage to Mem as bitcode.
+  void writeModule(GlobalValue::LinkageTypes SecondLinkage) {
+    LLVMContext Ctx;
+    Module M("lto-module-test", Ctx);
+    FunctionType *FTy = FunctionType::get(Type::getVoidTy(Ctx), false);
+    Function *First = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                       "first", &M);
+    ReturnInst::Create(Ctx, BasicBlock::Create(Ctx, "entry", First));
+    Function *Second = Function::Create(FTy, SecondLinkage, "second", &M);
+    ReturnInst::Create(Ctx, BasicBlock::Create(Ctx, "entry", Second));
+
+    raw_svector_ostream OS(Mem);
+    WriteBitcodeToFile(&M, OS);
+    OS.flush();
+  }
+
+  LTOModule *createModule() {
+    std::string Err;
+    LTOModule *Mod =
+        LTOModule::createFromBuffer(Mem.data(), Mem.size(), TargetOptions(),
+                                    Err);
+    EXPECT_TRUE(Mod != nullptr) << Err;
+    return Mod;
+  }
+
+  SmallString<1024> Mem;
+};
+
+TEST_F(LTOModuleTest, BodiesStayInBitcode) {
+  writeModule(GlobalValue::ExternalLinkage);
+  std::unique_ptr<LTOModule> Mod(createModule());
+  ASSERT_TRUE(Mod != nullptr);
+
+  // Reporting the symbols did not need the bodies.
+  EXPECT_EQ(2u, Mod->getSymbolCount());
+  EXPECT_TRUE(Mod->getModule().getFunction("first")->isMaterializable());
+  EXPECT_TRUE(Mod->getModule().getFunction("second")->isMaterializable());
+}
+
+TEST_F(LTOModuleTest, LinkOnceODRReadsBodies) {
+  // Whether a linkonce_odr function without unnamed_addr can be hidden
+  // depends on whether its address is compared, so every body is read.
+  writeModule(GlobalValue::LinkOnceODRLinkage);
+  std::unique_ptr<LTOModule> Mod(createModule());
+  ASSERT_TRUE(Mod != nullptr);
+
+  EXPECT_EQ(2u, Mod->getSymbolCount());
+  EXPECT_EQ(LTO_SYMBOL_SCOPE_DEFAULT_CAN_BE_HIDDEN,
+            Mod->getSymbolAttributes(1) & LTO_SYMBOL_SCOPE_MASK);
+  EXPECT_FALSE(Mod->getModule().getFunction("first")->isMaterializable());
+  EXPECT_FALSE(Mod->getModule().getFunction("second")->isMaterializable());
+}
+
+}
@@ -0,0 +1,60 @@
+//===- llvm/unittest/Support/ThreadPoolTest.cpp - ThreadPool tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <atomic>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ThreadPoolTest, RunsEveryTask) {
+  std::atomic<unsigned> Count(0);
+  ThreadPool Pool(4);
+  for (unsigned i = 0; i != 100; ++i)
+    Pool.async([&Count] { ++Count; });
+  Pool.wait();
+  EXPECT_EQ(100u, Count);
+}
+
+TEST(ThreadPoolTest, WaitIsReusable) {
+  std::atomic<unsigned> Count(0);
+  ThreadPool Pool(2);
+  Pool.async([&Count] { ++Count; });
+  Pool.wait();
+  EXPECT_EQ(1u, Count);
+  Pool.async([&Count] { ++Count; });
+  Pool.async([&Count] { ++Count; });
+  Pool.wait();
+  EXPECT_EQ(3u, Count);
+}
+
+TEST(ThreadPoolTest, DestructorDrainsQueue) {
+  std::atomic<unsigned> Count(0);
+  {
+    ThreadPool Pool(3);
+    for (unsigned i = 0; i != 20; ++i)
+      Pool.async([&Count] { ++Count; });
+  }
+  EXPECT_EQ(20u, Count);
+}
+
+TEST(ThreadPoolTest, ResultsByIndex) {
+  std::vector<unsigned> Results(16);
+  ThreadPool Pool;
+  EXPECT_NE(0u, Pool.getThreadCount());
+  for (unsigned i = 0; i != Results.size(); ++i)
+    Pool.async([&Results, i] { Results[i] = i * i; });
+  Pool.wait();
+  for (unsigned i = 0; i != Results.size(); ++i)
+    EXPECT_EQ(i * i, Results[i]);
+}
+
+}